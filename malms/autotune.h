@@ -0,0 +1,289 @@
+/*
+ *  Selection of the sort parameters.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Chooses the parameters of malms::sort for a call without a
+ *				number of pakets: the number of pakets, whether the merge is
+ *				buffered and whether the input is so small that it is sorted
+ *				sequentially with std::sort. The choice is taken from a tuning
+ *				table if one was calibrated on this machine (see calibrate.h),
+ *				otherwise it is derived from n, the element size, the cores of
+ *				the job and the cache sizes read from sysfs.
+ *
+ *				The tuning table is a text file with one entry per line:
+ *					element_size n cores num_of_pakets buffered sequential
+ *				It is read from the file named by the environment variable
+ *				MALMS_TUNING_FILE, or from ~/.malms_tuning.
+ *
+ */
+
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstddef>
+#include <unistd.h>
+
+#include "threadpool/maleablescheduler.h"
+#include "threadpool/workqueue.h"
+
+// inputs of at most this many times the L1 data cache are sorted sequentially
+#define TUNING_SEQUENTIAL_L1 2
+// the pakets per core for inputs larger than the last level cache
+#define TUNING_PAKETS_PER_CORE_LARGE 2
+// the merge is buffered if the parts of the sequences are smaller than this
+#define TUNING_BUFFERED_PART_BYTES 4096
+// the file name of the tuning table in the home directory
+#define TUNING_FILE_NAME ".malms_tuning"
+
+namespace malms {
+
+namespace Tuning {
+
+/*
+ * The data cache sizes in bytes of the first core.
+ */
+struct CacheSizes {
+	std::size_t l1;
+	std::size_t l2;
+	std::size_t l3;
+};
+
+/*
+ * Parses a size of sysfs like "48K" or "32M".
+ */
+inline std::size_t parse_size(const std::string& s) {
+	std::size_t size = std::strtoul(s.c_str(), NULL, 10);
+	if (s.find('K') != std::string::npos) size <<= 10;
+	if (s.find('M') != std::string::npos) size <<= 20;
+	if (s.find('G') != std::string::npos) size <<= 30;
+	return size;
+}
+
+/*
+ * Reads the cache sizes of cpu0 from /sys/devices/system/cpu/cpu0/cache, the
+ * instruction caches are skipped. Sizes that sysfs does not provide are taken
+ * from sysconf, or default to 32 KB, 256 KB and 8 MB.
+ */
+inline CacheSizes read_cache_sizes() {
+	CacheSizes c = {0, 0, 0};
+	for (int index = 0; ; index++) {
+		std::ostringstream dir;
+		dir << "/sys/devices/system/cpu/cpu0/cache/index" << index << "/";
+		std::ifstream level_file((dir.str() + "level").c_str());
+		std::ifstream type_file((dir.str() + "type").c_str());
+		std::ifstream size_file((dir.str() + "size").c_str());
+		int level;
+		std::string type, size;
+		if (!(level_file >> level) || !(type_file >> type) || !(size_file >> size)) break;
+		if (type == "Instruction") continue;
+		if (level == 1) c.l1 = parse_size(size);
+		if (level == 2) c.l2 = parse_size(size);
+		if (level == 3) c.l3 = parse_size(size);
+	}
+	#ifdef _SC_LEVEL1_DCACHE_SIZE
+	if (c.l1 == 0 && sysconf(_SC_LEVEL1_DCACHE_SIZE) > 0) c.l1 = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+	if (c.l2 == 0 && sysconf(_SC_LEVEL2_CACHE_SIZE) > 0) c.l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+	if (c.l3 == 0 && sysconf(_SC_LEVEL3_CACHE_SIZE) > 0) c.l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+	#endif
+	if (c.l1 == 0) c.l1 = 32 << 10;
+	if (c.l2 == 0) c.l2 = 256 << 10;
+	if (c.l3 == 0) c.l3 = 8 << 20;
+	return c;
+}
+
+/*
+ * Returns the cache sizes, read once.
+ */
+inline const CacheSizes& cache_sizes() {
+	static CacheSizes sizes = read_cache_sizes();
+	return sizes;
+}
+
+/*
+ * The parameters of one sort call.
+ */
+struct Parameters {
+	unsigned int num_of_pakets;
+	bool buffered_merge;
+	bool sequential;
+};
+
+/*
+ * One entry of the tuning table: the best parameters measured for n elements
+ * of element_size bytes on the given number of cores.
+ */
+struct TableEntry {
+	std::size_t element_size;
+	std::size_t n;
+	unsigned int cores;
+	Parameters parameters;
+};
+
+/*
+ * The tuning table. lookup() returns the entry of the element size whose n is
+ * the closest to the requested n on a logarithmic scale, with the number of
+ * pakets scaled to the requested number of cores.
+ */
+class TuningTable {
+	private:
+		std::vector<TableEntry> entries;
+
+		// the distance of a and b on a logarithmic scale, as their ratio
+		static double logDistance(std::size_t a, std::size_t b) {
+			a = std::max<std::size_t>(a, 1);
+			b = std::max<std::size_t>(b, 1);
+			return (a > b) ? static_cast<double>(a) / b : static_cast<double>(b) / a;
+		}
+
+	public:
+		bool empty() const {
+			return entries.empty();
+		}
+
+		void clear() {
+			entries.clear();
+		}
+
+		void add(const TableEntry& entry) {
+			entries.push_back(entry);
+		}
+
+		std::size_t size() const {
+			return entries.size();
+		}
+
+		const TableEntry& entry(std::size_t i) const {
+			return entries[i];
+		}
+
+		/*
+		 * Reads the entries of the file, returns false if it can not be read.
+		 */
+		bool load(const std::string& path) {
+			std::ifstream in(path.c_str());
+			if (!in) return false;
+			std::string line;
+			while (std::getline(in, line)) {
+				if (line.empty() || line[0] == '#') continue;
+				std::istringstream fields(line);
+				TableEntry e;
+				if (fields >> e.element_size >> e.n >> e.cores >> e.parameters.num_of_pakets >> e.parameters.buffered_merge >> e.parameters.sequential) {
+					entries.push_back(e);
+				}
+			}
+			return true;
+		}
+
+		/*
+		 * Writes the entries to the file, returns false if it can not be written.
+		 */
+		bool save(const std::string& path) const {
+			std::ofstream out(path.c_str());
+			if (!out) return false;
+			out << "# malms tuning table: element_size n cores num_of_pakets buffered sequential" << std::endl;
+			for (std::size_t i = 0; i < entries.size(); i++) {
+				const TableEntry& e = entries[i];
+				out << e.element_size << " " << e.n << " " << e.cores << " " << e.parameters.num_of_pakets << " "
+				    << e.parameters.buffered_merge << " " << e.parameters.sequential << std::endl;
+			}
+			return static_cast<bool>(out);
+		}
+
+		/*
+		 * Sets p to the parameters for n elements of element_size bytes on the
+		 * given cores, returns false if there is no entry for the element size.
+		 */
+		bool lookup(std::size_t element_size, std::size_t n, unsigned int cores, Parameters& p) const {
+			const TableEntry* best = NULL;
+			for (std::size_t i = 0; i < entries.size(); i++) {
+				const TableEntry& e = entries[i];
+				if (e.element_size != element_size) continue;
+				if (best == NULL || logDistance(e.n, n) < logDistance(best->n, n)) best = &e;
+			}
+			if (best == NULL) return false;
+			p = best->parameters;
+			p.num_of_pakets = std::max(1u, p.num_of_pakets * cores / std::max(1u, best->cores));
+			return true;
+		}
+};
+
+/*
+ * Returns the path of the tuning table: $MALMS_TUNING_FILE, or ~/.malms_tuning.
+ */
+inline std::string default_path() {
+	const char* path = std::getenv("MALMS_TUNING_FILE");
+	if (path != NULL) return path;
+	const char* home = std::getenv("HOME");
+	return std::string(home != NULL ? home : ".") + "/" + TUNING_FILE_NAME;
+}
+
+inline TuningTable load_default_table() {
+	TuningTable t;
+	t.load(default_path());
+	return t;
+}
+
+/*
+ * Returns the tuning table, which is loaded from default_path() on the first
+ * call. The table is empty if there is no file.
+ */
+inline TuningTable& table() {
+	static TuningTable t = load_default_table();
+	return t;
+}
+
+/*
+ * Derives the parameters from the cache sizes: inputs that fit into a few L1
+ * caches are sorted sequentially. Otherwise each core gets one paket, or
+ * TUNING_PAKETS_PER_CORE_LARGE pakets for inputs larger than the last level
+ * cache, so that the pakets can be balanced when cores are taken away, but no
+ * run is smaller than the L1 cache. The merge is buffered if the parts of the
+ * k sequences of a merge paket are smaller than a page.
+ */
+inline Parameters heuristic(std::size_t n, std::size_t element_size, unsigned int cores) {
+	const CacheSizes& cache = cache_sizes();
+	std::size_t bytes = n * element_size;
+	Parameters p;
+	p.sequential = bytes <= TUNING_SEQUENTIAL_L1 * cache.l1;
+	std::size_t k = std::max(1u, cores);
+	if (bytes > cache.l3) k *= TUNING_PAKETS_PER_CORE_LARGE;
+	k = std::max<std::size_t>(1, std::min(k, bytes / cache.l1));
+	p.num_of_pakets = k;
+	p.buffered_merge = k > 1 && bytes / (k * k) < TUNING_BUFFERED_PART_BYTES;
+	return p;
+}
+
+/*
+ * Returns the parameters for sorting n elements of _ValueType on the given
+ * number of cores, from the tuning table if it has entries for the element
+ * size, otherwise from heuristic().
+ */
+template<typename _ValueType>
+Parameters choose(std::size_t n, unsigned int cores) {
+	Parameters p;
+	if (table().lookup(sizeof(_ValueType), n, cores, p)) return p;
+	return heuristic(n, sizeof(_ValueType), cores);
+}
+
+/*
+ * Returns the number of cores the job is currently scheduled on, at least 1.
+ */
+inline unsigned int job_cores(Scheduler::WorkQueue* queue) {
+	int cores = Scheduler::MaleableScheduler::singleton()->coresOfJob(queue);
+	return (cores > 0) ? cores : 1;
+}
+
+} // namespace Tuning
+
+} // namespace malms
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ *  Workpaket for splitting between already computed splitters.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the class BatchSplitPaket which implements the
+ *				Workpaket Interface. The pakets of one sort form a binary tree
+ *				over the rows of the splitter matrix: each paket computes its
+ *				row only between the rows of its bounds and then pushes its
+ *				children, whose bounds include the row just computed. So all
+ *				k-1 rows are found by a recursive bisection in which each
+ *				selection searches a smaller range than the one before.
+ *
+ */
+
+#ifndef BATCH_SPLIT_PAKET_H
+#define BATCH_SPLIT_PAKET_H
+
+#include <iterator>
+#include "workpaket.h"
+#include "median_split.h"
+#include "threadpool/workqueue.h"
+
+namespace malms {
+
+/*
+ * Implements the Workpaket Interface. The constructor takes the splitter
+ * matrix, the row to compute and the rows bounding it, the number of elements
+ * before each row, the scratch space, and the queue for the children. The ()
+ * operator computes the row and pushes the children set with setChildren().
+ * With _Stable, equal elements are split in the order of their sequences.
+ */
+template<typename _RandomAccessIterator, bool _Stable = false>
+class BatchSplitPaket : public Workpaket {
+	private:
+		// typedefs
+		typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type _Distance;
+		typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
+
+		// attributes
+		_RandomAccessIterator** splitters;
+		int num_of_pakets;
+		int row;
+		int lower;
+		int upper;
+		// row_prefix[i] is the number of elements before row i
+		const _Distance* row_prefix;
+		// scratch space of num_of_pakets+16 elements
+		Splitting::PartitionElement<_ValueType>* scratch;
+		// the pakets computing rows between lower and row, and row and upper
+		BatchSplitPaket* children[2];
+		Scheduler::WorkQueue* queue;
+
+	public:
+		/*
+		 * Computes the splitters of the row between the bounding rows and
+		 * pushes the children, which now have both of their bounds.
+		 */
+		void operator()() {
+			Splitting::reduce_split_between<_Stable>(splitters[lower], splitters[upper], splitters[row], num_of_pakets,
+			                                         row_prefix[row] - row_prefix[lower], scratch);
+			for (int i = 0; i < 2; i++) {
+				if (children[i] != NULL) queue->push(children[i]);
+			}
+		}
+
+		/*
+		 * Sets the pakets which are pushed once this row is computed.
+		 */
+		void setChildren(BatchSplitPaket* left, BatchSplitPaket* right) {
+			children[0] = left;
+			children[1] = right;
+		}
+
+		/*
+		 * Returns the rows bounding the search of this paket.
+		 */
+		int lowerRow() const {
+			return lower;
+		}
+
+		int upperRow() const {
+			return upper;
+		}
+
+		/*
+		 * Constructor initializes the splitting attributes.
+		 */
+		BatchSplitPaket(_RandomAccessIterator** splitters, int num_of_pakets, int row, int lower, int upper, const _Distance* row_prefix,
+		                Splitting::PartitionElement<_ValueType>* scratch, Scheduler::WorkQueue* queue) {
+			this->splitters = splitters;
+			this->num_of_pakets = num_of_pakets;
+			this->row = row;
+			this->lower = lower;
+			this->upper = upper;
+			this->row_prefix = row_prefix;
+			this->scratch = scratch;
+			this->children[0] = NULL;
+			this->children[1] = NULL;
+			this->queue = queue;
+		}
+};
+
+
+} // namespace
+
+#endif
@@ -0,0 +1,164 @@
+/*
+ *  Workpaket for merging into recycled blocks.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the class BlockMergePaket which implements the
+ *				Workpaket Interface. It merges the parts of all runs between
+ *				two rows of splitters like the MergePaket, but writes the output
+ *				into fixed-size blocks taken from a BlockPool and returns the
+ *				input blocks to the pool as soon as they are consumed. This is
+ *				the merge of the memory-bounded mergesort (see sort_bounded).
+ *
+ */
+
+#ifndef BLOCK_MERGE_PAKET_H
+#define BLOCK_MERGE_PAKET_H
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include "workpaket.h"
+#include "block_pool.h"
+#include "loser_tree.h"
+
+namespace malms {
+
+/*
+ * The part of one run that is merged by a BlockMergePaket, given as three
+ * consecutive segments: the head fragment (copied into the extra memory), the
+ * full blocks in the input sequence and the tail fragment (also copied).
+ * Each segment may be empty.
+ */
+template<typename _ValueType>
+struct BlockRun {
+	_ValueType* begin[3];
+	_ValueType* end[3];
+};
+
+/*
+ * Implements the Workpaket Interface. The constructor takes the num_of_pakets
+ * BlockRuns of this paket, the block size, the pool of free blocks and the
+ * table of target blocks, and the range [out_begin,out_end) of the output
+ * given as offsets into the sorted sequence.
+ * The () operator merges the runs. Target block t of the sorted sequence is
+ * written into block_source[t]; if that is NULL, a block is taken from the pool.
+ * Blocks that are shared with the neighbouring pakets must be assigned before
+ * the pakets are started.
+ */
+template<typename _ValueType, typename _Distance>
+class BlockMergePaket : public Workpaket {
+	private:
+		// attributes
+		BlockRun<_ValueType>* runs;
+		unsigned int num_of_pakets;
+		_Distance block_size;
+		BlockPool<_ValueType>* pool;
+		_ValueType** block_source;
+		_Distance out_begin;
+		_Distance out_end;
+
+		/*
+		 * Starts reading run j at the first non-empty segment from segment s
+		 * on. Returns false if the run is exhausted.
+		 */
+		bool startSegment(unsigned int j, unsigned int s, unsigned int* segment, _ValueType** cur, _ValueType** last, _ValueType** free_at) {
+			for (; s < 3; s++) {
+				if (runs[j].begin[s] != runs[j].end[s]) {
+					segment[j] = s;
+					cur[j] = runs[j].begin[s];
+					last[j] = runs[j].end[s];
+					// only the blocks of the middle segment are returned to the pool
+					free_at[j] = (s == 1) ? cur[j] + block_size : NULL;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/*
+		 * Gets the block for the output position pos.
+		 */
+		void nextOutputBlock(_Distance pos, _ValueType*& out, _ValueType*& out_block_end) {
+			_Distance t = pos / block_size;
+			_ValueType* block = block_source[t];
+			if (block == NULL) {
+				block = pool->pop();
+				block_source[t] = block;
+			}
+			out = block + (pos - t*block_size);
+			out_block_end = block + (std::min((t+1)*block_size, out_end) - t*block_size);
+		}
+
+	public:
+		/*
+		 * Merges the runs using the loser tree.
+		 */
+		void operator()() {
+			unsigned int k = num_of_pakets;
+			if (out_begin == out_end) return;
+
+			std::vector<unsigned int> segment(k);
+			std::vector<_ValueType*> cur(k);
+			std::vector<_ValueType*> last(k);
+			std::vector<_ValueType*> free_at(k);
+
+			Merging::LoserTree<_ValueType> lt(k);
+
+			// start all runs and fill the loser tree
+			unsigned int sequences_left = 0;
+			for (unsigned int j = 0; j < k; j++) {
+				if (startSegment(j, 0, &segment[0], &cur[0], &last[0], &free_at[0])) {
+					lt.insertStart(*cur[j], j);
+					sequences_left++;
+				} else {
+					lt.insertExhausted(j);
+				}
+			}
+			lt.init();
+
+			_Distance pos = out_begin;
+			_ValueType* out = NULL;
+			_ValueType* out_block_end = NULL;
+			while (sequences_left > 0) {
+				unsigned int min_i = lt.minSource();
+				if (out == out_block_end) {
+					nextOutputBlock(pos, out, out_block_end);
+				}
+				*out = lt.minKey();
+				++out;
+				++pos;
+				++cur[min_i];
+				// return consumed input blocks
+				if (cur[min_i] == free_at[min_i]) {
+					pool->push(cur[min_i] - block_size);
+					free_at[min_i] += block_size;
+				}
+				if (cur[min_i] == last[min_i] && !startSegment(min_i, segment[min_i]+1, &segment[0], &cur[0], &last[0], &free_at[0])) {
+					lt.exhaustMin();
+					sequences_left--;
+				} else {
+					lt.replaceMin(*cur[min_i]);
+				}
+			}
+		}
+
+		/*
+		 * Constructor initializes the merging attributes.
+		 */
+		BlockMergePaket(BlockRun<_ValueType>* runs, unsigned int num_of_pakets, _Distance block_size, BlockPool<_ValueType>* pool, _ValueType** block_source, _Distance out_begin, _Distance out_end) {
+			this->runs = runs;
+			this->num_of_pakets = num_of_pakets;
+			this->block_size = block_size;
+			this->pool = pool;
+			this->block_source = block_source;
+			this->out_begin = out_begin;
+			this->out_end = out_end;
+		}
+};
+
+} // namespace
+
+#endif
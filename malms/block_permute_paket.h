@@ -0,0 +1,72 @@
+/*
+ *  Workpaket for moving blocks into their final position.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the class BlockPermutePaket which implements the
+ *				Workpaket Interface. It executes a list of block moves, which
+ *				together form complete paths or cycles of the block permutation
+ *				at the end of the memory-bounded mergesort.
+ *				
+ */
+
+#ifndef BLOCK_PERMUTE_PAKET_H
+#define BLOCK_PERMUTE_PAKET_H
+
+#include <algorithm>
+#include <cstddef>
+#include "workpaket.h"
+
+namespace malms {
+
+/*
+ * Moves len elements from src to dst. A NULL pointer stands for the temporary
+ * block of the executing paket, which is used to break cycles.
+ */
+template<typename _ValueType, typename _Distance>
+struct BlockMove {
+	_ValueType* dst;
+	_ValueType* src;
+	_Distance len;
+};
+
+/*
+ * Implements the Workpaket Interface. The constructor takes the range of moves
+ * [first,last) and a temporary block. The () operator executes the moves in
+ * order. The moves of different pakets must touch disjoint blocks.
+ */
+template<typename _ValueType, typename _Distance>
+class BlockPermutePaket : public Workpaket {
+	private:
+		// attributes
+		const BlockMove<_ValueType,_Distance>* first;
+		const BlockMove<_ValueType,_Distance>* last;
+		_ValueType* temp;
+		
+	public:
+		/*
+		 * Executes the moves [first,last).
+		 */
+		void operator()() {
+			for (const BlockMove<_ValueType,_Distance>* m = first; m != last; ++m) {
+				_ValueType* src = (m->src == NULL) ? temp : m->src;
+				_ValueType* dst = (m->dst == NULL) ? temp : m->dst;
+				std::copy(src, src + m->len, dst);
+			}
+		}
+		
+		/*
+		 * Constructor initializes the move range and the temporary block.
+		 */
+		BlockPermutePaket(const BlockMove<_ValueType,_Distance>* first, const BlockMove<_ValueType,_Distance>* last, _ValueType* temp) {
+			this->first = first;
+			this->last = last;
+			this->temp = temp;
+		}
+};
+
+} // namespace
+
+#endif
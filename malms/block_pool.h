@@ -0,0 +1,80 @@
+/*
+ *  Pool of free memory blocks for the memory-bounded mergesort.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the class BlockPool, a synchronized stack of free
+ *				blocks of block_size elements. The blocks are either part of
+ *				the input sequence, which become free once their elements have
+ *				been merged, or part of the extra memory of the sort.
+ *
+ */
+
+#ifndef BLOCK_POOL_H
+#define BLOCK_POOL_H
+
+#include <vector>
+#include <cstddef>
+#include <boost/thread.hpp>
+
+namespace malms {
+
+/*
+ * A synchronized stack of pointers to free blocks. All blocks have the same
+ * size, which is not stored by the pool.
+ */
+template<typename _ValueType>
+class BlockPool {
+	private:
+		boost::mutex mut;
+		std::vector<_ValueType*> free_blocks;
+
+		// non copyable
+		BlockPool(const BlockPool&);
+		BlockPool& operator=(const BlockPool&);
+
+	public:
+		BlockPool() {
+		}
+
+		/*
+		 * Reserves space for num_blocks free blocks, so that push() does
+		 * not allocate.
+		 */
+		void reserve(std::size_t num_blocks) {
+			free_blocks.reserve(num_blocks);
+		}
+
+		/*
+		 * Returns a block to the pool.
+		 */
+		void push(_ValueType* block) {
+			boost::lock_guard<boost::mutex> lock(mut);
+			free_blocks.push_back(block);
+		}
+
+		/*
+		 * Takes a free block from the pool, returns NULL if the pool is empty.
+		 */
+		_ValueType* pop() {
+			boost::lock_guard<boost::mutex> lock(mut);
+			if (free_blocks.empty()) return NULL;
+			_ValueType* block = free_blocks.back();
+			free_blocks.pop_back();
+			return block;
+		}
+
+		/*
+		 * Returns the number of free blocks.
+		 */
+		std::size_t size() {
+			boost::lock_guard<boost::mutex> lock(mut);
+			return free_blocks.size();
+		}
+};
+
+} // namespace
+
+#endif
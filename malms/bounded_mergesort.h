@@ -0,0 +1,341 @@
+/*
+ *  Implements the memory-bounded maleable mergesort algorithm.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				This file implements malms::sort_bounded, a variant of the
+ *				maleable multiway mergesort that uses at most a given number of
+ *				extra elements of memory instead of a buffer of n elements.
+ *				The runs are sorted in place, the merge writes into fixed-size
+ *				blocks that are recycled from the consumed input, and a final
+ *				block permutation moves the blocks into their position.
+ *
+ */
+
+#ifndef BOUNDED_MERGESORT_H
+#define BOUNDED_MERGESORT_H
+
+#include <algorithm>
+#include <vector>
+#include <iterator>
+#include <functional>
+#include <cmath>
+
+#include "threadpool/workqueue.h"
+#include "threadpool_mergesort.h"
+#include "inplace_sort_paket.h"
+#include "split_paket.h"
+#include "copy_paket.h"
+#include "block_pool.h"
+#include "block_merge_paket.h"
+#include "block_permute_paket.h"
+
+// blocks smaller than this are avoided by using fewer pakets
+#define BOUNDED_MIN_BLOCK_SIZE 16
+
+namespace malms {
+
+/*
+ * Returns the bytes of bookkeeping of sort_bounded for each block: the pool,
+ * the source, the inverse, 1.5 moves and the chain start of the block
+ * permutation, and two bits.
+ */
+template<typename _ValueType, typename _Distance>
+std::size_t bounded_block_bytes() {
+	return 2*sizeof(_ValueType*) + sizeof(_Distance) + 3*sizeof(BlockMove<_ValueType,_Distance>)/2 + sizeof(std::size_t) + 1;
+}
+
+/*
+ * Returns the bytes of bookkeeping of sort_bounded for k pakets apart from
+ * the blocks: the splitters, the parts of the runs and the pakets.
+ */
+template<typename _ValueType, typename _Distance>
+std::size_t bounded_paket_bytes(std::size_t k) {
+	return (k+1)*(k+1)*sizeof(_ValueType*) + 2*(k+1)*sizeof(_Distance)
+	     + k*(k+16)*sizeof(Splitting::PartitionElement<_ValueType>)
+	     + k*k*(sizeof(BlockRun<_ValueType>) + 2*sizeof(CopyPaket<_ValueType*,_ValueType*>))
+	     + k*(k+2)*sizeof(_ValueType*) + k*k*(sizeof(unsigned int) + 3*sizeof(_ValueType*))
+	     + k*(sizeof(InplaceSortPaket<_ValueType*>) + sizeof(SplitPaket<_ValueType*>)
+	          + sizeof(BlockMergePaket<_ValueType,_Distance>) + sizeof(BlockPermutePaket<_ValueType,_Distance>))
+	     + sizeof(BlockMove<_ValueType,_Distance>);
+}
+
+/*
+ * Returns the largest block size B for which the (2k+1)(k+1) blocks of the
+ * extra memory and the bookkeeping of k pakets and of the n/B blocks fit into
+ * extra_elements elements, 0 if there is none.
+ */
+template<typename _ValueType, typename _Distance>
+_Distance bounded_block_size(_Distance n, std::size_t k, _Distance extra_elements) {
+	long double block = bounded_block_bytes<_ValueType,_Distance>();
+	long double budget = static_cast<long double>(extra_elements) * sizeof(_ValueType)
+	                   - bounded_paket_bytes<_ValueType,_Distance>(k) - block;
+	long double c = static_cast<long double>((2*k+1)*(k+1)) * sizeof(_ValueType);
+	// c*B + block*n/B <= budget, the larger root of the quadratic
+	long double disc = budget*budget - 4*c*block*n;
+	if (budget <= 0 || disc < 0) return 0;
+	_Distance B = static_cast<_Distance>((budget + std::sqrt(disc)) / (2*c));
+	// rounding, with the number of blocks rounded up
+	while (B > 0 && c*B + block*((n + B - 1) / B) > budget) B--;
+	return B;
+}
+
+/*
+ * The memory-bounded Mergesort function, sorting the sequence given by
+ * [begin,end) using num_of_pakets pakets in each step and the workqueue given
+ * by queue, with at most extra_elements elements of extra memory, including
+ * the bookkeeping of the blocks and the pakets. The sequence must be stored
+ * contiguously (e.g. a std::vector).
+ *
+ * The runs are aligned to blocks of B elements and are sorted in place, B is
+ * the largest size for which the (2k+1)(k+1) blocks of extra memory and the
+ * bookkeeping of the n/B blocks fit into the budget. After splitting, all
+ * blocks that are not completely inside the part of one merge paket contain a
+ * splitter, there are at most k(k-1)+1 of them. Their elements (the fragments) are copied into the extra memory and
+ * the blocks are put into the pool of free blocks, together with k(k+2) blocks
+ * of the extra memory. Each merge paket takes its output blocks from the pool
+ * and returns its input blocks once consumed, which keeps the pool from running
+ * empty. In the end, the blocks are moved into their position by following the
+ * paths and cycles of the block permutation, using one more block per paket.
+ *
+ * If the budget is at least n, malms::sort is used. If it is too small for
+ * num_of_pakets pakets, fewer pakets are used, with a single paket the
+ * sequence is only sorted in place.
+ */
+template<typename _RandomAccessIterator>
+void sort_bounded(_RandomAccessIterator begin,_RandomAccessIterator end, unsigned int num_of_pakets, Scheduler::WorkQueue* queue,
+                  typename std::iterator_traits<_RandomAccessIterator>::difference_type extra_elements) {
+	typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type _Distance;
+	typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
+	typedef BlockMove<_ValueType,_Distance> _BlockMove;
+
+	_Distance n = end - begin;
+	if (n == 0) return;
+	if (extra_elements >= n) {
+		sort(begin, end, num_of_pakets, queue);
+		return;
+	}
+
+	// choose the block size, reducing the number of pakets for small budgets,
+	// a single paket needs no blocks
+	unsigned int k = num_of_pakets;
+	_Distance B = n;
+	for (; k > 1; k--) {
+		_Distance size = bounded_block_size<_ValueType,_Distance>(n, k, extra_elements);
+		if (size >= BOUNDED_MIN_BLOCK_SIZE) {
+			B = size;
+			break;
+		}
+	}
+	_Distance num_blocks = (n + B - 1) / B;
+
+	_ValueType* base = &(*begin);
+	std::less<_ValueType*> ptr_less;
+
+	/* sort the runs in place, each run consists of whole blocks */
+
+	std::vector<_Distance> run_begin(k+1);
+	_Distance blocks = 0;
+	for (unsigned int j = 0; j < k; j++) {
+		run_begin[j] = std::min(blocks * B, n);
+		blocks += paket_size(num_blocks, k, j);
+	}
+	run_begin[k] = n;
+
+	std::vector<InplaceSortPaket<_ValueType*> > sort_pakets;
+	sort_pakets.reserve(k);
+	for (unsigned int j = 0; j < k; j++) {
+		sort_pakets.push_back(InplaceSortPaket<_ValueType*>(base + run_begin[j], base + run_begin[j+1]));
+		queue->push(&sort_pakets.back());
+	}
+	queue->blockuntildone();
+
+	if (k == 1) return;
+
+	/* split, the merge paket i outputs [out_begin[i],out_begin[i+1]) */
+
+	std::vector<_Distance> out_begin(k+1);
+	out_begin[0] = 0;
+	for (unsigned int i = 0; i < k; i++) {
+		out_begin[i+1] = out_begin[i] + paket_size(n, k, i);
+	}
+
+	std::vector<_ValueType*> splitter_matrix((k+1)*k);
+	std::vector<_ValueType**> splitters(k+1);
+	for (unsigned int i = 0; i < k+1; i++) {
+		splitters[i] = &splitter_matrix[i*k];
+	}
+	for (unsigned int j = 0; j < k; j++) {
+		splitters[0][j] = base + run_begin[j];
+		splitters[k][j] = base + run_begin[j+1];
+	}
+
+	std::vector<Splitting::PartitionElement<_ValueType> > split_scratch(k*(k+16));
+	std::vector<SplitPaket<_ValueType*> > split_pakets;
+	split_pakets.reserve(k);
+	for (unsigned int i = 0; i < k-1; i++) {
+		split_pakets.push_back(SplitPaket<_ValueType*>(&splitters[0], k, i, out_begin[i+1], &split_scratch[i*(k+16)]));
+		queue->push(&split_pakets.back());
+	}
+	queue->blockuntildone();
+
+	/* cut the part of each run into fragments and full blocks */
+
+	std::vector<BlockRun<_ValueType> > runs(k*k);
+	std::vector<bool> full_block(num_blocks, false);
+	_Distance fragments_size = 0;
+	for (unsigned int i = 0; i < k; i++) {
+		for (unsigned int j = 0; j < k; j++) {
+			BlockRun<_ValueType>& r = runs[i*k+j];
+			_ValueType* lo = splitters[i][j];
+			_ValueType* hi = splitters[i+1][j];
+			_ValueType* a = base + ((lo - base + B - 1) / B) * B;
+			_ValueType* b = base + ((hi - base) / B) * B;
+			if (ptr_less(a, b)) {
+				r.begin[0] = lo; r.end[0] = a;
+				r.begin[1] = a;  r.end[1] = b;
+				r.begin[2] = b;  r.end[2] = hi;
+				for (_Distance t = (a - base) / B; t < (b - base) / B; t++) {
+					full_block[t] = true;
+				}
+			} else {
+				r.begin[0] = lo; r.end[0] = hi;
+				r.begin[1] = hi; r.end[1] = hi;
+				r.begin[2] = hi; r.end[2] = hi;
+			}
+			fragments_size += (r.end[0] - r.begin[0]) + (r.end[2] - r.begin[2]);
+		}
+	}
+
+	// extra memory: the fragments, the pool blocks and a temporary block per paket
+	const _Distance pool_blocks = k*(k+2);
+	_ValueType* extra = static_cast<_ValueType*>(::operator new(sizeof(_ValueType) * (fragments_size + (pool_blocks + k) * B)));
+	_ValueType* fragments = extra;
+	_ValueType* temp_blocks = extra + fragments_size + pool_blocks * B;
+
+	// copy the fragments and let the runs read them from the extra memory
+	std::vector<CopyPaket<_ValueType*,_ValueType*> > copy_pakets;
+	copy_pakets.reserve(2*k*k);
+	_ValueType* frag_pos = fragments;
+	for (unsigned int r = 0; r < k*k; r++) {
+		for (unsigned int s = 0; s < 3; s += 2) {
+			_Distance len = runs[r].end[s] - runs[r].begin[s];
+			if (len == 0) continue;
+			copy_pakets.push_back(CopyPaket<_ValueType*,_ValueType*>(runs[r].begin[s], runs[r].end[s], frag_pos));
+			queue->push(&copy_pakets.back());
+			runs[r].begin[s] = frag_pos;
+			runs[r].end[s] = frag_pos + len;
+			frag_pos += len;
+		}
+	}
+	queue->blockuntildone();
+
+	// fill the pool with the blocks that held fragments and the extra blocks,
+	// a partial last block is too small to be used
+	BlockPool<_ValueType> pool;
+	pool.reserve(num_blocks + pool_blocks);
+	for (_Distance t = 0; t < num_blocks; t++) {
+		if (!full_block[t] && (t+1)*B <= n) {
+			pool.push(base + t*B);
+		}
+	}
+	for (_Distance t = 0; t < pool_blocks; t++) {
+		pool.push(fragments + fragments_size + t*B);
+	}
+
+	/* merge into blocks */
+
+	// target blocks shared between two pakets are assigned up front
+	std::vector<_ValueType*> block_source(num_blocks, static_cast<_ValueType*>(NULL));
+	for (unsigned int i = 1; i < k; i++) {
+		_Distance t = out_begin[i] / B;
+		if (out_begin[i] % B != 0 && block_source[t] == NULL) {
+			block_source[t] = pool.pop();
+		}
+	}
+
+	std::vector<BlockMergePaket<_ValueType,_Distance> > merge_pakets;
+	merge_pakets.reserve(k);
+	for (unsigned int i = 0; i < k; i++) {
+		merge_pakets.push_back(BlockMergePaket<_ValueType,_Distance>(&runs[i*k], k, B, &pool, &block_source[0], out_begin[i], out_begin[i+1]));
+		queue->push(&merge_pakets.back());
+	}
+	queue->blockuntildone();
+
+	/* permute the blocks into their position */
+
+	// inverse[b]: the target block whose elements are stored in input block b
+	std::vector<_Distance> inverse(num_blocks, -1);
+	for (_Distance t = 0; t < num_blocks; t++) {
+		_ValueType* src = block_source[t];
+		if (!ptr_less(src, base) && ptr_less(src, base + n)) {
+			inverse[(src - base) / B] = t;
+		}
+	}
+
+	std::vector<_BlockMove> moves;
+	moves.reserve(num_blocks + num_blocks/2 + 1);
+	// each path has at least one block and each cycle at least two
+	std::vector<std::size_t> chain_begin;
+	chain_begin.reserve(num_blocks + 1);
+	std::vector<bool> done(num_blocks, false);
+	for (_Distance t = 0; t < num_blocks; t++) {
+		if (block_source[t] == base + t*B) done[t] = true;
+	}
+
+	// paths start at blocks that hold no elements and end at extra blocks
+	for (_Distance t = 0; t < num_blocks; t++) {
+		if (done[t] || inverse[t] != -1) continue;
+		chain_begin.push_back(moves.size());
+		_Distance cur = t;
+		while (true) {
+			_ValueType* src = block_source[cur];
+			_BlockMove m = {base + cur*B, src, std::min(B, n - cur*B)};
+			moves.push_back(m);
+			done[cur] = true;
+			if (ptr_less(src, base) || !ptr_less(src, base + n)) break;
+			cur = (src - base) / B;
+		}
+	}
+
+	// the remaining blocks form cycles, which are broken with the temporary block
+	for (_Distance t = 0; t < num_blocks; t++) {
+		if (done[t]) continue;
+		chain_begin.push_back(moves.size());
+		_BlockMove save = {NULL, base + t*B, B};
+		moves.push_back(save);
+		_Distance cur = t;
+		while (true) {
+			_Distance next = (block_source[cur] - base) / B;
+			_BlockMove m = {base + cur*B, (next == t) ? NULL : block_source[cur], B};
+			moves.push_back(m);
+			done[cur] = true;
+			if (next == t) break;
+			cur = next;
+		}
+	}
+	chain_begin.push_back(moves.size());
+
+	// distribute whole chains evenly over the pakets
+	std::vector<BlockPermutePaket<_ValueType,_Distance> > permute_pakets;
+	permute_pakets.reserve(k);
+	std::size_t c = 0;
+	for (unsigned int i = 0; i < k && c+1 < chain_begin.size(); i++) {
+		std::size_t first = chain_begin[c];
+		std::size_t target = (moves.size() * (i+1)) / k;
+		while (c+1 < chain_begin.size() && (chain_begin[c+1] <= target || i == k-1 || chain_begin[c] == first)) {
+			c++;
+		}
+		permute_pakets.push_back(BlockPermutePaket<_ValueType,_Distance>(&moves[0] + first, &moves[0] + chain_begin[c], temp_blocks + i*B));
+		queue->push(&permute_pakets.back());
+	}
+	queue->blockuntildone();
+
+	::operator delete(extra);
+}
+
+} // namespace
+
+#endif
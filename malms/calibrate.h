@@ -0,0 +1,126 @@
+/*
+ *  Calibration of the tuning table.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Measures the parameters of malms::sort for a range of input
+ *				sizes on this machine and stores the fastest ones in a tuning
+ *				table (see autotune.h), which sort calls without a number of
+ *				pakets use in later runs.
+ *
+ */
+
+#ifndef CALIBRATE_H
+#define CALIBRATE_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstddef>
+#include <time.h>
+
+#include "threadpool_mergesort.h"
+#include "autotune.h"
+
+// the smallest input size that is calibrated
+#define CALIBRATE_MIN_N (1 << 10)
+// each configuration is sorted until at least this many elements were sorted
+#define CALIBRATE_ELEMENTS (1 << 22)
+// the largest number of pakets per core that is tried
+#define CALIBRATE_MAX_PAKETS_PER_CORE 8
+
+namespace malms {
+
+namespace Tuning {
+
+inline double seconds_now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Returns the smallest time of sorting copies of input with the parameters,
+ * over enough repetitions to sort CALIBRATE_ELEMENTS elements. malms::sort
+ * reuses one context, which is warmed up by an untimed sort, so that neither
+ * sort is timed with the allocation and the first touch of its memory.
+ */
+template<typename _ValueType>
+double time_parameters(const std::vector<_ValueType>& input, const Parameters& p, Scheduler::WorkQueue* queue) {
+	std::size_t n = input.size();
+	std::size_t repetitions = std::max<std::size_t>(1, CALIBRATE_ELEMENTS / n);
+	std::vector<_ValueType> data(input);
+	SortContext<typename std::vector<_ValueType>::iterator> context;
+	context.setBufferedMerge(p.buffered_merge);
+	if (!p.sequential) {
+		sort(data.begin(), data.end(), p.num_of_pakets, queue, context);
+	}
+	double best = -1;
+	for (std::size_t r = 0; r < repetitions; r++) {
+		std::copy(input.begin(), input.end(), data.begin());
+		double start = seconds_now();
+		if (p.sequential) {
+			std::sort(data.begin(), data.end());
+		} else {
+			sort(data.begin(), data.end(), p.num_of_pakets, queue, context);
+		}
+		double t = seconds_now() - start;
+		if (best < 0 || t < best) best = t;
+	}
+	return best;
+}
+
+/*
+ * Measures random inputs of _ValueType from CALIBRATE_MIN_N up to max_n
+ * elements, in steps of a factor of 4, on the cores of the job. For each size
+ * std::sort and malms::sort with 1 to CALIBRATE_MAX_PAKETS_PER_CORE pakets
+ * per core, with and without the buffered merge, are timed and the fastest
+ * is added to the table.
+ */
+template<typename _ValueType>
+void calibrate(Scheduler::WorkQueue* queue, std::size_t max_n, TuningTable& table) {
+	unsigned int cores = job_cores(queue);
+	for (std::size_t n = CALIBRATE_MIN_N; n <= max_n; n *= 4) {
+		std::vector<_ValueType> input(n);
+		for (std::size_t i = 0; i < n; i++) {
+			input[i] = static_cast<_ValueType>(std::rand());
+		}
+
+		Parameters best;
+		best.num_of_pakets = 1;
+		best.buffered_merge = false;
+		best.sequential = true;
+		double best_time = time_parameters(input, best, queue);
+
+		for (unsigned int per_core = 1; per_core <= CALIBRATE_MAX_PAKETS_PER_CORE; per_core *= 2) {
+			for (int buffered = 0; buffered < 2; buffered++) {
+				Parameters p;
+				p.num_of_pakets = per_core * cores;
+				p.buffered_merge = buffered;
+				p.sequential = false;
+				// with one paket the buffered merge is only an extra copy
+				if (p.num_of_pakets > n || (buffered && p.num_of_pakets == 1)) continue;
+				double t = time_parameters(input, p, queue);
+				if (t < best_time) {
+					best_time = t;
+					best = p;
+				}
+			}
+		}
+
+		TableEntry e;
+		e.element_size = sizeof(_ValueType);
+		e.n = n;
+		e.cores = cores;
+		e.parameters = best;
+		table.add(e);
+	}
+}
+
+} // namespace Tuning
+
+} // namespace malms
+
+#endif
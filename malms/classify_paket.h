@@ -0,0 +1,65 @@
+/*
+ *  Workpaket for classifying elements into the buckets of the sample sort.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the class ClassifyPaket which implements the
+ *				Workpaket Interface.
+ *
+ */
+
+#ifndef CLASSIFY_PAKET_H
+#define CLASSIFY_PAKET_H
+
+#include <iterator>
+#include <algorithm>
+#include <cstddef>
+#include "workpaket.h"
+#include "splitter_tree.h"
+
+namespace malms {
+
+/*
+ * Implements the Workpaket Interface. The constructor takes the splitter
+ * tree, the range [begin,end), the oracle receiving the bucket of each element
+ * and the bucket sizes of this range. The () operator classifies the range.
+ */
+template<typename _RandomAccessIterator>
+class ClassifyPaket : public Workpaket {
+	private:
+		// typedefs
+		typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
+
+		// attributes
+		const SplitterTree<_ValueType>* tree;
+		_RandomAccessIterator begin;
+		_RandomAccessIterator end;
+		unsigned char* oracle;
+		std::size_t* counts;
+
+	public:
+		/*
+		 * Resets the bucket sizes and classifies the elements.
+		 */
+		void operator()() {
+			std::fill(counts, counts + tree->numBuckets(), 0);
+			tree->classify(begin, end, oracle, counts);
+		}
+
+		/*
+		 * Constructor initializes the classification attributes.
+		 */
+		ClassifyPaket(const SplitterTree<_ValueType>* tree, _RandomAccessIterator begin, _RandomAccessIterator end, unsigned char* oracle, std::size_t* counts) {
+			this->tree = tree;
+			this->begin = begin;
+			this->end = end;
+			this->oracle = oracle;
+			this->counts = counts;
+		}
+};
+
+} // namespace
+
+#endif
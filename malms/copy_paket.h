@@ -6,7 +6,11 @@
  *
  *  Description:
  *				Implements the class CopyPaket which implements the Workpaket
- *				Interface.
+ *				Interface. Large copies are written with the streaming stores
+ *				of stream_store.h. A splittable CopyPaket copies large ranges
+ *				in chunks and gives the back half of the rest to a new paket
+ *				when the WorkQueue asks for it between two chunks, the chunks
+ *				share one streamed output if the whole range is large.
  *				
  */
 
@@ -16,7 +20,10 @@
 #include <vector>
 #include <algorithm>
 #include "workpaket.h"
+#include "stream_store.h"
 
+// a splittable copy paket copies in chunks of this many elements
+#define COPY_SPLIT_CHUNK (1 << 18)
 
 namespace malms {
 
@@ -33,13 +40,48 @@ class CopyPaket : public Workpaket {
 		_RandomAccessIterator source_end;
 		_TargetRandomAccessIterator target_begin;
 		
+		/*
+		 * Copies in chunks into the output, which is the target itself or a
+		 * streamed output of the target, and returns the end of the output.
+		 */
+		template<typename _Output>
+		_Output chunkedCopy(_Output output) {
+			_RandomAccessIterator begin = source_begin;
+			_RandomAccessIterator end = source_end;
+			while (end - begin > COPY_SPLIT_CHUNK) {
+				if (end - begin >= 2*COPY_SPLIT_CHUNK && splitRequested()) {
+					// give the back half to a new paket
+					_RandomAccessIterator middle = begin + (end - begin) / 2;
+					CopyPaket* part = new CopyPaket(middle, end, target_begin + (middle - source_begin));
+					part->setSplittable(true);
+					pushSplit(part);
+					end = middle;
+					continue;
+				}
+				output = Memory::stream_append(begin, begin + COPY_SPLIT_CHUNK, output);
+				begin += COPY_SPLIT_CHUNK;
+			}
+			return Memory::stream_append(begin, end, output);
+		}
+		
 	public:
 		/*
-		 * Copies the data from [begin,end) to [target,...) using STL copy.
+		 * Copies the data from [begin,end) to [target,...) using STL copy, or
+		 * streaming stores for large copies.
 		 */
 		void operator()() {
-			// copy
-			std::copy(source_begin, source_end, target_begin);
+			if (!isSplittable()) {
+				// copy
+				Memory::stream_copy(source_begin, source_end, target_begin);
+				return;
+			}
+			// the chunks are too small to be streamed on their own
+			if (Memory::use_stream_store(target_begin, source_end - source_begin)) {
+				Memory::StreamOutput<_TargetRandomAccessIterator> output(target_begin);
+				output.finish(chunkedCopy(output.iterator()));
+			} else {
+				chunkedCopy(target_begin);
+			}
 		}
 		
 		/*
@@ -50,6 +92,9 @@ class CopyPaket : public Workpaket {
 			this->source_end = end;
 			this->target_begin = target;
 		}
+		
+		// whether the paket copies in chunks and can be split while it runs
+		using Workpaket::setSplittable;
 };
 
 } // namespace
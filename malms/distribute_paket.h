@@ -0,0 +1,62 @@
+/*
+ *  Workpaket for distributing classified elements into their buckets.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the class DistributePaket which implements the
+ *				Workpaket Interface.
+ *
+ */
+
+#ifndef DISTRIBUTE_PAKET_H
+#define DISTRIBUTE_PAKET_H
+
+#include <cstddef>
+#include "workpaket.h"
+
+namespace malms {
+
+/*
+ * Implements the Workpaket Interface. The constructor takes the range
+ * [begin,end), its oracle, the target and the offsets at which the elements
+ * of this range go into each bucket of the target. The () operator moves
+ * each element to the next position of its bucket, advancing the offsets.
+ */
+template<typename _RandomAccessIterator, typename _TargetRandomAccessIterator>
+class DistributePaket : public Workpaket {
+	private:
+		// attributes
+		_RandomAccessIterator begin;
+		_RandomAccessIterator end;
+		const unsigned char* oracle;
+		_TargetRandomAccessIterator target;
+		std::size_t* offsets;
+
+	public:
+		/*
+		 * Moves the elements into the buckets of the target.
+		 */
+		void operator()() {
+			const unsigned char* o = oracle;
+			for (_RandomAccessIterator i = begin; i != end; ++i, ++o) {
+				*(target + offsets[*o]++) = *i;
+			}
+		}
+
+		/*
+		 * Constructor initializes the distribution attributes.
+		 */
+		DistributePaket(_RandomAccessIterator begin, _RandomAccessIterator end, const unsigned char* oracle, _TargetRandomAccessIterator target, std::size_t* offsets) {
+			this->begin = begin;
+			this->end = end;
+			this->oracle = oracle;
+			this->target = target;
+			this->offsets = offsets;
+		}
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ *  Workpaket for merging runs on disk.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the class ExternalMergePaket which implements the
+ *				Workpaket Interface. It merges the parts of all runs on disk
+ *				between two rows of splitters into one partition of the output
+ *				file, reading and writing in chunks with pread and pwrite.
+ *
+ */
+
+#ifndef EXTERNAL_MERGE_PAKET_H
+#define EXTERNAL_MERGE_PAKET_H
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include "workpaket.h"
+#include "loser_tree.h"
+#include "file_run_iterator.h"
+
+namespace malms {
+
+/*
+ * Implements the Workpaket Interface. The constructor takes the lower and upper
+ * splitters of the num_of_runs runs, the output file and the element offset of
+ * the partition in it, the chunk size and a buffer of (num_of_runs+1)*chunk
+ * elements owned by the caller.
+ * The () operator merges the runs; success() tells if all I/O succeeded.
+ */
+template<typename _ValueType>
+class ExternalMergePaket : public Workpaket {
+	private:
+		// typedefs
+		typedef FileRunIterator<_ValueType> _FileRunIterator;
+		typedef typename _FileRunIterator::difference_type _Distance;
+
+		// attributes
+		_FileRunIterator* lower_splitters;
+		_FileRunIterator* upper_splitters;
+		unsigned int num_of_runs;
+		int output_fd;
+		_Distance output_pos;
+		_Distance chunk;
+		_ValueType* buffer;
+		bool ok;
+
+		/*
+		 * Reads the next chunk of run j into its buffer. Returns false if the
+		 * run is exhausted.
+		 */
+		bool refill(unsigned int j, std::vector<_FileRunIterator>& next, std::vector<_ValueType*>& cur, std::vector<_ValueType*>& last) {
+			_Distance count = std::min(chunk, upper_splitters[j] - next[j]);
+			if (count <= 0) return false;
+			cur[j] = buffer + j*chunk;
+			last[j] = cur[j] + count;
+			if (!External::read_elements(next[j].file(), next[j].position(), cur[j], count)) {
+				ok = false;
+				return false;
+			}
+			next[j] += count;
+			return true;
+		}
+
+		/*
+		 * Writes the output buffer and resets it.
+		 */
+		void flush(_ValueType* out_begin, _ValueType*& out) {
+			if (!External::write_elements(output_fd, output_pos, out_begin, out - out_begin)) {
+				ok = false;
+			}
+			output_pos += out - out_begin;
+			out = out_begin;
+		}
+
+	public:
+		/*
+		 * Merges the runs using the loser tree.
+		 */
+		void operator()() {
+			unsigned int k = num_of_runs;
+			std::vector<_FileRunIterator> next(lower_splitters, lower_splitters + k);
+			std::vector<_ValueType*> cur(k);
+			std::vector<_ValueType*> last(k);
+
+			Merging::LoserTree<_ValueType> lt(k);
+
+			// read the first chunk of all runs and fill the loser tree
+			unsigned int sequences_left = 0;
+			for (unsigned int j = 0; j < k; j++) {
+				if (refill(j, next, cur, last)) {
+					lt.insertStart(*cur[j], j);
+					sequences_left++;
+				} else {
+					lt.insertExhausted(j);
+				}
+			}
+			if (sequences_left == 0) return;
+			lt.init();
+
+			_ValueType* out_begin = buffer + k*chunk;
+			_ValueType* out_end = out_begin + chunk;
+			_ValueType* out = out_begin;
+			while (sequences_left > 0) {
+				unsigned int min_i = lt.minSource();
+				*out = lt.minKey();
+				++cur[min_i];
+				if (++out == out_end) {
+					flush(out_begin, out);
+				}
+				if (cur[min_i] == last[min_i] && !refill(min_i, next, cur, last)) {
+					lt.exhaustMin();
+					sequences_left--;
+				} else {
+					lt.replaceMin(*cur[min_i]);
+				}
+			}
+			flush(out_begin, out);
+		}
+
+		/*
+		 * Returns false if reading or writing failed.
+		 */
+		bool success() const {
+			return ok;
+		}
+
+		/*
+		 * Constructor initializes the merging attributes.
+		 */
+		ExternalMergePaket(_FileRunIterator* lower, _FileRunIterator* upper, unsigned int num_of_runs, int output_fd, _Distance output_pos, _Distance chunk, _ValueType* buffer) {
+			this->lower_splitters = lower;
+			this->upper_splitters = upper;
+			this->num_of_runs = num_of_runs;
+			this->output_fd = output_fd;
+			this->output_pos = output_pos;
+			this->chunk = chunk;
+			this->buffer = buffer;
+			this->ok = true;
+		}
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ *  Implements sorting of files larger than the main memory.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				This file implements malms::sort_file, which sorts a binary
+ *				file of elements within a memory limit. If twice the file fits
+ *				into the memory limit, it is sorted in memory with malms::sort.
+ *				Otherwise memory-sized runs are sorted with malms::sort and
+ *				written to scratch files, splitters over the runs on disk are
+ *				computed with reduce_split, and the output partitions are
+ *				merged from disk independently by ExternalMergePakets.
+ *
+ */
+
+#ifndef EXTERNAL_SORT_H
+#define EXTERNAL_SORT_H
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <cstddef>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "threadpool/workqueue.h"
+#include "threadpool_mergesort.h"
+#include "split_paket.h"
+#include "file_run_iterator.h"
+#include "external_merge_paket.h"
+
+// smallest number of elements read from a run at once during the merge
+#define EXTERNAL_MIN_CHUNK 1024
+
+namespace malms {
+
+namespace External {
+
+/*
+ * Closes all file descriptors in fds that are open.
+ */
+inline void close_all(std::vector<int>& fds) {
+	for (std::size_t i = 0; i < fds.size(); i++) {
+		if (fds[i] >= 0) close(fds[i]);
+	}
+	fds.clear();
+}
+
+/*
+ * Sorts the n elements of the file in_fd in memory and writes them to the
+ * output file.
+ */
+template<typename _ValueType>
+bool sort_in_memory(int in_fd, const char* output, std::size_t n, unsigned int num_of_pakets, Scheduler::WorkQueue* queue) {
+	std::vector<_ValueType> data(n);
+	if (n > 0 && !read_elements(in_fd, 0, &data[0], n)) return false;
+	if (n > 0) sort(&data[0], &data[0]+n, num_of_pakets, queue);
+	int out_fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (out_fd < 0) return false;
+	bool ok = (n == 0) || write_elements(out_fd, 0, &data[0], n);
+	close(out_fd);
+	return ok;
+}
+
+} // namespace External
+
+/*
+ * Sorts the binary file input of elements of type _ValueType into the file
+ * output (which may be the input file), using num_of_pakets pakets and the
+ * workqueue given by queue, with about memory bytes of main memory.
+ *
+ * Runs of memory/2 bytes are sorted in memory with malms::sort and written to
+ * scratch files named scratch_prefix.run<i> (the output name if NULL), which
+ * are unlinked right after they are created. The merge is done in a single
+ * pass, each of the num_of_pakets merge pakets reads chunks of memory /
+ * (num_of_pakets * (runs+1)) bytes, but at least EXTERNAL_MIN_CHUNK elements,
+ * from each run, so for very many runs the memory limit is exceeded.
+ * Returns false if a file could not be read or written.
+ */
+template<typename _ValueType>
+bool sort_file(const char* input, const char* output, unsigned int num_of_pakets, Scheduler::WorkQueue* queue, std::size_t memory, const char* scratch_prefix = NULL) {
+	typedef FileRunIterator<_ValueType> _FileRunIterator;
+	typedef typename _FileRunIterator::difference_type _Distance;
+
+	int in_fd = open(input, O_RDONLY);
+	if (in_fd < 0) return false;
+	struct stat st;
+	if (fstat(in_fd, &st) != 0) {
+		close(in_fd);
+		return false;
+	}
+	_Distance n = st.st_size / sizeof(_ValueType);
+
+	// in memory, if malms::sort fits into the memory limit
+	_Distance run_size = memory / (2*sizeof(_ValueType));
+	if (n <= run_size || run_size == 0) {
+		bool ok = External::sort_in_memory<_ValueType>(in_fd, output, n, num_of_pakets, queue);
+		close(in_fd);
+		return ok;
+	}
+
+	/* form runs in memory and write them to the scratch files */
+
+	unsigned int num_of_runs = (n + run_size - 1) / run_size;
+	std::vector<int> run_fds;
+	std::vector<_Distance> run_sizes;
+	std::string prefix = (scratch_prefix != NULL) ? scratch_prefix : output;
+	bool ok = true;
+	{
+		std::vector<_ValueType> data(run_size);
+		SortContext<_ValueType*> context(run_size, num_of_pakets);
+		for (unsigned int i = 0; i < num_of_runs && ok; i++) {
+			std::ostringstream name;
+			name << prefix << ".run" << i;
+			int fd = open(name.str().c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+			if (fd < 0) {
+				ok = false;
+				break;
+			}
+			unlink(name.str().c_str());
+			run_fds.push_back(fd);
+
+			_Distance size = std::min(run_size, n - i*run_size);
+			run_sizes.push_back(size);
+			ok = External::read_elements(in_fd, i*run_size, &data[0], size);
+			if (!ok) break;
+			sort(&data[0], &data[0]+size, num_of_pakets, queue, context);
+			ok = External::write_elements(fd, 0, &data[0], size);
+		}
+	}
+	close(in_fd);
+	if (!ok) {
+		External::close_all(run_fds);
+		return false;
+	}
+
+	/* compute splitters over the runs on disk */
+
+	unsigned int k = num_of_pakets;
+	unsigned int r = num_of_runs;
+	// (k+1) rows of r splitters, row i is the start of output partition i
+	std::vector<_FileRunIterator> splitter_matrix((k+1)*r);
+	for (unsigned int j = 0; j < r; j++) {
+		splitter_matrix[j] = _FileRunIterator(run_fds[j], 0);
+		splitter_matrix[k*r+j] = _FileRunIterator(run_fds[j], run_sizes[j]);
+	}
+	std::vector<_Distance> out_begin(k+1);
+	out_begin[0] = 0;
+	for (unsigned int i = 0; i < k; i++) {
+		out_begin[i+1] = out_begin[i] + paket_size(n, k, i);
+	}
+
+	// reduce_split finds row 1 between rows 0 and r, so each split paket gets
+	// its own row pointers with the target row at position 1
+	std::vector<_FileRunIterator*> split_rows((k-1)*(r+1));
+	std::vector<SplitPaket<_FileRunIterator> > split_pakets;
+	split_pakets.reserve(k);
+	for (unsigned int i = 1; i < k; i++) {
+		_FileRunIterator** rows = &split_rows[(i-1)*(r+1)];
+		rows[0] = &splitter_matrix[0];
+		rows[1] = &splitter_matrix[i*r];
+		rows[r] = &splitter_matrix[k*r];
+		split_pakets.push_back(SplitPaket<_FileRunIterator>(rows, r, 0, out_begin[i]));
+		queue->push(&split_pakets.back());
+	}
+	queue->blockuntildone();
+
+	/* merge the output partitions from disk */
+
+	int out_fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (out_fd < 0 || ftruncate(out_fd, n * sizeof(_ValueType)) != 0) {
+		if (out_fd >= 0) close(out_fd);
+		External::close_all(run_fds);
+		return false;
+	}
+
+	_Distance chunk = memory / (sizeof(_ValueType) * k * (r+1));
+	if (chunk < EXTERNAL_MIN_CHUNK) chunk = EXTERNAL_MIN_CHUNK;
+	std::vector<_ValueType> merge_buffer(k*(r+1)*chunk);
+	std::vector<ExternalMergePaket<_ValueType> > merge_pakets;
+	merge_pakets.reserve(k);
+	for (unsigned int i = 0; i < k; i++) {
+		merge_pakets.push_back(ExternalMergePaket<_ValueType>(&splitter_matrix[i*r], &splitter_matrix[(i+1)*r], r, out_fd, out_begin[i], chunk, &merge_buffer[i*(r+1)*chunk]));
+		queue->push(&merge_pakets.back());
+	}
+	queue->blockuntildone();
+
+	for (unsigned int i = 0; i < k; i++) {
+		ok = ok && merge_pakets[i].success();
+	}
+	close(out_fd);
+	External::close_all(run_fds);
+	return ok;
+}
+
+} // namespace
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ *  Workpaket for extracting keys.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the class ExtractPaket which implements the Workpaket
+ *				Interface.
+ *				
+ */
+
+#ifndef EXTRACT_PAKET_H
+#define EXTRACT_PAKET_H
+
+#include "workpaket.h"
+
+namespace malms {
+
+/*
+ * Implements the Workpaket Interface. The constructor takes the input range
+ * [begin,end), the target for the (key,index) pairs, the index of the first
+ * element and the key extractor and saves them into the status of the ExtractPaket.
+ * The () operator writes the pair (key_of(*(begin+i)), first_index+i) to target[i].
+ */
+template<typename _RandomAccessIterator, typename _IndirectElement, typename _KeyExtractor>
+class ExtractPaket : public Workpaket {
+	private:
+		// typedefs
+		typedef typename _IndirectElement::index_type _Index;
+		
+		// attributes
+		_RandomAccessIterator begin;
+		_RandomAccessIterator end;
+		_IndirectElement* target;
+		_Index first_index;
+		_KeyExtractor key_of;
+		
+	public:
+		/*
+		 * Extracts the key and index of each element in [begin,end).
+		 */
+		void operator()() {
+			_Index index = first_index;
+			for (_RandomAccessIterator it = begin; it != end; ++it, ++target, ++index) {
+				target->key = key_of(*it);
+				target->index = index;
+			}
+		}
+		
+		/*
+		 * Constructor initializes the extraction attributes.
+		 */
+		ExtractPaket(_RandomAccessIterator begin, _RandomAccessIterator end, _IndirectElement* target, _Index first_index, _KeyExtractor key_of)
+			:	begin(begin), end(end), target(target), first_index(first_index), key_of(key_of) {
+		}
+};
+
+} // namespace
+
+#endif
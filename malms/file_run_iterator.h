@@ -0,0 +1,141 @@
+/*
+ *  Random-Access-Iterator over a sorted run in a file.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the class FileRunIterator, a random access iterator
+ *				over the elements of a file, which reads the element it points
+ *				to with pread on every dereference. It is used to compute the
+ *				splitters of runs on disk with Splitting::reduce_split, which
+ *				only reads O(k log n) elements of each run.
+ *
+ */
+
+#ifndef FILE_RUN_ITERATOR_H
+#define FILE_RUN_ITERATOR_H
+
+#include <iterator>
+#include <cstddef>
+#include <unistd.h>
+#include <sys/types.h>
+
+namespace malms {
+
+namespace External {
+
+/*
+ * Reads count elements at element offset pos of the file fd into buffer,
+ * retrying on short reads. Returns false on an error or the end of the file.
+ */
+template<typename _ValueType>
+bool read_elements(int fd, off_t pos, _ValueType* buffer, std::size_t count) {
+	char* b = reinterpret_cast<char*>(buffer);
+	std::size_t bytes = count * sizeof(_ValueType);
+	off_t offset = pos * static_cast<off_t>(sizeof(_ValueType));
+	while (bytes > 0) {
+		ssize_t r = pread(fd, b, bytes, offset);
+		if (r <= 0) return false;
+		b += r;
+		bytes -= r;
+		offset += r;
+	}
+	return true;
+}
+
+/*
+ * Writes count elements from buffer at element offset pos of the file fd,
+ * retrying on short writes. Returns false on an error.
+ */
+template<typename _ValueType>
+bool write_elements(int fd, off_t pos, const _ValueType* buffer, std::size_t count) {
+	const char* b = reinterpret_cast<const char*>(buffer);
+	std::size_t bytes = count * sizeof(_ValueType);
+	off_t offset = pos * static_cast<off_t>(sizeof(_ValueType));
+	while (bytes > 0) {
+		ssize_t w = pwrite(fd, b, bytes, offset);
+		if (w <= 0) return false;
+		b += w;
+		bytes -= w;
+		offset += w;
+	}
+	return true;
+}
+
+} // namespace External
+
+/*
+ * Points to the element at position pos of the file fd. The iterator is a
+ * plain value (it is copied with memcpy by reduce_split), dereferencing it
+ * returns a copy of the element.
+ */
+template<typename _ValueType>
+class FileRunIterator {
+	public:
+		// iterator typedefs
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef _ValueType value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const _ValueType* pointer;
+		typedef _ValueType reference;
+
+	private:
+		int fd;
+		difference_type pos;
+
+	public:
+		FileRunIterator() : fd(-1), pos(0) {
+		}
+
+		FileRunIterator(int fd, difference_type pos) : fd(fd), pos(pos) {
+		}
+
+		/*
+		 * Reads the element from the file.
+		 */
+		_ValueType operator*() const {
+			_ValueType v;
+			External::read_elements(fd, pos, &v, 1);
+			return v;
+		}
+
+		_ValueType operator[](difference_type i) const {
+			return *(*this + i);
+		}
+
+		/*
+		 * Returns the file descriptor.
+		 */
+		int file() const {
+			return fd;
+		}
+
+		/*
+		 * Returns the position of the element in the file.
+		 */
+		difference_type position() const {
+			return pos;
+		}
+
+		FileRunIterator& operator++() { ++pos; return *this; }
+		FileRunIterator& operator--() { --pos; return *this; }
+		FileRunIterator operator++(int) { FileRunIterator t(*this); ++pos; return t; }
+		FileRunIterator operator--(int) { FileRunIterator t(*this); --pos; return t; }
+		FileRunIterator& operator+=(difference_type d) { pos += d; return *this; }
+		FileRunIterator& operator-=(difference_type d) { pos -= d; return *this; }
+		FileRunIterator operator+(difference_type d) const { return FileRunIterator(fd, pos + d); }
+		FileRunIterator operator-(difference_type d) const { return FileRunIterator(fd, pos - d); }
+		difference_type operator-(const FileRunIterator& i) const { return pos - i.pos; }
+
+		bool operator==(const FileRunIterator& i) const { return pos == i.pos && fd == i.fd; }
+		bool operator!=(const FileRunIterator& i) const { return !(*this == i); }
+		bool operator<(const FileRunIterator& i) const { return pos < i.pos; }
+		bool operator>(const FileRunIterator& i) const { return pos > i.pos; }
+		bool operator<=(const FileRunIterator& i) const { return pos <= i.pos; }
+		bool operator>=(const FileRunIterator& i) const { return pos >= i.pos; }
+};
+
+} // namespace
+
+#endif
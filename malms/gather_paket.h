@@ -0,0 +1,55 @@
+/*
+ *  Workpaket for gathering elements by index.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the class GatherPaket which implements the Workpaket
+ *				Interface.
+ *				
+ */
+
+#ifndef GATHER_PAKET_H
+#define GATHER_PAKET_H
+
+#include "workpaket.h"
+
+namespace malms {
+
+/*
+ * Implements the Workpaket Interface. The constructor takes a range of
+ * (key,index) pairs [begin,end), the source sequence and the target and saves
+ * them into the status of the GatherPaket.
+ * The () operator copies source[begin[i].index] to target[i].
+ */
+template<typename _IndirectElement, typename _SourceIterator, typename _TargetIterator>
+class GatherPaket : public Workpaket {
+	private:
+		// attributes
+		const _IndirectElement* begin;
+		const _IndirectElement* end;
+		_SourceIterator source;
+		_TargetIterator target;
+		
+	public:
+		/*
+		 * Applies the permutation given by the indices to the target range.
+		 */
+		void operator()() {
+			for (const _IndirectElement* it = begin; it != end; ++it, ++target) {
+				*target = *(source + it->index);
+			}
+		}
+		
+		/*
+		 * Constructor initializes the gathering attributes.
+		 */
+		GatherPaket(const _IndirectElement* begin, const _IndirectElement* end, _SourceIterator source, _TargetIterator target)
+			:	begin(begin), end(end), source(source), target(target) {
+		}
+};
+
+} // namespace
+
+#endif
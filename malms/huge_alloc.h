@@ -0,0 +1,111 @@
+/*
+ *  Allocation of large buffers, optionally backed by huge pages.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the allocation policies for the run buffer of the
+ *				SortContext: plain ::operator new, explicit 2 MB pages
+ *				(MAP_HUGETLB) and transparent huge pages (madvise with
+ *				MADV_HUGEPAGE). Explicit huge pages fall back to transparent
+ *				huge pages and those to ::operator new, if the system does not
+ *				provide them.
+ *
+ */
+
+#ifndef HUGE_ALLOC_H
+#define HUGE_ALLOC_H
+
+#include <new>
+#include <cstddef>
+#include <sys/mman.h>
+
+// the size of the huge pages used for alignment and MAP_HUGETLB
+#define HUGE_PAGE_SIZE (2UL << 20)
+
+namespace malms {
+
+/*
+ * The allocation policies: ::operator new, ::operator new with parallel
+ * prefaulting, transparent and explicit huge pages (both prefaulted).
+ */
+enum AllocationPolicy {ALLOC_DEFAULT, ALLOC_PREFAULT, ALLOC_THP, ALLOC_HUGETLB};
+
+namespace Memory {
+
+inline std::size_t round_to_huge_pages(std::size_t bytes) {
+	return (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+}
+
+/*
+ * Maps bytes of anonymous memory aligned to HUGE_PAGE_SIZE and advises the
+ * kernel to back it with transparent huge pages. Returns NULL on failure.
+ */
+inline void* allocate_thp(std::size_t bytes) {
+	std::size_t size = round_to_huge_pages(bytes);
+	// map one huge page more and cut off the unaligned head and tail
+	void* m = mmap(NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (m == MAP_FAILED) return NULL;
+	char* raw = static_cast<char*>(m);
+	char* aligned = reinterpret_cast<char*>((reinterpret_cast<std::size_t>(raw) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+	if (aligned > raw) munmap(raw, aligned - raw);
+	char* tail = aligned + size;
+	char* raw_end = raw + size + HUGE_PAGE_SIZE;
+	if (raw_end > tail) munmap(tail, raw_end - tail);
+	#ifdef MADV_HUGEPAGE
+	madvise(aligned, size, MADV_HUGEPAGE);
+	#endif
+	return aligned;
+}
+
+/*
+ * Maps bytes of memory backed by explicit huge pages from the hugetlbfs
+ * pool. Returns NULL if the pool has not enough pages.
+ */
+inline void* allocate_hugetlb(std::size_t bytes) {
+	#ifdef MAP_HUGETLB
+	void* m = mmap(NULL, round_to_huge_pages(bytes), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (m != MAP_FAILED) return m;
+	#endif
+	return NULL;
+}
+
+/*
+ * Allocates bytes of memory with the given policy. If the policy is not
+ * available, the next simpler one is tried, policy is set to the policy that
+ * was used in the end.
+ */
+inline void* allocate(std::size_t bytes, AllocationPolicy& policy) {
+	void* m = NULL;
+	if (policy == ALLOC_HUGETLB) {
+		m = allocate_hugetlb(bytes);
+		if (m != NULL) return m;
+		policy = ALLOC_THP;
+	}
+	if (policy == ALLOC_THP) {
+		m = allocate_thp(bytes);
+		if (m != NULL) return m;
+		policy = ALLOC_PREFAULT;
+	}
+	return ::operator new(bytes);
+}
+
+/*
+ * Frees memory that was allocated with allocate() using the given (effective)
+ * policy.
+ */
+inline void deallocate(void* m, std::size_t bytes, AllocationPolicy policy) {
+	if (m == NULL) return;
+	if (policy == ALLOC_THP || policy == ALLOC_HUGETLB) {
+		munmap(m, round_to_huge_pages(bytes));
+	} else {
+		::operator delete(m);
+	}
+}
+
+} // namespace Memory
+
+} // namespace
+
+#endif
@@ -0,0 +1,145 @@
+/*
+ *  Indirect sorting of large records.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements malms::sort_indirect, which sorts (key,index) pairs
+ *				instead of the records themselves and applies the resulting
+ *				permutation to the records in a final gather phase. All phases
+ *				are executed as Workpakets on the given WorkQueue.
+ *
+ */
+
+#ifndef INDIRECT_SORT_H
+#define INDIRECT_SORT_H
+
+#include <vector>
+#include <iterator>
+#include <stdint.h>
+
+#include "threadpool/workqueue.h"
+#include "threadpool_mergesort.h"
+#include "radix_sort.h"
+#include "extract_paket.h"
+#include "gather_paket.h"
+#include "copy_paket.h"
+
+namespace malms {
+
+/*
+ * The compact element that is sorted instead of the record: the key of the
+ * record and the position of the record in the input. Ordered by key only.
+ */
+template<typename _Key, typename _Index>
+struct IndirectElement {
+	typedef _Key key_type;
+	typedef _Index index_type;
+	_Key key;
+	_Index index;
+	bool operator<(const IndirectElement& e) const {
+		return key < e.key;
+	}
+};
+
+namespace Sorting {
+
+/*
+ * (key,index) pairs are radix sorted by the key, if the key type is.
+ */
+template<typename _Key, typename _Index, bool _Enabled = RadixTraits<_Key>::enabled>
+struct IndirectRadixTraits {
+	static const bool enabled = false;
+};
+
+template<typename _Key, typename _Index>
+struct IndirectRadixTraits<_Key, _Index, true> {
+	static const bool enabled = true;
+	typedef typename RadixTraits<_Key>::key_type key_type;
+	static inline key_type key(const IndirectElement<_Key,_Index>& v) {
+		return RadixTraits<_Key>::key(v.key);
+	}
+};
+
+template<typename _Key, typename _Index>
+struct RadixTraits<IndirectElement<_Key,_Index> > : public IndirectRadixTraits<_Key,_Index> {};
+
+} // namespace Sorting
+
+/*
+ * Sorts [begin,end) by the keys given by the key extractor key_of, which must
+ * be a function object with a result_type typedef. The (key,index) pairs are
+ * extracted in parallel, sorted with malms::sort using _Index as index type,
+ * the records are then gathered in sorted order into a buffer and copied back.
+ */
+template<typename _Index, typename _RandomAccessIterator, typename _KeyExtractor>
+void sort_indirect(_RandomAccessIterator begin, _RandomAccessIterator end, unsigned int num_of_pakets, Scheduler::WorkQueue* queue, _KeyExtractor key_of) {
+	typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type _Distance;
+	typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
+	typedef IndirectElement<typename _KeyExtractor::result_type, _Index> _IndirectElement;
+
+	_Distance n = end - begin;
+	if (n == 0) return;
+
+	// extract the (key,index) pairs
+	std::vector<_IndirectElement> pairs(n);
+	std::vector<ExtractPaket<_RandomAccessIterator,_IndirectElement,_KeyExtractor> > extract_pakets;
+	extract_pakets.reserve(num_of_pakets);
+	_Distance offset = 0;
+	for (unsigned int i = 0; i < num_of_pakets; i++) {
+		_Distance size = paket_size(n,num_of_pakets,i);
+		extract_pakets.push_back(ExtractPaket<_RandomAccessIterator,_IndirectElement,_KeyExtractor>(begin+offset,begin+offset+size,&pairs[0]+offset,offset,key_of));
+		queue->push(&extract_pakets.back());
+		offset += size;
+	}
+	queue->blockuntildone();
+
+	// sort the pairs with the malleable mergesort
+	sort(&pairs[0], &pairs[0]+n, num_of_pakets, queue);
+
+	// gather the records in sorted order into a buffer
+	_ValueType* buffer = static_cast<_ValueType*>(::operator new(sizeof(_ValueType) * n));
+	std::vector<GatherPaket<_IndirectElement,_RandomAccessIterator,_ValueType*> > gather_pakets;
+	gather_pakets.reserve(num_of_pakets);
+	offset = 0;
+	for (unsigned int i = 0; i < num_of_pakets; i++) {
+		_Distance size = paket_size(n,num_of_pakets,i);
+		gather_pakets.push_back(GatherPaket<_IndirectElement,_RandomAccessIterator,_ValueType*>(&pairs[0]+offset,&pairs[0]+offset+size,begin,buffer+offset));
+		queue->push(&gather_pakets.back());
+		offset += size;
+	}
+	queue->blockuntildone();
+
+	// copy the sorted records back
+	std::vector<CopyPaket<_ValueType*,_RandomAccessIterator> > copy_pakets;
+	copy_pakets.reserve(num_of_pakets);
+	offset = 0;
+	for (unsigned int i = 0; i < num_of_pakets; i++) {
+		_Distance size = paket_size(n,num_of_pakets,i);
+		copy_pakets.push_back(CopyPaket<_ValueType*,_RandomAccessIterator>(buffer+offset,buffer+offset+size,begin+offset));
+		copy_pakets.back().setSplittable(true);
+		queue->push(&copy_pakets.back());
+		offset += size;
+	}
+	queue->blockuntildone();
+
+	::operator delete(buffer);
+}
+
+/*
+ * Sorts [begin,end) by the keys given by the key extractor key_of. Uses 32 bit
+ * indices if possible, so that e.g. an int key and its index fit into 8 bytes.
+ */
+template<typename _RandomAccessIterator, typename _KeyExtractor>
+void sort_indirect(_RandomAccessIterator begin, _RandomAccessIterator end, unsigned int num_of_pakets, Scheduler::WorkQueue* queue, _KeyExtractor key_of) {
+	if (static_cast<uint64_t>(end - begin) <= UINT32_MAX) {
+		sort_indirect<uint32_t>(begin, end, num_of_pakets, queue, key_of);
+	} else {
+		sort_indirect<uint64_t>(begin, end, num_of_pakets, queue, key_of);
+	}
+}
+
+} // namespace
+
+#endif
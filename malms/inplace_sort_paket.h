@@ -0,0 +1,54 @@
+/*
+ *  Workpaket for sorting in place.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the class InplaceSortPaket which implements the
+ *				Workpaket Interface.
+ *				
+ */
+
+#ifndef INPLACE_SORT_PAKET_H
+#define INPLACE_SORT_PAKET_H
+
+#include "workpaket.h"
+#include "run_formation.h"
+
+namespace malms {
+
+/*
+ * Implements the Workpaket Interface. The constructor takes two Random-Access-
+ * Iterators (begin and end) and saves them into the status of the paket.
+ * The () operator sorts the intervall [begin,end) in place, using MSD radix
+ * sort for types with RadixTraits and GNU-sort otherwise, so that no run
+ * buffer is needed (see sort_bounded).
+ */
+template<typename _RandomAccessIterator>
+class InplaceSortPaket : public Workpaket {
+	private:
+		// attributes
+		_RandomAccessIterator begin;
+		_RandomAccessIterator end;
+		
+	public:
+		/*
+		 * Sorts the intervall [begin,end) in place.
+		 */
+		void operator()() {
+			Sorting::form_run_inplace(begin,end);
+		}
+		
+		/*
+		 * Constructor initializes the sort attributes.	
+		 */
+		InplaceSortPaket(_RandomAccessIterator begin, _RandomAccessIterator end) {
+			this->begin = begin;
+			this->end = end;
+		}
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,57 @@
+/*
+ *  Workpaket joining many pakets.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the class JoinPaket which implements the Workpaket
+ *				Interface. A JoinPaket depends on many pakets and pushes many
+ *				pakets once they are all done, e.g. the split pakets of the
+ *				mergesort once all runs are sorted. The pakets it pushes would
+ *				otherwise need a dependency on each of its predecessors.
+ *
+ */
+
+#ifndef JOIN_PAKET_H
+#define JOIN_PAKET_H
+
+#include <cstddef>
+#include "workpaket.h"
+#include "threadpool/workqueue.h"
+
+namespace malms {
+
+/*
+ * Implements the Workpaket Interface. The constructor takes the pakets to push
+ * and the queue, the predecessors are declared with dependsOn(). The ()
+ * operator pushes the pakets at once.
+ */
+class JoinPaket : public Workpaket {
+	private:
+		// attributes
+		Scheduler::WorkQueueItem* const* items;
+		std::size_t count;
+		Scheduler::WorkQueue* queue;
+
+	public:
+		/*
+		 * Pushes the pakets, all predecessors are done.
+		 */
+		void operator()() {
+			queue->push(items, count);
+		}
+
+		/*
+		 * Constructor initializes the pakets [items,items+count) to push.
+		 */
+		JoinPaket(Scheduler::WorkQueueItem* const* items, std::size_t count, Scheduler::WorkQueue* queue) {
+			this->items = items;
+			this->count = count;
+			this->queue = queue;
+		}
+};
+
+} // namespace
+
+#endif
@@ -5,8 +5,9 @@
  *  Version:	0.1
  *
  *  Description:
- *				This implements a multiway merging algorithm using Singlers
- *				losertree.h implementation
+ *				This implements a multiway merging algorithm using the loser
+ *				tree from loser_tree.h. Large outputs are written with the
+ *				streaming stores of stream_store.h.
  *				
  */
 
@@ -17,19 +18,8 @@
 #include <iterator>
 #include <algorithm>
 
-//#include "losertree.h" // loser tree implementation from gcc 4.4.6
-#include <parallel/losertree.h>
-
-// define name of Losertree according to gcc version
-// Test for GXX Version >= 4.5.0
-#if __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 5)
-#define LOSERTREE_CLASS_NAME __gnu_parallel::_LoserTree
-#else
-#define LOSERTREE_CLASS_NAME __gnu_parallel::LoserTree
-#define LOSERTREE_OLD_GCC 1
-#endif
-
-#include <string.h> // for memmove
+#include "loser_tree.h"
+#include "stream_store.h"
 
 namespace malms {
 
@@ -43,95 +33,75 @@ struct LessComp {
 };
 
 /*
- * The algorithm keeps a sorted array of one element from each sequence,
- * it copies the smallest element into the output, then gets the
- * next element from the sequence that the copied element originated from.
- * The position in the sorted array for the new element is found using
- * binary search. Once found, all elements in front of that position are copied
- * one step to the left using memmove. This performes well in practice.
+ * The algorithm keeps the current element of each sequence in a loser tree,
+ * it copies the smallest element into the output, then inserts the next
+ * element from the sequence that the copied element originated from. Once
+ * only one sequence is left, its remaining elements are copied.
+ * The loser tree resolves ties by the index of the sequence, so equal
+ * elements are always output in the order of their sequences, as _Stable
+ * requires.
  */
-template<typename _RandomAccessIterator, typename _OutputIteratorType>
-void multiwaymerge(_RandomAccessIterator* lower_splitters, _RandomAccessIterator* upper_splitters, _OutputIteratorType outputIterator, unsigned int num_of_pakets){
+template<bool _Stable, typename _RandomAccessIterator, typename _OutputIteratorType>
+_OutputIteratorType losertree_merge(_RandomAccessIterator* lower_splitters, _RandomAccessIterator* upper_splitters, _OutputIteratorType outputIterator, unsigned int num_of_pakets){
 	
 	typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
 	
 	unsigned int k = num_of_pakets;
 	
-	LessComp<_ValueType> comp;
-	
-	LOSERTREE_CLASS_NAME<false,_ValueType,LessComp<_ValueType> > lt(k, comp);
-	
-	// find some element
-	_ValueType* someElement = NULL;
-	bool foundSomeElement = false;
-	for (unsigned int i=0;i<k;i++) {
-		if (lower_splitters[i] != upper_splitters[i]) {
-			someElement = &(*lower_splitters[i]);
-			foundSomeElement = true;
-		}
-	}
-	// are there any elements in the sequences?
-	if (!foundSomeElement) return;
+	LoserTree<_ValueType> lt(k);
 	
 	// fill loser tree
 	unsigned int sequences_left = 0;
 	for (unsigned int i=0;i<k;i++) {
 		if (lower_splitters[i] != upper_splitters[i]) {
-			#ifdef LOSERTREE_OLD_GCC
-			lt.insert_start(*lower_splitters[i], i, false);
-			#else
-			lt.__insert_start(*lower_splitters[i], i, false);
-			#endif
+			lt.insertStart(*lower_splitters[i], i);
 			sequences_left++;
 		} else {
-			#ifdef LOSERTREE_OLD_GCC
-			lt.insert_start(*someElement, i, true);
-			#else
-			lt.__insert_start(*someElement, i, true);
-			#endif
+			lt.insertExhausted(i);
 		}
 	}
+	// are there any elements in the sequences?
+	if (sequences_left == 0) return outputIterator;
 	
 	// init loser tree
-	#ifdef LOSERTREE_OLD_GCC
 	lt.init();
-	#else
-	lt.__init();
-	#endif
 	
-	while(sequences_left > 0) {
-		#ifdef LOSERTREE_OLD_GCC
-		unsigned int min_i = lt.get_min_source();
-		#else
-		unsigned int min_i = lt.__get_min_source();
-		#endif
-		*outputIterator = *lower_splitters[min_i];
+	while(sequences_left > 1) {
+		unsigned int min_i = lt.minSource();
+		*outputIterator = lt.minKey();
 		outputIterator++;
 		lower_splitters[min_i]++;
 		if (lower_splitters[min_i] != upper_splitters[min_i]) {
-			#ifdef LOSERTREE_OLD_GCC
-			lt.delete_min_insert(*lower_splitters[min_i],false);
-			#else
-			lt.__delete_min_insert(*lower_splitters[min_i],false);
-			#endif
+			lt.replaceMin(*lower_splitters[min_i]);
 		} else {
-			#ifdef LOSERTREE_OLD_GCC
-			lt.delete_min_insert(*someElement,true);
-			#else
-			lt.__delete_min_insert(*someElement,true);
-			#endif
+			lt.exhaustMin();
 			sequences_left--;
 		}
 	}
 	
-	if (sequences_left>0) {
-		// for the last sequence that still contains elements:
-		#ifdef LOSERTREE_OLD_GCC
-		unsigned int min_i = lt.get_min_source();
-		#else
-		unsigned int min_i = lt.__get_min_source();
-		#endif
-		std::copy(lower_splitters[min_i],upper_splitters[min_i],outputIterator);
+	// for the last sequence that still contains elements:
+	unsigned int min_i = lt.minSource();
+	return std::copy(lower_splitters[min_i],upper_splitters[min_i],outputIterator);
+}
+
+/*
+ * Merges the sequences with the loser tree into the output, with streaming
+ * stores if the output is large enough (see use_stream_store()). The lower
+ * splitters are modified, but not all of them are advanced to the upper
+ * splitters, the last sequence is copied without advancing its splitter.
+ */
+template<bool _Stable = false, typename _RandomAccessIterator, typename _OutputIteratorType>
+void multiwaymerge(_RandomAccessIterator* lower_splitters, _RandomAccessIterator* upper_splitters, _OutputIteratorType outputIterator, unsigned int num_of_pakets){
+	typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type _Distance;
+	_Distance n = 0;
+	for (unsigned int i = 0; i < num_of_pakets; i++) {
+		n += upper_splitters[i] - lower_splitters[i];
+	}
+	if (Memory::use_stream_store(outputIterator, n)) {
+		Memory::StreamOutput<_OutputIteratorType> output(outputIterator);
+		output.finish(losertree_merge<_Stable>(lower_splitters, upper_splitters, output.iterator(), num_of_pakets));
+	} else {
+		losertree_merge<_Stable>(lower_splitters, upper_splitters, outputIterator, num_of_pakets);
 	}
 }
 
@@ -0,0 +1,240 @@
+/*
+ *  Loser tree for the multiway merge.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the class LoserTree, a tournament tree which keeps
+ *				the current element of each of k sequences and returns the
+ *				smallest one. Each node caches the key of its loser next to
+ *				the index of its sequence, the nodes are stored in a cache
+ *				line aligned array, and the path from a leaf to the root is
+ *				replayed with conditional moves instead of branches.
+ *				Exhausted sequences get a sentinel key, which for arithmetic
+ *				types is the largest value, so that they lose all games.
+ *
+ */
+
+#ifndef LOSER_TREE_H
+#define LOSER_TREE_H
+
+#include <limits>
+#include <cstdlib>
+#include <new>
+#include <boost/type_traits/is_arithmetic.hpp>
+
+// the alignment of the node array
+#define LOSER_TREE_ALIGNMENT 64
+
+namespace malms {
+
+namespace Merging {
+
+/*
+ * The sentinel key of exhausted sequences. For types without a largest value
+ * the key of an exhausted sequence is left as it is, and the sequence index
+ * alone decides that it loses.
+ */
+template<typename _ValueType, bool _Arithmetic = std::numeric_limits<_ValueType>::is_specialized>
+struct LoserTreeSentinel {
+	static const bool enabled = false;
+	static void set(_ValueType&) {
+	}
+};
+
+template<typename _ValueType>
+struct LoserTreeSentinel<_ValueType, true> {
+	static const bool enabled = true;
+	static void set(_ValueType& key) {
+		key = std::numeric_limits<_ValueType>::has_infinity ? std::numeric_limits<_ValueType>::infinity() : std::numeric_limits<_ValueType>::max();
+	}
+};
+
+/*
+ * Compares the keys of two nodes, ties are broken by the sequence index.
+ * Built-in types are compared without branches, so that the games compile
+ * to conditional moves.
+ */
+template<typename _ValueType, bool _BuiltIn = boost::is_arithmetic<_ValueType>::value>
+struct LoserTreeCompare {
+	static bool beats(const _ValueType& a, unsigned int a_source, const _ValueType& b, unsigned int b_source) {
+		return a < b || (!(b < a) && a_source < b_source);
+	}
+};
+
+template<typename _ValueType>
+struct LoserTreeCompare<_ValueType, true> {
+	static bool beats(const _ValueType& a, unsigned int a_source, const _ValueType& b, unsigned int b_source) {
+		return (a < b) | ((a == b) & (a_source < b_source));
+	}
+};
+
+/*
+ * A loser tree over k sequences. The sequences are the leaves k..K-1 of a
+ * complete binary tree with K a power of two, the inner nodes 1..K-1 hold the
+ * losers of their games and node 0 the overall winner. Equal keys are won by
+ * the sequence with the lower index, so merging with the tree is stable.
+ * Exhausted sequences get the index source + K, which makes them lose every
+ * game, also against elements equal to the sentinel key.
+ *
+ * Usage: insertStart() or insertExhausted() for each sequence, then init().
+ * minSource() is the sequence of the smallest element, after taking it the
+ * next element of that sequence is given by replaceMin(), or exhaustMin()
+ * if the sequence has no more elements.
+ */
+template<typename _ValueType>
+class LoserTree {
+	private:
+		struct Node {
+			_ValueType key;
+			unsigned int source;
+		};
+
+		Node* nodes;
+		unsigned int k;
+		unsigned int K;
+
+		/*
+		 * Returns true if a wins against b.
+		 */
+		bool beats(const Node& a, const Node& b) const {
+			if (LoserTreeSentinel<_ValueType>::enabled) {
+				return LoserTreeCompare<_ValueType>::beats(a.key, a.source, b.key, b.source);
+			} else {
+				// an exhausted sequence loses, whatever its key is
+				bool a_live = a.source < K;
+				bool b_live = b.source < K;
+				return (a_live & !b_live) | ((a_live == b_live) & LoserTreeCompare<_ValueType>::beats(a.key, a.source, b.key, b.source));
+			}
+		}
+
+		/*
+		 * Plays the games on the path from the leaf of cur.source to the root,
+		 * the winner of each game goes up, the loser stays in the node.
+		 */
+		void replay(Node cur) {
+			for (unsigned int j = (K + (cur.source & (K-1))) >> 1; j > 0; j >>= 1) {
+				Node& n = nodes[j];
+				bool swap = beats(n, cur);
+				_ValueType key = swap ? n.key : cur.key;
+				unsigned int source = swap ? n.source : cur.source;
+				n.key = swap ? cur.key : n.key;
+				n.source = swap ? cur.source : n.source;
+				cur.key = key;
+				cur.source = source;
+			}
+			nodes[0] = cur;
+		}
+
+		/*
+		 * Returns the winner of the subtree of node j, storing the losers.
+		 * The leaves are kept in nodes[K..2K-1] until init() is done.
+		 */
+		Node initSubtree(unsigned int j) {
+			if (j >= K) return nodes[j];
+			Node left = initSubtree(2*j);
+			Node right = initSubtree(2*j+1);
+			if (beats(right, left)) {
+				nodes[j] = left;
+				return right;
+			} else {
+				nodes[j] = right;
+				return left;
+			}
+		}
+
+		// non copyable
+		LoserTree(const LoserTree&);
+		LoserTree& operator=(const LoserTree&);
+
+	public:
+		/*
+		 * Creates a tree for k sequences.
+		 */
+		LoserTree(unsigned int k) : nodes(NULL), k(k), K(1) {
+			while (K < k) K <<= 1;
+			void* m = NULL;
+			if (posix_memalign(&m, LOSER_TREE_ALIGNMENT, 2*K*sizeof(Node)) != 0) {
+				throw std::bad_alloc();
+			}
+			nodes = static_cast<Node*>(m);
+			for (unsigned int i = 0; i < 2*K; i++) {
+				new (&nodes[i]) Node();
+			}
+			for (unsigned int s = k; s < K; s++) {
+				insertExhausted(s);
+			}
+		}
+
+		~LoserTree() {
+			for (unsigned int i = 0; i < 2*K; i++) {
+				nodes[i].~Node();
+			}
+			free(nodes);
+		}
+
+		/*
+		 * Sets the first element of sequence source.
+		 */
+		void insertStart(const _ValueType& key, unsigned int source) {
+			nodes[K + source].key = key;
+			nodes[K + source].source = source;
+		}
+
+		/*
+		 * Marks sequence source as empty from the start.
+		 */
+		void insertExhausted(unsigned int source) {
+			LoserTreeSentinel<_ValueType>::set(nodes[K + source].key);
+			nodes[K + source].source = source + K;
+		}
+
+		/*
+		 * Plays all games once all sequences are inserted.
+		 */
+		void init() {
+			nodes[0] = initSubtree(1);
+		}
+
+		/*
+		 * Returns the sequence of the smallest element.
+		 */
+		unsigned int minSource() const {
+			return nodes[0].source;
+		}
+
+		/*
+		 * Returns the smallest element.
+		 */
+		const _ValueType& minKey() const {
+			return nodes[0].key;
+		}
+
+		/*
+		 * Replaces the smallest element by the next element of its sequence.
+		 */
+		void replaceMin(const _ValueType& key) {
+			Node cur;
+			cur.key = key;
+			cur.source = nodes[0].source;
+			replay(cur);
+		}
+
+		/*
+		 * Marks the sequence of the smallest element as exhausted.
+		 */
+		void exhaustMin() {
+			Node cur;
+			cur.key = nodes[0].key;
+			LoserTreeSentinel<_ValueType>::set(cur.key);
+			cur.source = nodes[0].source + K;
+			replay(cur);
+		}
+};
+
+} // namespace Merging
+
+} // namespace malms
+
+#endif
@@ -22,6 +22,8 @@
 #include<iterator>
 #include<cstdlib>
 #include<vector>
+#include<algorithm>
+#include<cstring>
 
 namespace malms {
 
@@ -38,54 +40,83 @@ struct PartitionElement {
 };
 
 /*
- * Partitions the sequence [begin,end) according to the pivot value.
- * This is basically the partition routine from the GNU STL Sort, slightly modified.
+ * Orders PartitionElements by value, and for the stable sort additionally by
+ * the index of their sequence, so that equal elements of lower sequences are
+ * selected first.
  */
-template<typename _RandomAccessIterator, typename _Tp>
-_RandomAccessIterator partitionPivot(_RandomAccessIterator begin,_RandomAccessIterator end, _Tp pivot) {
-	while (true) {
-		while (*begin < pivot) ++begin;
-		--end;
-		while (pivot < *end) --end;
-		if (!(begin < end)) return begin;
-		std::iter_swap(begin, end);
-		++begin;
+template<bool _Stable>
+struct PartitionLess {
+	template <typename _Value>
+	bool operator()(const PartitionElement<_Value>& a, const PartitionElement<_Value>& b) const {
+		return a.value < b.value;
 	}
-}
+};
+
+template<>
+struct PartitionLess<true> {
+	template <typename _Value>
+	bool operator()(const PartitionElement<_Value>& a, const PartitionElement<_Value>& b) const {
+		return a.value < b.value || (!(b.value < a.value) && a.paket < b.paket);
+	}
+};
 
 /*
- * Implements the quickselect selection algorithm. Partitions the elements in
- * [begin,end) so that the k-th element in sorted order is at the k-th position
- * in the sequence given by [begin,end). The k-th element can be accessed by
- * *(begin+k).
+ * Reduces the search range [first,last) of the splitters by splitting all
+ * sequences three-way at value: the elements less than value go into the
+ * lower part, the greater ones into the upper part, and the equal ones are
+ * taken in the order of their sequences. If the split falls into the equal
+ * elements, the splitters are found and N becomes 0.
  */
-template<typename _RandomAccessIterator, typename _Distance>
-void quickselect(_RandomAccessIterator begin, _RandomAccessIterator end, _Distance k) {
-	_RandomAccessIterator b = begin;
-	while (end - begin > 1) {
-		_RandomAccessIterator pivot = begin + (rand() % (end-begin));
-		_RandomAccessIterator cut = partitionPivot(begin,end,*pivot);
-		if (cut-begin > k) {
-			end = cut;
-		} else {
-			k -= (cut-begin);
-			begin = cut;
+template<typename _RandomAccessIterator,typename _Distance,typename _ValueType>
+void equal_split(_RandomAccessIterator* first,_RandomAccessIterator* last,_RandomAccessIterator* current,int num_of_pakets, const _ValueType& value, _Distance& reduce_prefix_size, _Distance& N) {
+	_Distance less = 0;
+	for (int j = 0; j < num_of_pakets; j++) {
+		current[j] = std::lower_bound(first[j], last[j], value);
+		less += current[j] - first[j];
+	}
+	if (reduce_prefix_size <= less) {
+		memcpy(last,current,num_of_pakets*sizeof(_RandomAccessIterator));
+		N = less;
+		return;
+	}
+	_Distance equal = 0;
+	for (int j = 0; j < num_of_pakets; j++) {
+		equal += std::upper_bound(current[j], last[j], value) - current[j];
+	}
+	if (reduce_prefix_size <= less + equal) {
+		_Distance take = reduce_prefix_size - less;
+		for (int j = 0; j < num_of_pakets && take > 0; j++) {
+			_Distance t = std::min<_Distance>(take, std::upper_bound(current[j], last[j], value) - current[j]);
+			current[j] += t;
+			take -= t;
+		}
+		memcpy(first,current,num_of_pakets*sizeof(_RandomAccessIterator));
+		memcpy(last,current,num_of_pakets*sizeof(_RandomAccessIterator));
+		reduce_prefix_size = 0;
+		N = 0;
+	} else {
+		for (int j = 0; j < num_of_pakets; j++) {
+			first[j] = std::upper_bound(current[j], last[j], value);
 		}
+		reduce_prefix_size -= less + equal;
+		N -= less + equal;
 	}
 }
 
-
-template<typename _RandomAccessIterator,typename _Distance>
-void median_split(_RandomAccessIterator* first,_RandomAccessIterator* last,_RandomAccessIterator* current,int num_of_pakets, _Distance& reduce_prefix_size, _Distance& N) {
-	typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
-
+/*
+ * Reduces the search range [first,last) of the splitters by splitting all
+ * sequences at the weighted median of their medians. For the stable sort,
+ * equal elements are ordered by the index of their sequence: in sequences
+ * before the one of the median they go into the lower part, in sequences
+ * after it into the upper part.
+ */
+template<bool _Stable,typename _RandomAccessIterator,typename _Distance,typename _ValueType>
+void median_split(_RandomAccessIterator* first,_RandomAccessIterator* last,_RandomAccessIterator* current,int num_of_pakets, _Distance& reduce_prefix_size, _Distance& N, PartitionElement<_ValueType>* partitionSeq) {
 	// (1.1) get medians of all sequences
 	for (unsigned int j = 0; j < num_of_pakets; j++) {
-		if (first[j] != last[j])
-			current[j] = first[j] + (last[j]-first[j])/2;
+		current[j] = first[j] + (last[j]-first[j])/2;
 	}
 	// (1.2) find weighted partition of the values at the current splitters
-	std::vector<PartitionElement<_ValueType> > partitionSeq(num_of_pakets);
 	unsigned int c = 0;
 	for (unsigned int j = 0; j < num_of_pakets; j++) {
 		if (first[j] != last[j]) {
@@ -96,7 +127,7 @@ void median_split(_RandomAccessIterator* first,_RandomAccessIterator* last,_Rand
 	}
 	
 	// sort showed to be faster than a weighted partition
-	std::sort(partitionSeq.begin(),partitionSeq.begin()+c);
+	std::sort(partitionSeq,partitionSeq+c,PartitionLess<_Stable>());
 	
 	// get weighted median of medians of all sequences
 	_Distance weight = 0;
@@ -114,7 +145,20 @@ void median_split(_RandomAccessIterator* first,_RandomAccessIterator* last,_Rand
 
 	// calc new splitters
 	for (int j=0;j<num_of_pakets;j++) {
-		if (j != paket) {
+		if (j == paket || first[j] == last[j]) continue;
+		if (_Stable && j < paket) {
+			if (medianValue < *current[j]) {
+				current[j] = std::upper_bound(first[j], current[j], medianValue);
+			} else {
+				current[j] = std::upper_bound(current[j],last[j],medianValue);
+			}
+		} else if (_Stable) {
+			if (*current[j] < medianValue) {
+				current[j] = std::lower_bound(current[j],last[j],medianValue);
+			} else {
+				current[j] = std::lower_bound(first[j], current[j], medianValue);
+			}
+		} else {
 			if (*current[j] < medianValue) {
 				current[j] = std::lower_bound(current[j],last[j],medianValue);
 			} else if (medianValue < *current[j]) {
@@ -129,6 +173,13 @@ void median_split(_RandomAccessIterator* first,_RandomAccessIterator* last,_Rand
 		sum_els += current[j] - first[j];
 	}
 
+	// if most sequences have only one element left, all of them may end up
+	// on one side of the split, then the equal elements are split directly
+	if ((sum_els < reduce_prefix_size && sum_els == 0) || (sum_els >= reduce_prefix_size && sum_els == N)) {
+		equal_split(first,last,current,num_of_pakets,medianValue,reduce_prefix_size,N);
+		return;
+	}
+
 	if (sum_els < reduce_prefix_size) {
 		// go in upper half
 		memcpy(first,current,num_of_pakets*sizeof(_RandomAccessIterator));
@@ -143,10 +194,16 @@ void median_split(_RandomAccessIterator* first,_RandomAccessIterator* last,_Rand
 
 /*
  * Implements the splitting algorithm based on the selection algorithm from
- * Frederickson and Johnson.
+ * Frederickson and Johnson, restricted to the elements between the splitter
+ * rows lower and upper: row is set to the splitters that put prefix_size of
+ * these elements into the lower halves. As lower and upper are valid splits,
+ * the result lies between them, so rows computed this way stay ordered.
+ * The scratch array must hold num_of_pakets+16 elements.
+ * With _Stable, equal elements are split in the order of their sequences.
  */
-template<typename _RandomAccessIterator,typename _Distance>
-void reduce_split(_RandomAccessIterator** splitters, int num_of_pakets, int paket_index, _Distance prefix_size) {
+template<bool _Stable, typename _RandomAccessIterator,typename _Distance>
+void reduce_split_between(_RandomAccessIterator* lower, _RandomAccessIterator* upper, _RandomAccessIterator* row, int num_of_pakets, _Distance prefix_size,
+                          PartitionElement<typename std::iterator_traits<_RandomAccessIterator>::value_type>* scratch) {
 	/* typedefs */
 	typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
 
@@ -154,8 +211,8 @@ void reduce_split(_RandomAccessIterator** splitters, int num_of_pakets, int pake
 	_RandomAccessIterator first[num_of_pakets];
 	_RandomAccessIterator last[num_of_pakets];
 	_RandomAccessIterator current[num_of_pakets];
-	memcpy(first,splitters[0],num_of_pakets*sizeof(_RandomAccessIterator));
-	memcpy(last,splitters[num_of_pakets],num_of_pakets*sizeof(_RandomAccessIterator));
+	memcpy(first,lower,num_of_pakets*sizeof(_RandomAccessIterator));
+	memcpy(last,upper,num_of_pakets*sizeof(_RandomAccessIterator));
 	
 	_Distance reduce_prefix_size = prefix_size;
 	
@@ -170,13 +227,12 @@ void reduce_split(_RandomAccessIterator** splitters, int num_of_pakets, int pake
 	/* Reduce Split */
 	while (N > reduceUntil) {
 		// reduce
-		median_split(first,last,current,num_of_pakets,reduce_prefix_size,N);
+		median_split<_Stable>(first,last,current,num_of_pakets,reduce_prefix_size,N,scratch);
 	}
 	
 	/* Find Splitters using Linear Time Selection */
-	std::vector<PartitionElement<_ValueType> > partitionSeq(N);
-	typedef typename std::vector<PartitionElement<_ValueType> >::iterator parIt;
-	parIt partitionit = partitionSeq.begin();
+	PartitionElement<_ValueType>* partitionSeq = scratch;
+	PartitionElement<_ValueType>* partitionit = partitionSeq;
 	for (int j = 0; j < num_of_pakets; j++) {
 		for (_RandomAccessIterator i = first[j]; i < last[j]; i++) {
 			partitionit->value = *i;
@@ -185,7 +241,11 @@ void reduce_split(_RandomAccessIterator** splitters, int num_of_pakets, int pake
 		}
 	}
 	
-	quickselect(partitionSeq.begin(), partitionSeq.end(), reduce_prefix_size-1);
+	// introselect is deterministic, unlike a quickselect with rand(), which
+	// serializes the split pakets on the lock of the global generator
+	if (reduce_prefix_size > 0 && reduce_prefix_size < N) {
+		std::nth_element(partitionSeq, partitionSeq+reduce_prefix_size, partitionSeq+N, PartitionLess<_Stable>());
+	}
 	
 	for (int i = 0; i < N; i++) {
 		
@@ -199,7 +259,30 @@ void reduce_split(_RandomAccessIterator** splitters, int num_of_pakets, int pake
 	}
 	
 	/* save results */
-	memcpy(splitters[paket_index+1],last,sizeof(_RandomAccessIterator)*num_of_pakets);
+	memcpy(row,last,sizeof(_RandomAccessIterator)*num_of_pakets);
+}
+
+/*
+ * Implements the splitting algorithm based on the selection algorithm from
+ * Frederickson and Johnson.
+ * The scratch array must hold num_of_pakets+16 elements, if it is NULL the
+ * scratch space is allocated for this call.
+ * With _Stable, equal elements are split in the order of their sequences.
+ */
+template<bool _Stable = false, typename _RandomAccessIterator,typename _Distance>
+void reduce_split(_RandomAccessIterator** splitters, int num_of_pakets, int paket_index, _Distance prefix_size,
+                  PartitionElement<typename std::iterator_traits<_RandomAccessIterator>::value_type>* scratch = NULL) {
+	/* typedefs */
+	typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
+	
+	/* init scratch space */
+	std::vector<PartitionElement<_ValueType> > local_scratch;
+	if (scratch == NULL) {
+		local_scratch.resize(num_of_pakets+16);
+		scratch = &local_scratch[0];
+	}
+
+	reduce_split_between<_Stable>(splitters[0], splitters[num_of_pakets], splitters[paket_index+1], num_of_pakets, prefix_size, scratch);
 }
 
 } // namespace Splitting
@@ -6,7 +6,12 @@
  *
  *  Description:
  *				Implements the class MergePaket which implements the Workpaket
- *				Interface.
+ *				Interface. Up to SMALL_MERGE_MAX_K sequences are merged with
+ *				the kernels of small_merge.h, more with the loser tree.
+ *				A splittable MergePaket merges large outputs in chunks and
+ *				gives the back half of its remaining output to a new paket
+ *				when the WorkQueue asks for it between two chunks. Whether
+ *				the output is streamed is decided once for all chunks.
  *				
  */
 
@@ -15,17 +20,27 @@
 #define MERGE_PAKET_H
 
 #include <vector>
+#include <algorithm>
 #include "workpaket.h"
 #include "loser_merge.h"
+#include "small_merge.h"
+#include "median_split.h"
+
+// a splittable merge paket merges in chunks of this many elements, or of
+// MERGE_SPLIT_CHUNK_PER_SEQUENCE elements per sequence if that is more, so
+// that the splitter search for the end of each chunk is cheap in comparison
+#define MERGE_SPLIT_CHUNK (1 << 18)
+#define MERGE_SPLIT_CHUNK_PER_SEQUENCE 64
 
 namespace malms {
 
 /*
  * Implements the Workpaket Interface. The constructor takes the parameters for
  * merging and saves them into the class attributes. The () operator excutes
- * the merging routine.
+ * the merging routine. With _Stable, equal elements are merged in the order
+ * of their sequences.
  */
-template<typename _RandomAccessIterator, typename _OutputIterator>
+template<typename _RandomAccessIterator, typename _OutputIterator, bool _Stable = false>
 class MergePaket : public Workpaket {
 	private:
 		typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type _Distance;
@@ -41,6 +56,122 @@ class MergePaket : public Workpaket {
 		
 		// use buffered merge or not
 		bool buffered;
+		
+		// scratch space for 3*num_of_pakets splitters, allocated on each call if NULL
+		_RandomAccessIterator* scratch;
+		// scratch space of num_of_pakets+16 elements for the splitter search
+		// of a splittable paket, allocated on each call with more than one
+		// chunk if NULL
+		Splitting::PartitionElement<_ValueType>* split_scratch;
+		
+		// the splitters and the scratch spaces of a part split off a running
+		// paket, which owns them, empty otherwise
+		std::vector<_RandomAccessIterator> part_splitters;
+		std::vector<Splitting::PartitionElement<_ValueType> > part_split_scratch;
+		
+		/*
+		 * Selects the merge kernel by the number of sequences.
+		 */
+		template<typename _Iterator>
+		void merge(_Iterator* lower, _Iterator* upper, _OutputIterator output) {
+			if (!Merging::small_merge<_Stable>(lower, upper, output, num_of_pakets)) {
+				Merging::multiwaymerge<_Stable>(lower, upper, output, num_of_pakets);
+			}
+		}
+		
+		/*
+		 * Merges into an output shared by several calls and returns its end,
+		 * with the kernels of merge() for more than two sequences, but without
+		 * choosing the stores.
+		 */
+		template<typename _Output>
+		_Output mergeTo(_RandomAccessIterator* lower, _RandomAccessIterator* upper, _Output output) {
+			if (!Merging::small_merge_to<_Stable>(lower, upper, output, num_of_pakets)) {
+				output = Merging::losertree_merge<_Stable>(lower, upper, output, num_of_pakets);
+			}
+			return output;
+		}
+		
+		/*
+		 * Merges one chunk of n elements, into the output itself with merge(),
+		 * or into the streamed output of the whole paket with mergeTo().
+		 */
+		_OutputIterator mergeChunk(_RandomAccessIterator* lower, _RandomAccessIterator* upper, _OutputIterator output, _Distance n) {
+			merge(lower, upper, output);
+			return output + n;
+		}
+		
+		template<typename _Output>
+		_Output mergeChunk(_RandomAccessIterator* lower, _RandomAccessIterator* upper, _Output output, _Distance) {
+			return mergeTo(lower, upper, output);
+		}
+		
+		/*
+		 * Merges the n elements between lower and upper in chunks. Between two
+		 * chunks, if a split is requested, the back half of the remaining
+		 * elements is given to a new paket, the end of a chunk and the cut
+		 * for the split are found with the splitter search on the remaining
+		 * elements, into the row cut. Both splitter rows are modified.
+		 * The kernels for more than two sequences stream large outputs, the
+		 * chunks are too small for that on their own, so the stores are
+		 * chosen by the size of the paket and all chunks write to one
+		 * streamed output.
+		 */
+		void chunkedMerge(_RandomAccessIterator* lower, _RandomAccessIterator* upper, _RandomAccessIterator* cut, _Distance n) {
+			if (num_of_pakets > 2 && Memory::use_stream_store(outputIterator, n)) {
+				Memory::StreamOutput<_OutputIterator> output(outputIterator);
+				output.finish(chunkedMerge(lower, upper, cut, n, output.iterator()));
+			} else {
+				chunkedMerge(lower, upper, cut, n, outputIterator);
+			}
+		}
+		
+		template<typename _Output>
+		_Output chunkedMerge(_RandomAccessIterator* lower, _RandomAccessIterator* upper, _RandomAccessIterator* cut, _Distance n, _Output output) {
+			_Distance chunk = std::max<_Distance>(MERGE_SPLIT_CHUNK, static_cast<_Distance>(MERGE_SPLIT_CHUNK_PER_SEQUENCE) * num_of_pakets);
+			std::vector<Splitting::PartitionElement<_ValueType> > local_scratch;
+			Splitting::PartitionElement<_ValueType>* search_scratch = split_scratch;
+			if (search_scratch == NULL && n > chunk) {
+				local_scratch.resize(num_of_pakets + 16);
+				search_scratch = &local_scratch[0];
+			}
+			// the position of the next chunk in the output
+			_OutputIterator position = outputIterator;
+			while (n > chunk) {
+				if (n >= 2*chunk && splitRequested()) {
+					_Distance half = n / 2;
+					Splitting::reduce_split_between<_Stable>(lower, upper, cut, num_of_pakets, half, search_scratch);
+					pushSplit(newPart(cut, upper, position + half, num_of_pakets));
+					std::copy(cut, cut+num_of_pakets, upper);
+					n = half;
+					continue;
+				}
+				Splitting::reduce_split_between<_Stable>(lower, upper, cut, num_of_pakets, chunk, search_scratch);
+				output = mergeChunk(lower, cut, output, chunk);
+				std::copy(cut, cut+num_of_pakets, lower);
+				position += chunk;
+				n -= chunk;
+			}
+			return mergeChunk(lower, upper, output, n);
+		}
+		
+		/*
+		 * Creates a part split off a running paket, which owns a copy of the
+		 * splitters, so that the part can not be copied itself.
+		 */
+		static MergePaket* newPart(_RandomAccessIterator* lower, _RandomAccessIterator* upper, _OutputIterator output, unsigned int num_of_pakets) {
+			MergePaket* part = new MergePaket(NULL, NULL, output, num_of_pakets);
+			part->part_splitters.resize(5*num_of_pakets);
+			std::copy(lower, lower+num_of_pakets, part->part_splitters.begin());
+			std::copy(upper, upper+num_of_pakets, part->part_splitters.begin()+num_of_pakets);
+			part->lower_splitters = &part->part_splitters[0];
+			part->upper_splitters = &part->part_splitters[num_of_pakets];
+			part->scratch = &part->part_splitters[2*num_of_pakets];
+			part->part_split_scratch.resize(num_of_pakets + 16);
+			part->split_scratch = &part->part_split_scratch[0];
+			part->setSplittable(true);
+			return part;
+		}
 	public:
 		/*
 		 * Merges num_of_pakets sorted sequences into one sorted sequence.
@@ -50,15 +181,28 @@ class MergePaket : public Workpaket {
 			if (!buffered) {
 			
 				// need to copy splitters if not buffered, because they are modified during merge
-				_ValueType** tmp_lower_splitters = new _ValueType*[num_of_pakets];
-				_ValueType** tmp_upper_splitters = new _ValueType*[num_of_pakets];
+				_RandomAccessIterator* tmp_splitters = scratch;
+				if (scratch == NULL) {
+					tmp_splitters = new _RandomAccessIterator[3*num_of_pakets];
+				}
+				_RandomAccessIterator* tmp_lower_splitters = tmp_splitters;
+				_RandomAccessIterator* tmp_upper_splitters = tmp_splitters + num_of_pakets;
 				std::copy(lower_splitters, lower_splitters+num_of_pakets, tmp_lower_splitters);
 				std::copy(upper_splitters, upper_splitters+num_of_pakets, tmp_upper_splitters);
 				
-				Merging::multiwaymerge(tmp_lower_splitters, tmp_upper_splitters, outputIterator, num_of_pakets);
+				if (isSplittable()) {
+					_Distance merge_size = 0;
+					for (unsigned int i=0; i<num_of_pakets;i++) {
+						merge_size += upper_splitters[i] - lower_splitters[i];
+					}
+					chunkedMerge(tmp_lower_splitters, tmp_upper_splitters, tmp_splitters + 2*num_of_pakets, merge_size);
+				} else {
+					merge(tmp_lower_splitters, tmp_upper_splitters, outputIterator);
+				}
 				
-				delete [] tmp_lower_splitters;
-				delete [] tmp_upper_splitters;
+				if (scratch == NULL) {
+					delete [] tmp_splitters;
+				}
 			
 			} else {
 			
@@ -84,7 +228,7 @@ class MergePaket : public Workpaket {
 				}
 				
 				// call merge
-				Merging::multiwaymerge(buffer_lower_splitters, buffer_upper_splitters, outputIterator, num_of_pakets);
+				merge(buffer_lower_splitters, buffer_upper_splitters, outputIterator);
 				
 				// delete buffers
 				delete [] input_buffer;
@@ -96,11 +240,29 @@ class MergePaket : public Workpaket {
 		/*
 		 * Constructor initializes the merge attributes.
 		 */
-		MergePaket(_RandomAccessIterator* lower_splitters, _RandomAccessIterator* upper_splitters, _OutputIterator _outputIterator, unsigned int num_of_pakets)
+		MergePaket(_RandomAccessIterator* lower_splitters, _RandomAccessIterator* upper_splitters, _OutputIterator _outputIterator, unsigned int num_of_pakets, _RandomAccessIterator* scratch = NULL, Splitting::PartitionElement<_ValueType>* split_scratch = NULL)
 			:	num_of_pakets(num_of_pakets),
 				lower_splitters(lower_splitters),
 				upper_splitters(upper_splitters),
-				outputIterator(_outputIterator), buffered(false) {
+				outputIterator(_outputIterator), buffered(false), scratch(scratch), split_scratch(split_scratch) {
+		}
+		
+		/*
+		 * Sets whether the sequences are copied into one contiguous buffer
+		 * before merging, a buffered paket is not splittable.
+		 */
+		void setBuffered(bool buffered) {
+			this->buffered = buffered;
+			if (buffered) Workpaket::setSplittable(false);
+		}
+		
+		/*
+		 * Sets whether the paket merges in chunks and can be split while it
+		 * runs. The buffered merge is never split, because the parts would
+		 * read from the buffer of this paket.
+		 */
+		void setSplittable(bool splittable) {
+			Workpaket::setSplittable(splittable && !buffered);
 		}
 };
 
@@ -0,0 +1,53 @@
+/*
+ *  Storage for Workpakets created while a sort is running.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the class PaketPool, a synchronized store of
+ *				pakets which are created by other pakets, e.g. the recursive
+ *				pakets of the sample sort. The pakets stay valid until the
+ *				pool is destroyed, after the queue has finished them.
+ *
+ */
+
+#ifndef PAKET_POOL_H
+#define PAKET_POOL_H
+
+#include <deque>
+#include <boost/thread.hpp>
+
+namespace malms {
+
+/*
+ * A synchronized store of pakets. A deque is used, because it does not move
+ * its elements when it grows.
+ */
+template<typename _Paket>
+class PaketPool {
+	private:
+		boost::mutex mut;
+		std::deque<_Paket> pakets;
+
+		// non copyable
+		PaketPool(const PaketPool&);
+		PaketPool& operator=(const PaketPool&);
+
+	public:
+		PaketPool() {
+		}
+
+		/*
+		 * Stores a copy of paket and returns a pointer to it.
+		 */
+		_Paket* create(const _Paket& paket) {
+			boost::lock_guard<boost::mutex> lock(mut);
+			pakets.push_back(paket);
+			return &pakets.back();
+		}
+};
+
+} // namespace
+
+#endif
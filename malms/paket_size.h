@@ -0,0 +1,27 @@
+/*
+ *  Even split of a sequence into pakets.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements paket_size, which splits n elements (or pages,
+ *				blocks) into num_pakets pakets whose sizes differ by at most
+ *				one.
+ *				
+ */
+
+#ifndef PAKET_SIZE_H
+#define PAKET_SIZE_H
+
+namespace malms {
+
+// Returns the size of each paket for any number of pakets and any paket.
+template<typename _Distance>
+inline _Distance paket_size(_Distance n,unsigned int num_pakets,unsigned int paket) {
+	return n/num_pakets + ((paket < n%num_pakets)?1:0);
+}
+
+}
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ *  Workpaket for prefaulting memory.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the class PrefaultPaket which implements the
+ *				Workpaket Interface. It touches every page of a memory range,
+ *				so that the page faults of e.g. a mapped input file are taken
+ *				in parallel before the sort starts.
+ *				
+ */
+
+#ifndef PREFAULT_PAKET_H
+#define PREFAULT_PAKET_H
+
+#include <cstddef>
+#include "workpaket.h"
+
+namespace malms {
+
+/*
+ * Implements the Workpaket Interface. The constructor takes the memory range
+ * [begin,end), the page size and whether the contents have to be kept. The
+ * () operator writes the first byte of each page back to itself, which faults
+ * in the page for writing (for private mappings this also does the copy on
+ * write). Uninitialized memory is written with zero instead, which saves the
+ * read fault mapping the zero page.
+ */
+class PrefaultPaket : public Workpaket {
+	private:
+		// attributes
+		volatile char* begin;
+		volatile char* end;
+		std::size_t page_size;
+		bool preserve;
+		
+	public:
+		/*
+		 * Touches each page in [begin,end).
+		 */
+		void operator()() {
+			if (preserve) {
+				for (volatile char* p = begin; p < end; p += page_size) {
+					*p = *p;
+				}
+			} else {
+				for (volatile char* p = begin; p < end; p += page_size) {
+					*p = 0;
+				}
+			}
+		}
+		
+		/*
+		 * Constructor initializes the range.
+		 */
+		PrefaultPaket(char* begin, char* end, std::size_t page_size, bool preserve = true) {
+			this->begin = begin;
+			this->end = end;
+			this->page_size = page_size;
+			this->preserve = preserve;
+		}
+};
+
+} // namespace
+
+#endif
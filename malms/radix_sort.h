@@ -0,0 +1,249 @@
+/*
+ *  LSD Radix Sort for integral and floating-point keys.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements an out-of-place least significant digit radix sort,
+ *				which is used for run formation of value types that have an
+ *				order preserving mapping to unsigned integers. The mapping is
+ *				given by the RadixTraits, which are specialized for the 32 and
+ *				64 bit integers and the IEEE floating-point types.
+ *
+ */
+
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <iterator>
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+
+// number of bits sorted in each pass
+#define RADIX_BITS 11
+// runs smaller than this are sorted with a comparison based sort
+#define RADIX_SORT_THRESHOLD 1024
+
+namespace malms {
+
+namespace Sorting {
+
+/*
+ * The RadixTraits map a value to an unsigned integer key, so that the order of
+ * the keys is the same as the order of the values given by operator<.
+ * Only types with enabled == true are sorted with radix sort.
+ */
+template<typename _ValueType>
+struct RadixTraits {
+	static const bool enabled = false;
+};
+
+/*
+ * Unsigned integers are their own key.
+ */
+template<typename _ValueType, typename _KeyType>
+struct UnsignedRadixTraits {
+	static const bool enabled = true;
+	typedef _KeyType key_type;
+	static inline key_type key(const _ValueType& v) {
+		return static_cast<key_type>(v);
+	}
+};
+
+/*
+ * Signed integers in two's complement are mapped to unsigned keys by flipping
+ * the sign bit.
+ */
+template<typename _ValueType, typename _KeyType>
+struct SignedRadixTraits {
+	static const bool enabled = true;
+	typedef _KeyType key_type;
+	static inline key_type key(const _ValueType& v) {
+		return static_cast<key_type>(v) ^ (static_cast<key_type>(1) << (sizeof(key_type)*8-1));
+	}
+};
+
+/*
+ * IEEE floats are mapped by flipping all bits of negative numbers and only the
+ * sign bit of positive numbers. -0.0 is mapped like 0.0, since they are equal
+ * for operator< (which matters for the stable sort).
+ */
+template<typename _ValueType, typename _KeyType>
+struct FloatRadixTraits {
+	static const bool enabled = true;
+	typedef _KeyType key_type;
+	static inline key_type key(const _ValueType& v) {
+		key_type bits;
+		memcpy(&bits, &v, sizeof(key_type));
+		bits &= -static_cast<key_type>((bits << 1) != 0);
+		const key_type signbit = static_cast<key_type>(1) << (sizeof(key_type)*8-1);
+		key_type mask = -(bits >> (sizeof(key_type)*8-1)) | signbit;
+		return bits ^ mask;
+	}
+};
+
+template<> struct RadixTraits<int> : public SignedRadixTraits<int,uint32_t> {};
+template<> struct RadixTraits<unsigned int> : public UnsignedRadixTraits<unsigned int,uint32_t> {};
+template<> struct RadixTraits<long> : public SignedRadixTraits<long,unsigned long> {};
+template<> struct RadixTraits<unsigned long> : public UnsignedRadixTraits<unsigned long,unsigned long> {};
+template<> struct RadixTraits<long long> : public SignedRadixTraits<long long,uint64_t> {};
+template<> struct RadixTraits<unsigned long long> : public UnsignedRadixTraits<unsigned long long,uint64_t> {};
+template<> struct RadixTraits<float> : public FloatRadixTraits<float,uint32_t> {};
+template<> struct RadixTraits<double> : public FloatRadixTraits<double,uint64_t> {};
+
+
+/*
+ * Scatters the elements of [src,src+n) into dst according to the digit at
+ * position shift. offsets holds the start position of each bucket in dst.
+ */
+template<typename _SourceIterator, typename _TargetIterator, typename _Traits, typename _Distance>
+void radix_scatter(_SourceIterator src, _Distance n, _TargetIterator dst, unsigned int shift, _Distance* offsets) {
+	const typename _Traits::key_type mask = (1 << RADIX_BITS) - 1;
+	for (_Distance i = 0; i < n; i++) {
+		unsigned int digit = (_Traits::key(src[i]) >> shift) & mask;
+		dst[offsets[digit]++] = src[i];
+	}
+}
+
+/*
+ * Sorts [begin,end) into the buffer [buffer,buffer+(end-begin)) using LSD radix
+ * sort. The first pass reads directly from the input, so no separate copy is
+ * needed. The input sequence is used as temporary space for the following
+ * passes and is left in an unspecified order. Passes where all elements have
+ * the same digit are skipped.
+ */
+template<typename _RandomAccessIterator, typename _ValueType>
+void radix_sort_copy(_RandomAccessIterator begin, _RandomAccessIterator end, _ValueType* buffer) {
+	typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type _Distance;
+	typedef RadixTraits<_ValueType> _Traits;
+	typedef typename _Traits::key_type _KeyType;
+
+	const unsigned int num_buckets = 1 << RADIX_BITS;
+	const unsigned int num_passes = (sizeof(_KeyType)*8 + RADIX_BITS - 1) / RADIX_BITS;
+	const _KeyType mask = num_buckets - 1;
+
+	_Distance n = end - begin;
+	if (n == 0) return;
+
+	// count the digits of all passes while reading the input once
+	_Distance histogram[num_passes][num_buckets];
+	memset(histogram, 0, sizeof(histogram));
+	for (_RandomAccessIterator it = begin; it != end; ++it) {
+		_KeyType k = _Traits::key(*it);
+		for (unsigned int p = 0; p < num_passes; p++) {
+			histogram[p][(k >> (p*RADIX_BITS)) & mask]++;
+		}
+	}
+
+	// transform the histograms into bucket offsets and skip passes where
+	// all elements fall into one bucket
+	bool trivial[num_passes];
+	for (unsigned int p = 0; p < num_passes; p++) {
+		trivial[p] = false;
+		_Distance sum = 0;
+		for (unsigned int b = 0; b < num_buckets; b++) {
+			_Distance count = histogram[p][b];
+			if (count == n) trivial[p] = true;
+			histogram[p][b] = sum;
+			sum += count;
+		}
+	}
+
+	// ping-pong between the buffer and the input, starting with the input
+	bool in_buffer = false;
+	for (unsigned int p = 0; p < num_passes; p++) {
+		if (trivial[p]) continue;
+		if (in_buffer) {
+			radix_scatter<_ValueType*,_RandomAccessIterator,_Traits>(buffer, n, begin, p*RADIX_BITS, histogram[p]);
+		} else {
+			radix_scatter<_RandomAccessIterator,_ValueType*,_Traits>(begin, n, buffer, p*RADIX_BITS, histogram[p]);
+		}
+		in_buffer = !in_buffer;
+	}
+
+	// an even number of passes leaves the result in the input
+	if (!in_buffer) {
+		std::copy(begin, end, buffer);
+	}
+}
+
+/*
+ * Sorts [begin,end) in place using MSD radix sort (American flag sort), with
+ * the digit at position shift. Buckets are permuted in place by following
+ * the cycles of misplaced elements, then sorted recursively by the next lower
+ * digit. Buckets smaller than RADIX_SORT_THRESHOLD are sorted with GNU-sort.
+ */
+template<typename _Traits, typename _RandomAccessIterator>
+void radix_sort_inplace(_RandomAccessIterator begin, _RandomAccessIterator end, int shift) {
+	typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type _Distance;
+	typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
+	typedef typename _Traits::key_type _KeyType;
+
+	const unsigned int num_buckets = 1 << RADIX_BITS;
+	const _KeyType mask = num_buckets - 1;
+
+	_Distance n = end - begin;
+	if (n < RADIX_SORT_THRESHOLD) {
+		std::sort(begin, end);
+		return;
+	}
+
+	// bucket boundaries of the current digit
+	_Distance next[num_buckets];
+	_Distance bucket_end[num_buckets];
+	memset(bucket_end, 0, sizeof(bucket_end));
+	for (_RandomAccessIterator it = begin; it != end; ++it) {
+		bucket_end[(_Traits::key(*it) >> shift) & mask]++;
+	}
+	_Distance sum = 0;
+	for (unsigned int b = 0; b < num_buckets; b++) {
+		next[b] = sum;
+		sum += bucket_end[b];
+		bucket_end[b] = sum;
+	}
+
+	// move each element into its bucket
+	for (unsigned int b = 0; b < num_buckets; b++) {
+		while (next[b] < bucket_end[b]) {
+			_ValueType v = begin[next[b]];
+			unsigned int d = (_Traits::key(v) >> shift) & mask;
+			while (d != b) {
+				std::swap(v, begin[next[d]++]);
+				d = (_Traits::key(v) >> shift) & mask;
+			}
+			begin[next[b]++] = v;
+		}
+	}
+
+	// sort the buckets by the next digit, the lowest digit may overlap
+	if (shift == 0) return;
+	int next_shift = (shift > RADIX_BITS) ? shift - RADIX_BITS : 0;
+	_Distance bucket_begin = 0;
+	for (unsigned int b = 0; b < num_buckets; b++) {
+		if (bucket_end[b] - bucket_begin > 1) {
+			radix_sort_inplace<_Traits>(begin + bucket_begin, begin + bucket_end[b], next_shift);
+		}
+		bucket_begin = bucket_end[b];
+	}
+}
+
+/*
+ * Sorts [begin,end) in place using MSD radix sort, starting with the highest
+ * RADIX_BITS bits of the key. Needs no buffer, but is slower than
+ * radix_sort_copy.
+ */
+template<typename _RandomAccessIterator>
+void radix_sort_inplace(_RandomAccessIterator begin, _RandomAccessIterator end) {
+	typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
+	typedef RadixTraits<_ValueType> _Traits;
+	typedef typename _Traits::key_type _KeyType;
+	radix_sort_inplace<_Traits>(begin, end, static_cast<int>(sizeof(_KeyType)*8) - RADIX_BITS);
+}
+
+} // namespace Sorting
+
+} // namespace malms
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ *  Run formation kernels.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Selects the kernel that sorts the slice of a SortPaket into its
+ *				run buffer. The kernel is chosen at compile time from the
+ *				RadixTraits and SimdTraits of the value type, and at runtime
+ *				from the size of the slice: small slices are sorted with the
+ *				vectorized sort, large ones with radix sort.
+ *
+ */
+
+#ifndef RUN_FORMATION_H
+#define RUN_FORMATION_H
+
+#include <iterator>
+#include <algorithm>
+#include "radix_sort.h"
+#include "simd_sort.h"
+
+namespace malms {
+
+namespace Sorting {
+
+/*
+ * Comparison based sorting of the buffer, GNU stable sort or GNU-sort.
+ */
+template<bool _Stable>
+struct ComparisonSort {
+	template<typename _ValueType>
+	static void sort(_ValueType* begin, _ValueType* end) {
+		std::sort(begin,end);
+	}
+};
+
+template<>
+struct ComparisonSort<true> {
+	template<typename _ValueType>
+	static void sort(_ValueType* begin, _ValueType* end) {
+		std::stable_sort(begin,end);
+	}
+};
+
+/*
+ * Default kernel: copies the slice into the buffer and sorts it with GNU-sort.
+ */
+template<typename _RandomAccessIterator, typename _ValueType, bool _Stable, bool _Radix = RadixTraits<_ValueType>::enabled>
+struct RunFormation {
+	static void sort(_RandomAccessIterator begin, _RandomAccessIterator end, _ValueType* buffer) {
+		std::copy(begin,end,buffer);
+		ComparisonSort<_Stable>::sort(buffer,buffer+(end-begin));
+	}
+};
+
+/*
+ * Kernel for types with a radix key: sorts the slice with LSD radix sort
+ * directly into the buffer. Small slices are sorted with the vectorized sort
+ * if the CPU supports it, otherwise by comparison. The thresholds grow with
+ * the number of passes of the key type (see timing/benchrunformation).
+ * Radix sort is stable and the vectorized sort is only used for plain integers,
+ * so only the comparison sort depends on _Stable.
+ */
+template<typename _RandomAccessIterator, typename _ValueType, bool _Stable>
+struct RunFormation<_RandomAccessIterator, _ValueType, _Stable, true> {
+	static void sort(_RandomAccessIterator begin, _RandomAccessIterator end, _ValueType* buffer) {
+		const long scale = sizeof(typename RadixTraits<_ValueType>::key_type)/4;
+		if (end - begin < SIMD_SORT_THRESHOLD * scale && simd_sort_copy(begin,end,buffer)) {
+			return;
+		}
+		if (end - begin >= RADIX_SORT_THRESHOLD * scale) {
+			radix_sort_copy(begin,end,buffer);
+		} else {
+			std::copy(begin,end,buffer);
+			ComparisonSort<_Stable>::sort(buffer,buffer+(end-begin));
+		}
+	}
+};
+
+/*
+ * Sorts [begin,end) into [buffer,buffer+(end-begin)). The input sequence may be
+ * used as temporary space and is left in an unspecified order. With _Stable,
+ * the order of equal elements is preserved.
+ */
+template<bool _Stable, typename _RandomAccessIterator, typename _ValueType>
+inline void form_run(_RandomAccessIterator begin, _RandomAccessIterator end, _ValueType* buffer) {
+	RunFormation<_RandomAccessIterator,_ValueType,_Stable>::sort(begin,end,buffer);
+}
+
+/*
+ * Default in-place kernel: GNU-sort.
+ */
+template<typename _RandomAccessIterator, typename _ValueType, bool _Radix = RadixTraits<_ValueType>::enabled>
+struct InplaceRunFormation {
+	static void sort(_RandomAccessIterator begin, _RandomAccessIterator end) {
+		std::sort(begin,end);
+	}
+};
+
+/*
+ * In-place kernel for types with RadixTraits: large runs are sorted with MSD
+ * radix sort, small runs with GNU-sort.
+ */
+template<typename _RandomAccessIterator, typename _ValueType>
+struct InplaceRunFormation<_RandomAccessIterator, _ValueType, true> {
+	static void sort(_RandomAccessIterator begin, _RandomAccessIterator end) {
+		const long scale = sizeof(typename RadixTraits<_ValueType>::key_type) / 4;
+		if (end - begin >= RADIX_SORT_THRESHOLD * scale) {
+			radix_sort_inplace(begin,end);
+		} else {
+			std::sort(begin,end);
+		}
+	}
+};
+
+/*
+ * Sorts [begin,end) in place, for sorting without a run buffer.
+ */
+template<typename _RandomAccessIterator>
+inline void form_run_inplace(_RandomAccessIterator begin, _RandomAccessIterator end) {
+	typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
+	InplaceRunFormation<_RandomAccessIterator,_ValueType>::sort(begin,end);
+}
+
+} // namespace Sorting
+
+} // namespace malms
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ *  Implements the malleable sample sort.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				This file implements malms::sample_sort, a super scalar sample
+ *				sort on the Maleable Scheduler. The input is classified with a
+ *				splitter tree in parallel, distributed into the buckets of a
+ *				buffer, and the buckets are sorted by SampleSortPakets, which
+ *				split large buckets recursively into pakets of their own. Each
+ *				element is moved about once per level instead of twice as in
+ *				the mergesort, and no barrier is needed after the distribution.
+ *
+ */
+
+#ifndef SAMPLE_SORT_H
+#define SAMPLE_SORT_H
+
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <cstddef>
+#include <stdint.h>
+
+#include "threadpool/workqueue.h"
+#include "threadpool_mergesort.h"
+#include "splitter_tree.h"
+#include "classify_paket.h"
+#include "distribute_paket.h"
+#include "sample_sort_paket.h"
+#include "paket_pool.h"
+
+namespace malms {
+
+/*
+ * Sorts the sequence given by [begin,end) with the sample sort, classifying
+ * and distributing in num_of_pakets pakets on the workqueue given by queue.
+ * Uses a buffer of n elements. Frequent keys get equality buckets (see
+ * SplitterTree), which are not sorted further. If the sample does not split
+ * the input otherwise, malms::sort is used instead.
+ */
+template<typename _RandomAccessIterator>
+void sample_sort(_RandomAccessIterator begin, _RandomAccessIterator end, unsigned int num_of_pakets, Scheduler::WorkQueue* queue) {
+	typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type _Distance;
+	typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
+	typedef SampleSortPaket<_RandomAccessIterator> _SampleSortPaket;
+
+	_Distance n = end - begin;
+	PaketPool<_SampleSortPaket> pool;
+
+	// small inputs are sorted by one paket
+	if (n <= SAMPLE_SORT_BASE || num_of_pakets <= 1) {
+		std::vector<_ValueType> buffer(n);
+		if (n > 0) {
+			queue->push(pool.create(_SampleSortPaket(begin, &buffer[0], n, false, &pool, queue)));
+			queue->blockuntildone();
+		}
+		return;
+	}
+
+	/* classify the input in parallel */
+
+	unsigned int k = num_of_pakets;
+	SplitterTree<_ValueType> tree;
+	tree.build(begin, end, Sorting::sample_sort_log_buckets(n), static_cast<uint64_t>(n));
+	unsigned int buckets = tree.numBuckets();
+	std::vector<unsigned char> oracle(n);
+	// the bucket sizes of each paket, used as its offsets after the prefix sum
+	std::vector<std::size_t> counts(k * buckets);
+	std::vector<ClassifyPaket<_RandomAccessIterator> > classify_pakets;
+	classify_pakets.reserve(k);
+	_Distance begin_i = 0;
+	for (unsigned int i = 0; i < k; i++) {
+		_Distance size = paket_size(n, k, i);
+		classify_pakets.push_back(ClassifyPaket<_RandomAccessIterator>(&tree, begin + begin_i, begin + (begin_i + size), &oracle[begin_i], &counts[i*buckets]));
+		queue->push(&classify_pakets.back());
+		begin_i += size;
+	}
+	queue->blockuntildone();
+
+	// offsets of the pakets in the buckets: bucket-major prefix sums
+	std::vector<std::size_t> bucket_begin(buckets+1);
+	std::size_t sum = 0;
+	for (unsigned int b = 0; b < buckets; b++) {
+		bucket_begin[b] = sum;
+		for (unsigned int i = 0; i < k; i++) {
+			std::size_t c = counts[i*buckets + b];
+			counts[i*buckets + b] = sum;
+			sum += c;
+		}
+		if (sum - bucket_begin[b] == static_cast<std::size_t>(n)) {
+			// all elements are equal, or the sample did not split the input
+			if (!tree.isEqualityBucket(b)) sort(begin, end, num_of_pakets, queue);
+			return;
+		}
+	}
+	bucket_begin[buckets] = sum;
+
+	/* distribute into the buffer and sort the buckets */
+
+	_ValueType* buffer = static_cast<_ValueType*>(::operator new(sizeof(_ValueType) * n));
+	std::vector<DistributePaket<_RandomAccessIterator,_ValueType*> > distribute_pakets;
+	distribute_pakets.reserve(k);
+	begin_i = 0;
+	for (unsigned int i = 0; i < k; i++) {
+		_Distance size = paket_size(n, k, i);
+		distribute_pakets.push_back(DistributePaket<_RandomAccessIterator,_ValueType*>(begin + begin_i, begin + (begin_i + size), &oracle[begin_i], buffer, &counts[i*buckets]));
+		queue->push(&distribute_pakets.back());
+		begin_i += size;
+	}
+	queue->blockuntildone();
+
+	// equality buckets are only copied back, in pieces so that they are
+	// spread over the cores
+	for (unsigned int b = 0; b < buckets; b++) {
+		_Distance size = bucket_begin[b+1] - bucket_begin[b];
+		_Distance piece = tree.isEqualityBucket(b) ? SAMPLE_SORT_BASE : size;
+		for (_Distance i = 0; i < size; i += piece) {
+			_Distance m = std::min(piece, size - i);
+			queue->push(pool.create(_SampleSortPaket(begin + (bucket_begin[b]+i), buffer + (bucket_begin[b]+i), m, true, &pool, queue, tree.isEqualityBucket(b))));
+		}
+	}
+	queue->blockuntildone();
+
+	::operator delete(buffer);
+}
+
+} // namespace
+
+#endif
@@ -0,0 +1,183 @@
+/*
+ *  Workpaket for sorting one bucket of the sample sort.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the class SampleSortPaket which implements the
+ *				Workpaket Interface. A small bucket is sorted directly, a
+ *				large one is distributed into sub-buckets with a splitter tree
+ *				of its own, which are pushed as new pakets into the queue.
+ *				The elements of an equality bucket are only moved into the
+ *				input.
+ *
+ */
+
+#ifndef SAMPLE_SORT_PAKET_H
+#define SAMPLE_SORT_PAKET_H
+
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <cstddef>
+#include <stdint.h>
+#include "workpaket.h"
+#include "stream_store.h"
+#include "paket_pool.h"
+#include "splitter_tree.h"
+#include "classify_paket.h"
+#include "distribute_paket.h"
+#include "run_formation.h"
+#include "threadpool/workqueue.h"
+
+// buckets of at most this many elements are sorted directly
+#define SAMPLE_SORT_BASE (1 << 16)
+
+namespace malms {
+
+namespace Sorting {
+
+/*
+ * Returns the logarithm of the number of buckets for m elements, so that the
+ * buckets are about SAMPLE_SORT_BASE elements large.
+ */
+inline unsigned int sample_sort_log_buckets(std::size_t m) {
+	unsigned int l = 1;
+	while (l < SAMPLE_SORT_MAX_LOG_BUCKETS && (m >> l) > SAMPLE_SORT_BASE) l++;
+	return l;
+}
+
+} // namespace Sorting
+
+/*
+ * Implements the Workpaket Interface. The constructor takes the position of
+ * the bucket in the input and in the buffer, its size, whether its elements
+ * are currently in the buffer, the pool for the sub-bucket pakets, the queue
+ * and whether all elements of the bucket are equal. The () operator leaves
+ * the bucket sorted in the input. The input and the buffer swap roles on each
+ * level of the recursion.
+ */
+template<typename _RandomAccessIterator>
+class SampleSortPaket : public Workpaket {
+	private:
+		// typedefs
+		typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type _Distance;
+		typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
+
+		// attributes
+		_RandomAccessIterator input;
+		_ValueType* buffer;
+		_Distance size;
+		bool in_buffer;
+		PaketPool<SampleSortPaket>* pool;
+		Scheduler::WorkQueue* queue;
+		bool equal;
+
+		/*
+		 * Sorts the bucket directly into the input. The run formation kernel
+		 * sorts the input into the buffer, which for radix sort is faster
+		 * than sorting in place even with the copies.
+		 */
+		void sortBase() {
+			if (in_buffer) {
+				std::copy(buffer, buffer + size, input);
+			}
+			Sorting::form_run<false>(input, input + size, buffer);
+			std::copy(buffer, buffer + size, input);
+		}
+
+		/*
+		 * Moves the elements of an equal bucket into the input.
+		 */
+		void moveEqual() {
+			if (in_buffer) {
+				Memory::stream_copy(buffer, buffer + size, input);
+			}
+		}
+
+		/*
+		 * Classifies the elements in [begin,end) and distributes them into the
+		 * buckets of the target, then pushes a paket for each bucket, equality
+		 * buckets in pieces of at most SAMPLE_SORT_BASE elements, so that
+		 * they are spread over the cores. Returns
+		 * false without moving anything if all elements fell into one bucket
+		 * that is not an equality bucket.
+		 */
+		template<typename _SourceIterator, typename _TargetIterator>
+		bool distribute(_SourceIterator begin, _SourceIterator end, _TargetIterator target) {
+			SplitterTree<_ValueType> tree;
+			tree.build(begin, end, Sorting::sample_sort_log_buckets(size), reinterpret_cast<uintptr_t>(this) + size);
+			unsigned int buckets = tree.numBuckets();
+			std::vector<unsigned char> oracle(size);
+			std::size_t counts[1 << SAMPLE_SORT_MAX_LOG_BUCKETS];
+			ClassifyPaket<_SourceIterator> classify(&tree, begin, end, &oracle[0], counts);
+			classify();
+			unsigned int largest = std::max_element(counts, counts + buckets) - counts;
+			if (counts[largest] == static_cast<std::size_t>(size)) {
+				if (!tree.isEqualityBucket(largest)) return false;
+				moveEqual();
+				return true;
+			}
+
+			std::size_t offsets[1 << SAMPLE_SORT_MAX_LOG_BUCKETS];
+			std::size_t sum = 0;
+			for (unsigned int b = 0; b < buckets; b++) {
+				offsets[b] = sum;
+				sum += counts[b];
+			}
+			DistributePaket<_SourceIterator,_TargetIterator> distribute(begin, end, &oracle[0], target, offsets);
+			distribute();
+
+			for (unsigned int b = 0; b < buckets; b++) {
+				if (counts[b] == 0) continue;
+				_Distance offset = offsets[b] - counts[b];
+				_Distance piece = tree.isEqualityBucket(b) ? SAMPLE_SORT_BASE : counts[b];
+				for (_Distance i = 0; i < static_cast<_Distance>(counts[b]); i += piece) {
+					_Distance m = std::min<_Distance>(piece, counts[b] - i);
+					queue->push(pool->create(SampleSortPaket(input + (offset+i), buffer + (offset+i), m, !in_buffer, pool, queue, tree.isEqualityBucket(b))));
+				}
+			}
+			return true;
+		}
+
+	public:
+		/*
+		 * Sorts the bucket directly if it is small, or if its elements could
+		 * not be split, otherwise recursively. An equality bucket is sorted.
+		 */
+		void operator()() {
+			if (equal) {
+				moveEqual();
+				return;
+			}
+			bool split = false;
+			if (size > SAMPLE_SORT_BASE) {
+				if (in_buffer) {
+					split = distribute(buffer, buffer + size, input);
+				} else {
+					split = distribute(input, input + size, buffer);
+				}
+			}
+			if (!split) {
+				sortBase();
+			}
+		}
+
+		/*
+		 * Constructor initializes the sorting attributes.
+		 */
+		SampleSortPaket(_RandomAccessIterator input, _ValueType* buffer, _Distance size, bool in_buffer, PaketPool<SampleSortPaket>* pool, Scheduler::WorkQueue* queue, bool equal = false) {
+			this->input = input;
+			this->buffer = buffer;
+			this->size = size;
+			this->in_buffer = in_buffer;
+			this->pool = pool;
+			this->queue = queue;
+			this->equal = equal;
+		}
+};
+
+} // namespace
+
+#endif
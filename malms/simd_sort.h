@@ -0,0 +1,437 @@
+/*
+ *  Vectorized sort for 32 and 64 bit integer keys.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements a mergesort with a vectorized base case: blocks are
+ *				sorted with sorting networks over SIMD registers and merged
+ *				with bitonic merge networks (see simd_sort_kernel.h).
+ *				The kernels are compiled for AVX2 (32 and 64 bit keys) and
+ *				SSE4.1 (32 bit keys), the instruction set is selected at
+ *				runtime. On other CPUs GNU-sort is used. The bitonic two-way
+ *				merge is also available on its own as simd_merge().
+ *
+ */
+
+#ifndef SIMD_SORT_H
+#define SIMD_SORT_H
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include <stdint.h>
+#include <boost/type_traits/is_same.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MALMS_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// runs smaller than this are sorted with the vectorized sort, if available
+#define SIMD_SORT_THRESHOLD 2048
+
+namespace malms {
+
+namespace Sorting {
+
+// instruction sets of the vectorized sort
+enum SimdLevel {SIMD_SCALAR = 0, SIMD_SSE4 = 1, SIMD_AVX2 = 2};
+
+#ifdef MALMS_SIMD_X86
+
+/* ------------------------------------------------------------------------ */
+/*                               AVX2 Kernels                               */
+/* ------------------------------------------------------------------------ */
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+namespace SimdAVX2 {
+
+/*
+ * Register operations for eight 32 bit integers.
+ */
+template<typename _ValueType>
+struct Ops32 {
+	typedef __m256i reg;
+	static const int lanes = 8;
+
+	static inline reg load(const _ValueType* p) {
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+	}
+	static inline void store(_ValueType* p, reg v) {
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+	}
+	static inline reg min(reg a, reg b) {
+		return _mm256_min_epi32(a, b);
+	}
+	static inline reg max(reg a, reg b) {
+		return _mm256_max_epi32(a, b);
+	}
+	static inline reg reverse(reg v) {
+		return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7,6,5,4,3,2,1,0));
+	}
+	// sorts a bitonic register with distances 4, 2 and 1
+	static inline reg clean(reg v) {
+		reg p = _mm256_permute2x128_si256(v, v, 0x01);
+		v = _mm256_blend_epi32(min(v, p), max(v, p), 0xF0);
+		p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1,0,3,2));
+		v = _mm256_blend_epi32(min(v, p), max(v, p), 0xCC);
+		p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2,3,0,1));
+		v = _mm256_blend_epi32(min(v, p), max(v, p), 0xAA);
+		return v;
+	}
+	static inline void cmpswap(reg& a, reg& b) {
+		reg t = min(a, b);
+		b = max(a, b);
+		a = t;
+	}
+	// sorts 64 elements into 8 sorted runs of 8: the columns are sorted with
+	// the 19 comparator network for 8 inputs, then the block is transposed
+	static inline void sort_block(const _ValueType* in, _ValueType* out) {
+		reg r0 = load(in), r1 = load(in+8), r2 = load(in+16), r3 = load(in+24);
+		reg r4 = load(in+32), r5 = load(in+40), r6 = load(in+48), r7 = load(in+56);
+		cmpswap(r0,r2); cmpswap(r1,r3); cmpswap(r4,r6); cmpswap(r5,r7);
+		cmpswap(r0,r4); cmpswap(r1,r5); cmpswap(r2,r6); cmpswap(r3,r7);
+		cmpswap(r0,r1); cmpswap(r2,r3); cmpswap(r4,r5); cmpswap(r6,r7);
+		cmpswap(r2,r4); cmpswap(r3,r5);
+		cmpswap(r1,r4); cmpswap(r3,r6);
+		cmpswap(r1,r2); cmpswap(r3,r4); cmpswap(r5,r6);
+		// transpose 8x8
+		reg t0 = _mm256_unpacklo_epi32(r0, r1), t1 = _mm256_unpackhi_epi32(r0, r1);
+		reg t2 = _mm256_unpacklo_epi32(r2, r3), t3 = _mm256_unpackhi_epi32(r2, r3);
+		reg t4 = _mm256_unpacklo_epi32(r4, r5), t5 = _mm256_unpackhi_epi32(r4, r5);
+		reg t6 = _mm256_unpacklo_epi32(r6, r7), t7 = _mm256_unpackhi_epi32(r6, r7);
+		reg u0 = _mm256_unpacklo_epi64(t0, t2), u1 = _mm256_unpackhi_epi64(t0, t2);
+		reg u2 = _mm256_unpacklo_epi64(t1, t3), u3 = _mm256_unpackhi_epi64(t1, t3);
+		reg u4 = _mm256_unpacklo_epi64(t4, t6), u5 = _mm256_unpackhi_epi64(t4, t6);
+		reg u6 = _mm256_unpacklo_epi64(t5, t7), u7 = _mm256_unpackhi_epi64(t5, t7);
+		store(out,    _mm256_permute2x128_si256(u0, u4, 0x20));
+		store(out+8,  _mm256_permute2x128_si256(u1, u5, 0x20));
+		store(out+16, _mm256_permute2x128_si256(u2, u6, 0x20));
+		store(out+24, _mm256_permute2x128_si256(u3, u7, 0x20));
+		store(out+32, _mm256_permute2x128_si256(u0, u4, 0x31));
+		store(out+40, _mm256_permute2x128_si256(u1, u5, 0x31));
+		store(out+48, _mm256_permute2x128_si256(u2, u6, 0x31));
+		store(out+56, _mm256_permute2x128_si256(u3, u7, 0x31));
+	}
+};
+
+/*
+ * Register operations for four 64 bit integers. AVX2 has no 64 bit min/max,
+ * they are built from a compare and a blend.
+ */
+template<typename _ValueType>
+struct Ops64 {
+	typedef __m256i reg;
+	static const int lanes = 4;
+
+	static inline reg load(const _ValueType* p) {
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+	}
+	static inline void store(_ValueType* p, reg v) {
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+	}
+	static inline reg min(reg a, reg b) {
+		return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b));
+	}
+	static inline reg max(reg a, reg b) {
+		return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b));
+	}
+	static inline reg reverse(reg v) {
+		return _mm256_permute4x64_epi64(v, _MM_SHUFFLE(0,1,2,3));
+	}
+	// sorts a bitonic register with distances 2 and 1
+	static inline reg clean(reg v) {
+		reg p = _mm256_permute4x64_epi64(v, _MM_SHUFFLE(1,0,3,2));
+		v = _mm256_blend_epi32(min(v, p), max(v, p), 0xF0);
+		p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1,0,3,2));
+		v = _mm256_blend_epi32(min(v, p), max(v, p), 0xCC);
+		return v;
+	}
+	static inline void cmpswap(reg& a, reg& b) {
+		reg gt = _mm256_cmpgt_epi64(a, b);
+		reg t = _mm256_blendv_epi8(a, b, gt);
+		b = _mm256_blendv_epi8(b, a, gt);
+		a = t;
+	}
+	// sorts 16 elements into 4 sorted runs of 4
+	static inline void sort_block(const _ValueType* in, _ValueType* out) {
+		reg r0 = load(in), r1 = load(in+4), r2 = load(in+8), r3 = load(in+12);
+		cmpswap(r0,r1); cmpswap(r2,r3);
+		cmpswap(r0,r2); cmpswap(r1,r3);
+		cmpswap(r1,r2);
+		// transpose 4x4
+		reg t0 = _mm256_unpacklo_epi64(r0, r1), t1 = _mm256_unpackhi_epi64(r0, r1);
+		reg t2 = _mm256_unpacklo_epi64(r2, r3), t3 = _mm256_unpackhi_epi64(r2, r3);
+		store(out,    _mm256_permute2x128_si256(t0, t2, 0x20));
+		store(out+4,  _mm256_permute2x128_si256(t1, t3, 0x20));
+		store(out+8,  _mm256_permute2x128_si256(t0, t2, 0x31));
+		store(out+12, _mm256_permute2x128_si256(t1, t3, 0x31));
+	}
+};
+
+#include "simd_sort_kernel.h"
+
+} // namespace SimdAVX2
+
+#pragma GCC pop_options
+
+/* ------------------------------------------------------------------------ */
+/*                              SSE4.1 Kernels                              */
+/* ------------------------------------------------------------------------ */
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+
+namespace SimdSSE4 {
+
+/*
+ * Register operations for four 32 bit integers.
+ */
+template<typename _ValueType>
+struct Ops32 {
+	typedef __m128i reg;
+	static const int lanes = 4;
+
+	static inline reg load(const _ValueType* p) {
+		return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+	}
+	static inline void store(_ValueType* p, reg v) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+	}
+	static inline reg min(reg a, reg b) {
+		return _mm_min_epi32(a, b);
+	}
+	static inline reg max(reg a, reg b) {
+		return _mm_max_epi32(a, b);
+	}
+	static inline reg reverse(reg v) {
+		return _mm_shuffle_epi32(v, _MM_SHUFFLE(0,1,2,3));
+	}
+	// sorts a bitonic register with distances 2 and 1
+	static inline reg clean(reg v) {
+		reg p = _mm_shuffle_epi32(v, _MM_SHUFFLE(1,0,3,2));
+		v = _mm_blend_epi16(min(v, p), max(v, p), 0xF0);
+		p = _mm_shuffle_epi32(v, _MM_SHUFFLE(2,3,0,1));
+		v = _mm_blend_epi16(min(v, p), max(v, p), 0xCC);
+		return v;
+	}
+	static inline void cmpswap(reg& a, reg& b) {
+		reg t = min(a, b);
+		b = max(a, b);
+		a = t;
+	}
+	// sorts 16 elements into 4 sorted runs of 4
+	static inline void sort_block(const _ValueType* in, _ValueType* out) {
+		reg r0 = load(in), r1 = load(in+4), r2 = load(in+8), r3 = load(in+12);
+		cmpswap(r0,r1); cmpswap(r2,r3);
+		cmpswap(r0,r2); cmpswap(r1,r3);
+		cmpswap(r1,r2);
+		// transpose 4x4
+		reg t0 = _mm_unpacklo_epi32(r0, r1), t1 = _mm_unpacklo_epi32(r2, r3);
+		reg t2 = _mm_unpackhi_epi32(r0, r1), t3 = _mm_unpackhi_epi32(r2, r3);
+		store(out,    _mm_unpacklo_epi64(t0, t1));
+		store(out+4,  _mm_unpackhi_epi64(t0, t1));
+		store(out+8,  _mm_unpacklo_epi64(t2, t3));
+		store(out+12, _mm_unpackhi_epi64(t2, t3));
+	}
+};
+
+#include "simd_sort_kernel.h"
+
+} // namespace SimdSSE4
+
+#pragma GCC pop_options
+
+#endif // MALMS_SIMD_X86
+
+/*
+ * Returns the best instruction set supported by the CPU, detected once.
+ * The level can be lowered with simd_set_level(), e.g. for benchmarking.
+ */
+inline SimdLevel& simd_level_ref() {
+	#ifdef MALMS_SIMD_X86
+	static SimdLevel level = __builtin_cpu_supports("avx2") ? SIMD_AVX2
+	                       : (__builtin_cpu_supports("sse4.1") ? SIMD_SSE4 : SIMD_SCALAR);
+	#else
+	static SimdLevel level = SIMD_SCALAR;
+	#endif
+	return level;
+}
+
+inline SimdLevel simd_level() {
+	return simd_level_ref();
+}
+
+inline void simd_set_level(SimdLevel level) {
+	simd_level_ref() = level;
+}
+
+/*
+ * The SimdTraits select the kernels for a value type. Types with
+ * enabled == false are never sorted with the vectorized sort.
+ */
+template<typename _ValueType>
+struct SimdTraits {
+	static const bool enabled = false;
+};
+
+template<typename _ValueType>
+struct SimdTraits32 {
+	static const bool enabled = true;
+	template<typename _Distance>
+	static bool sort_copy(_ValueType* input, _Distance n, _ValueType* buffer) {
+		#ifdef MALMS_SIMD_X86
+		switch (simd_level()) {
+			case SIMD_AVX2:
+				SimdAVX2::simd_sort_copy<SimdAVX2::Ops32<_ValueType> >(input, n, buffer);
+				return true;
+			case SIMD_SSE4:
+				SimdSSE4::simd_sort_copy<SimdSSE4::Ops32<_ValueType> >(input, n, buffer);
+				return true;
+			default:
+				break;
+		}
+		#endif
+		return false;
+	}
+	template<typename _Distance>
+	static bool merge(const _ValueType* a, _Distance na, const _ValueType* b, _Distance nb, _ValueType* out) {
+		#ifdef MALMS_SIMD_X86
+		switch (simd_level()) {
+			case SIMD_AVX2:
+				SimdAVX2::simd_merge<SimdAVX2::Ops32<_ValueType> >(a, na, b, nb, out);
+				return true;
+			case SIMD_SSE4:
+				SimdSSE4::simd_merge<SimdSSE4::Ops32<_ValueType> >(a, na, b, nb, out);
+				return true;
+			default:
+				break;
+		}
+		#endif
+		return false;
+	}
+};
+
+template<typename _ValueType>
+struct SimdTraits64 {
+	static const bool enabled = true;
+	template<typename _Distance>
+	static bool sort_copy(_ValueType* input, _Distance n, _ValueType* buffer) {
+		#ifdef MALMS_SIMD_X86
+		if (simd_level() == SIMD_AVX2) {
+			SimdAVX2::simd_sort_copy<SimdAVX2::Ops64<_ValueType> >(input, n, buffer);
+			return true;
+		}
+		#endif
+		return false;
+	}
+	template<typename _Distance>
+	static bool merge(const _ValueType* a, _Distance na, const _ValueType* b, _Distance nb, _ValueType* out) {
+		#ifdef MALMS_SIMD_X86
+		if (simd_level() == SIMD_AVX2) {
+			SimdAVX2::simd_merge<SimdAVX2::Ops64<_ValueType> >(a, na, b, nb, out);
+			return true;
+		}
+		#endif
+		return false;
+	}
+};
+
+template<> struct SimdTraits<int> : public SimdTraits32<int> {};
+template<> struct SimdTraits<long> : public SimdTraits64<long> {};
+template<> struct SimdTraits<long long> : public SimdTraits64<long long> {};
+
+/*
+ * Detects iterators over contiguous memory, for which the vectorized sort can
+ * work on the underlying array.
+ */
+template<typename _Iterator>
+struct ContiguousIterator {
+	static const bool value = false;
+};
+
+template<typename _ValueType>
+struct ContiguousIterator<_ValueType*> {
+	static const bool value = true;
+	static _ValueType* pointer(_ValueType* it) {
+		return it;
+	}
+};
+
+template<typename _ValueType, typename _Container>
+struct ContiguousIterator<__gnu_cxx::__normal_iterator<_ValueType*, _Container> > {
+	static const bool value = true;
+	static _ValueType* pointer(__gnu_cxx::__normal_iterator<_ValueType*, _Container> it) {
+		return it.base();
+	}
+};
+
+/*
+ * Calls the kernel of the value type on the array underlying the iterator,
+ * or does nothing if either is not supported.
+ */
+template<typename _RandomAccessIterator, typename _ValueType,
+         bool _Enabled = SimdTraits<_ValueType>::enabled && ContiguousIterator<_RandomAccessIterator>::value>
+struct SimdDispatch {
+	static bool sort_copy(_RandomAccessIterator, _RandomAccessIterator, _ValueType*) {
+		return false;
+	}
+};
+
+template<typename _RandomAccessIterator, typename _ValueType>
+struct SimdDispatch<_RandomAccessIterator, _ValueType, true> {
+	static bool sort_copy(_RandomAccessIterator begin, _RandomAccessIterator end, _ValueType* buffer) {
+		return SimdTraits<_ValueType>::sort_copy(ContiguousIterator<_RandomAccessIterator>::pointer(begin), end-begin, buffer);
+	}
+};
+
+/*
+ * Calls the merge kernel of the value type on the arrays underlying the input
+ * and output iterators, or does nothing if any of them is not supported.
+ */
+template<typename _RandomAccessIterator, typename _OutputIterator, typename _ValueType,
+         bool _Enabled = SimdTraits<_ValueType>::enabled && ContiguousIterator<_RandomAccessIterator>::value && ContiguousIterator<_OutputIterator>::value
+                         && boost::is_same<_ValueType, typename std::iterator_traits<_OutputIterator>::value_type>::value>
+struct SimdMergeDispatch {
+	static bool merge(_RandomAccessIterator, _RandomAccessIterator, _RandomAccessIterator, _RandomAccessIterator, _OutputIterator) {
+		return false;
+	}
+};
+
+template<typename _RandomAccessIterator, typename _OutputIterator, typename _ValueType>
+struct SimdMergeDispatch<_RandomAccessIterator, _OutputIterator, _ValueType, true> {
+	static bool merge(_RandomAccessIterator a, _RandomAccessIterator a_end, _RandomAccessIterator b, _RandomAccessIterator b_end, _OutputIterator out) {
+		return SimdTraits<_ValueType>::merge(ContiguousIterator<_RandomAccessIterator>::pointer(a), a_end-a,
+		                                     ContiguousIterator<_RandomAccessIterator>::pointer(b), b_end-b,
+		                                     ContiguousIterator<_OutputIterator>::pointer(out));
+	}
+};
+
+/*
+ * Merges [a,a_end) and [b,b_end) into out with the vectorized bitonic merge.
+ * Returns false and does nothing if the value type, the iterators or the CPU
+ * are not supported.
+ */
+template<typename _RandomAccessIterator, typename _OutputIterator>
+inline bool simd_merge(_RandomAccessIterator a, _RandomAccessIterator a_end, _RandomAccessIterator b, _RandomAccessIterator b_end, _OutputIterator out) {
+	typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
+	return SimdMergeDispatch<_RandomAccessIterator,_OutputIterator,_ValueType>::merge(a, a_end, b, b_end, out);
+}
+
+/*
+ * Sorts [begin,end) into [buffer,buffer+(end-begin)) with the vectorized sort,
+ * using the input as temporary space. Returns false and does nothing if the
+ * value type, the iterator or the CPU is not supported.
+ */
+template<typename _RandomAccessIterator, typename _ValueType>
+inline bool simd_sort_copy(_RandomAccessIterator begin, _RandomAccessIterator end, _ValueType* buffer) {
+	return SimdDispatch<_RandomAccessIterator,_ValueType>::sort_copy(begin, end, buffer);
+}
+
+} // namespace Sorting
+
+} // namespace malms
+
+#endif
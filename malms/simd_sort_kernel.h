@@ -0,0 +1,113 @@
+/*
+ *  Vectorized Mergesort Kernel.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Generic part of the vectorized sort, written against an Ops
+ *				class that provides the register operations of one instruction
+ *				set. This file has no include guard on purpose: simd_sort.h
+ *				includes it once per instruction set, inside a namespace and
+ *				a "#pragma GCC target" region, so that the code is compiled
+ *				for that instruction set.
+ *
+ */
+
+/*
+ * Merges the two sorted registers a and b, afterwards a holds the smaller and b
+ * the larger half of the elements, both sorted. This is the bitonic merge
+ * network: reversing b makes the concatenation bitonic.
+ */
+template<typename _Ops>
+inline void bitonic_merge(typename _Ops::reg& a, typename _Ops::reg& b) {
+	typename _Ops::reg rb = _Ops::reverse(b);
+	typename _Ops::reg lo = _Ops::min(a, rb);
+	typename _Ops::reg hi = _Ops::max(a, rb);
+	a = _Ops::clean(lo);
+	b = _Ops::clean(hi);
+}
+
+/*
+ * Merges the sorted sequences [a,a+na) and [b,b+nb) into out. Both sequences
+ * are consumed in blocks of one register, the next block is taken from the
+ * sequence with the smaller next element. The remainders that do not fill a
+ * register are merged with scalar code.
+ */
+template<typename _Ops, typename _ValueType, typename _Distance>
+void simd_merge(const _ValueType* a, _Distance na, const _ValueType* b, _Distance nb, _ValueType* out) {
+	const _Distance L = _Ops::lanes;
+	if (na < L || nb < L) {
+		std::merge(a, a+na, b, b+nb, out);
+		return;
+	}
+	typename _Ops::reg va = _Ops::load(a);
+	typename _Ops::reg vb = _Ops::load(b);
+	_Distance ia = L;
+	_Distance ib = L;
+	while (true) {
+		bitonic_merge<_Ops>(va, vb);
+		_Ops::store(out, va);
+		out += L;
+		// load the next block from the sequence with the smaller head, if
+		// that sequence can not fill a register anymore, finish with scalar code
+		bool take_a = (ib == nb) || (ia < na && a[ia] < b[ib]);
+		if (take_a) {
+			if (na - ia < L) break;
+			va = _Ops::load(a+ia);
+			ia += L;
+		} else {
+			if (nb - ib < L) break;
+			va = _Ops::load(b+ib);
+			ib += L;
+		}
+	}
+	// three way merge of the register content with the remainders
+	_ValueType rest[_Ops::lanes];
+	_Ops::store(rest, vb);
+	_Distance ir = 0;
+	while (ir < L) {
+		if (ia < na && a[ia] < rest[ir] && (ib == nb || !(b[ib] < a[ia]))) {
+			*out++ = a[ia++];
+		} else if (ib < nb && b[ib] < rest[ir]) {
+			*out++ = b[ib++];
+		} else {
+			*out++ = rest[ir++];
+		}
+	}
+	std::merge(a+ia, a+na, b+ib, b+nb, out);
+}
+
+/*
+ * Sorts [input,input+n) into [buffer,buffer+n). Blocks of lanes*lanes elements
+ * are sorted with a sorting network over the registers and transposed into
+ * sorted runs of one register each, the tail is sorted with GNU-sort. The runs
+ * are then merged pairwise with simd_merge, alternating between the buffer and
+ * the input, which is used as temporary space.
+ */
+template<typename _Ops, typename _ValueType, typename _Distance>
+void simd_sort_copy(_ValueType* input, _Distance n, _ValueType* buffer) {
+	const _Distance L = _Ops::lanes;
+	const _Distance block = L*L;
+	_Distance nblocks = n - n % block;
+	for (_Distance i = 0; i < nblocks; i += block) {
+		_Ops::sort_block(input+i, buffer+i);
+	}
+	// the tail is one sorted run, any part of it is sorted as well
+	std::copy(input+nblocks, input+n, buffer+nblocks);
+	std::sort(buffer+nblocks, buffer+n);
+
+	_ValueType* src = buffer;
+	_ValueType* dst = input;
+	for (_Distance w = L; w < n; w *= 2) {
+		for (_Distance i = 0; i < n; i += 2*w) {
+			_Distance n1 = std::min(w, n-i);
+			_Distance n2 = std::min(w, n-i-n1);
+			simd_merge<_Ops>(src+i, n1, src+i+n1, n2, dst+i);
+		}
+		std::swap(src, dst);
+	}
+	if (src != buffer) {
+		std::copy(src, src+n, buffer);
+	}
+}
@@ -0,0 +1,223 @@
+/*
+ *  Merging of few sequences.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements merge kernels for a small number of sequences that
+ *				are specialized by the number of sequences at compile time:
+ *				a branchless two-way merge, which uses the vectorized bitonic
+ *				merge of simd_sort.h for 32 and 64 bit integers, and a
+ *				MergeStream<K>, an unrolled tournament of pairwise merges for
+ *				up to SMALL_MERGE_MAX_K sequences. small_merge() selects the
+ *				kernel from the number of sequences, larger merges use the
+ *				loser tree of loser_merge.h.
+ *
+ */
+
+#ifndef SMALL_MERGE_H
+#define SMALL_MERGE_H
+
+#include <iterator>
+#include <algorithm>
+
+#include "simd_sort.h"
+#include "stream_store.h"
+
+// merges of at most this many sequences use the specialized kernels, for more
+// sequences the tournament is not faster than the loser tree
+#define SMALL_MERGE_MAX_K 5
+
+namespace malms {
+
+namespace Merging {
+
+/*
+ * A sorted sequence of a merge, the leaf of a MergeStream.
+ */
+template<unsigned int _K, typename _RandomAccessIterator>
+class MergeStream;
+
+template<typename _RandomAccessIterator>
+class MergeStream<1, _RandomAccessIterator> {
+	private:
+		typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
+		_RandomAccessIterator cur;
+		_RandomAccessIterator end;
+	public:
+		void init(_RandomAccessIterator* lower, _RandomAccessIterator* upper) {
+			cur = lower[0];
+			end = upper[0];
+		}
+		bool empty() const {
+			return cur == end;
+		}
+		const _ValueType& head() const {
+			return *cur;
+		}
+		void pop() {
+			++cur;
+		}
+};
+
+/*
+ * Merges _K sequences as the pairwise merge of the first _K/2 and the other
+ * sequences. The recursion is resolved at compile time, so the tournament is
+ * unrolled and kept in registers. Equal elements are taken from the left
+ * sequences first, which makes the merge stable.
+ */
+template<unsigned int _K, typename _RandomAccessIterator>
+class MergeStream {
+	private:
+		typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
+		MergeStream<_K/2, _RandomAccessIterator> left;
+		MergeStream<_K - _K/2, _RandomAccessIterator> right;
+		// whether the head is the head of the right stream
+		bool from_right;
+
+		void choose() {
+			from_right = left.empty() || (!right.empty() && right.head() < left.head());
+		}
+	public:
+		void init(_RandomAccessIterator* lower, _RandomAccessIterator* upper) {
+			left.init(lower, upper);
+			right.init(lower + _K/2, upper + _K/2);
+			choose();
+		}
+		bool empty() const {
+			return left.empty() && right.empty();
+		}
+		const _ValueType& head() const {
+			return from_right ? right.head() : left.head();
+		}
+		void pop() {
+			if (from_right) {
+				right.pop();
+			} else {
+				left.pop();
+			}
+			choose();
+		}
+};
+
+/*
+ * Merges [a,a_end) and [b,b_end) into out. The next element is selected with
+ * conditional moves instead of a branch. Equal elements are taken from a
+ * first.
+ */
+template<typename _RandomAccessIterator, typename _OutputIteratorType>
+_OutputIteratorType two_way_merge(_RandomAccessIterator a, _RandomAccessIterator a_end, _RandomAccessIterator b, _RandomAccessIterator b_end, _OutputIteratorType out) {
+	while (a != a_end && b != b_end) {
+		bool take_b = *b < *a;
+		*out = take_b ? *b : *a;
+		++out;
+		b += take_b;
+		a += !take_b;
+	}
+	out = std::copy(a, a_end, out);
+	return std::copy(b, b_end, out);
+}
+
+/*
+ * Writes the n elements of a MergeStream of _K sequences to the output.
+ */
+template<unsigned int _K, typename _RandomAccessIterator, typename _OutputIteratorType, typename _Distance>
+_OutputIteratorType stream_merge(_RandomAccessIterator* lower_splitters, _RandomAccessIterator* upper_splitters, _OutputIteratorType outputIterator, _Distance n) {
+	MergeStream<_K, _RandomAccessIterator> stream;
+	stream.init(lower_splitters, upper_splitters);
+	for (_Distance i = 0; i < n; i++) {
+		*outputIterator = stream.head();
+		++outputIterator;
+		stream.pop();
+	}
+	return outputIterator;
+}
+
+/*
+ * Merges the sequences with a MergeStream of _K sequences, with streaming
+ * stores if the output is large enough (see use_stream_store()).
+ */
+template<unsigned int _K, typename _RandomAccessIterator, typename _OutputIteratorType>
+void stream_merge(_RandomAccessIterator* lower_splitters, _RandomAccessIterator* upper_splitters, _OutputIteratorType outputIterator) {
+	typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type _Distance;
+	_Distance n = 0;
+	for (unsigned int i = 0; i < _K; i++) {
+		n += upper_splitters[i] - lower_splitters[i];
+	}
+	if (Memory::use_stream_store(outputIterator, n)) {
+		Memory::StreamOutput<_OutputIteratorType> output(outputIterator);
+		output.finish(stream_merge<_K>(lower_splitters, upper_splitters, output.iterator(), n));
+	} else {
+		stream_merge<_K>(lower_splitters, upper_splitters, outputIterator, n);
+	}
+}
+
+/*
+ * Merges num_of_pakets sequences with the kernel specialized for their number,
+ * like multiwaymerge, but does not modify the splitters. Two sequences of 32
+ * or 64 bit integers in contiguous memory are merged with the vectorized
+ * bitonic merge, which may reorder equal elements, but equal integers can not
+ * be told apart. Returns false without merging if there are more than
+ * SMALL_MERGE_MAX_K sequences.
+ */
+template<bool _Stable, typename _RandomAccessIterator, typename _OutputIteratorType>
+bool small_merge(_RandomAccessIterator* lower_splitters, _RandomAccessIterator* upper_splitters, _OutputIteratorType outputIterator, unsigned int num_of_pakets) {
+	switch (num_of_pakets) {
+		case 0:
+			return true;
+		case 1:
+			std::copy(lower_splitters[0], upper_splitters[0], outputIterator);
+			return true;
+		case 2:
+			if (!Sorting::simd_merge(lower_splitters[0], upper_splitters[0], lower_splitters[1], upper_splitters[1], outputIterator)) {
+				two_way_merge(lower_splitters[0], upper_splitters[0], lower_splitters[1], upper_splitters[1], outputIterator);
+			}
+			return true;
+		case 3:
+			stream_merge<3>(lower_splitters, upper_splitters, outputIterator);
+			return true;
+		case 4:
+			stream_merge<4>(lower_splitters, upper_splitters, outputIterator);
+			return true;
+		case 5:
+			stream_merge<5>(lower_splitters, upper_splitters, outputIterator);
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Merges 3 to SMALL_MERGE_MAX_K sequences like small_merge, but writes to the
+ * output iterator as it is, without choosing the stores, and advances it to
+ * the end of the output, e.g. for an output streamed over several merges.
+ * Returns false without merging for other numbers of sequences.
+ */
+template<bool _Stable, typename _RandomAccessIterator, typename _OutputIteratorType>
+bool small_merge_to(_RandomAccessIterator* lower_splitters, _RandomAccessIterator* upper_splitters, _OutputIteratorType& outputIterator, unsigned int num_of_pakets) {
+	typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type _Distance;
+	_Distance n = 0;
+	for (unsigned int i = 0; i < num_of_pakets; i++) {
+		n += upper_splitters[i] - lower_splitters[i];
+	}
+	switch (num_of_pakets) {
+		case 3:
+			outputIterator = stream_merge<3>(lower_splitters, upper_splitters, outputIterator, n);
+			return true;
+		case 4:
+			outputIterator = stream_merge<4>(lower_splitters, upper_splitters, outputIterator, n);
+			return true;
+		case 5:
+			outputIterator = stream_merge<5>(lower_splitters, upper_splitters, outputIterator, n);
+			return true;
+		default:
+			return false;
+	}
+}
+
+} // namespace Merging
+
+} // namespace malms
+
+#endif
@@ -0,0 +1,540 @@
+/*
+ *  Reusable workspace for the malleable mergesort.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the class SortContext which owns all memory that is
+ *				needed by one call to malms::sort: the run buffer, the splitter
+ *				matrix, the scratch space for splitting and merging and the
+ *				Workpaket objects themselves. Passing the same SortContext to
+ *				repeated calls of malms::sort avoids all allocations once the
+ *				context has grown to the largest n and num_of_pakets used.
+ */
+
+#ifndef SORT_CONTEXT_H
+#define SORT_CONTEXT_H
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+#include <new>
+#include <unistd.h>
+
+#include "sort_paket.h"
+#include "batch_split_paket.h"
+#include "merge_paket.h"
+#include "median_split.h"
+#include "prefault_paket.h"
+#include "paket_size.h"
+#include "join_paket.h"
+#include "huge_alloc.h"
+#include "threadpool/workqueue.h"
+#include "threadpool/maleablescheduler.h"
+#include "threadpool/numa.h"
+
+// the phases of the sort only overlap if they are not timed separately
+#if defined(TIMING_PHASES) || defined(TIMING_PHASES_CSV)
+#define SORT_PIPELINED_DEFAULT false
+#else
+#define SORT_PIPELINED_DEFAULT true
+#endif
+
+namespace malms {
+
+/*
+ * Holds the workspace of the mergesort. The context only grows: reserve(n,k)
+ * reallocates the run buffer if n exceeds its capacity and the splitter and
+ * paket storage if k exceeds its capacity, otherwise everything is reused.
+ * The run buffer is one contiguous array, the run of paket i is stored at the
+ * same offset in the buffer as its input slice in the input sequence.
+ * A context with _Stable creates the pakets of the stable sort.
+ *
+ * On NUMA machines, the context places the run buffer according to its policy:
+ * with Numa::LOCAL (the default) each run is placed on the node of the thread
+ * sorting it and the pakets prefer the node of their input or output range,
+ * with Numa::INTERLEAVE the buffer is interleaved over all nodes, and with
+ * Numa::FIRST_TOUCH the placement is left to the kernel.
+ * The run buffer is allocated with the context's AllocationPolicy. With any
+ * policy but ALLOC_DEFAULT, the pages of the buffer are faulted in by
+ * PrefaultPakets on the job's cores before the first sort that uses them.
+ * The splitter matrix and the scratch space are only O(k^2) and stay on
+ * ordinary pages.
+ *
+ * A pipelined context (the default) connects the pakets of a sort by their
+ * dependencies instead of waiting for each phase to finish: the split pakets
+ * start when the last run is sorted, and merge paket i as soon as the splitter
+ * rows i and i+1 are computed, while other rows are still being split.
+ *
+ * With the helping wait, the thread calling the sort runs pakets of the job
+ * while it waits for them, instead of sleeping (see
+ * MaleableScheduler::helpUntilDone()).
+ */
+template<typename _RandomAccessIterator, bool _Stable = false>
+class SortContext {
+	public:
+		// typedefs
+		typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type _Distance;
+		typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
+		typedef SortPaket<_RandomAccessIterator,_ValueType*,_Stable> _SortPaket;
+		typedef BatchSplitPaket<_ValueType*,_Stable> _SplitPaket;
+		typedef MergePaket<_ValueType*,_RandomAccessIterator,_Stable> _MergePaket;
+		typedef Splitting::PartitionElement<_ValueType> _PartitionElement;
+
+	private:
+		// the run buffer, uninitialized memory for buffer_capacity elements
+		_ValueType* run_buffer;
+		_Distance buffer_capacity;
+
+		// the requested allocation policy of the run buffer and the one
+		// the current buffer was allocated with after fallbacks
+		AllocationPolicy allocation_policy;
+		AllocationPolicy buffer_policy;
+
+		// the number of elements at the start of the run buffer which are
+		// already faulted in, and the pakets doing the prefaulting
+		_Distance prefaulted;
+		std::vector<PrefaultPaket> prefault_pakets;
+
+		// the number of pakets the splitter and paket storage is sized for
+		unsigned int paket_capacity;
+
+		// the (k+1)*k splitter matrix and pointers to its rows
+		std::vector<_ValueType*> splitter_matrix;
+		std::vector<_ValueType**> splitter_rows;
+
+		// scratch space for the splitting (k+16 elements per split paket) and
+		// for the merging (3*k splitters and k+16 elements for the splitter
+		// search of the chunks per merge paket)
+		std::vector<_PartitionElement> split_scratch;
+		std::vector<_ValueType*> merge_scratch;
+		std::vector<_PartitionElement> merge_split_scratch;
+
+		// the paket objects, their capacity is reserved up front, so that
+		// the pointers pushed into the WorkQueue stay valid
+		std::vector<_SortPaket> sort_pakets;
+		std::vector<_SplitPaket> split_pakets;
+
+		// the number of elements before each row of the splitter matrix, and
+		// the split pakets which are pushed by the sort: the independent top
+		// of the bisection tree, and the subtrees below it
+		std::vector<_Distance> row_prefix;
+		std::vector<_SplitPaket*> split_roots;
+		std::vector<_SplitPaket*> split_subtrees;
+		std::vector<_MergePaket> merge_pakets;
+
+		// the split paket computing each row of the splitter matrix, NULL for
+		// the first and last row, and the join of the run formation with the
+		// pakets it pushes
+		std::vector<_SplitPaket*> row_pakets;
+		std::vector<JoinPaket> join_pakets;
+		std::vector<Scheduler::WorkQueueItem*> join_items;
+
+		// the number of pakets of the current sort call
+		unsigned int num_of_pakets;
+
+		// the placement of the run buffer and the pakets on NUMA machines
+		Scheduler::Numa::Policy numa_policy;
+
+		// whether the merge pakets copy their sequences into a buffer first
+		bool buffered_merge;
+
+		// whether the merge pakets can be split while they run
+		bool splittable_merge;
+
+		// whether the phases are connected by dependencies
+		bool pipelined;
+
+		// whether the calling thread runs pakets while it waits, and the
+		// number of pakets it ran in the current sort call
+		bool helping_wait;
+		std::size_t helped_pakets;
+
+		/*
+		 * Returns true if pakets are placed on the nodes of their data.
+		 */
+		bool numaLocal() const {
+			return numa_policy == Scheduler::Numa::LOCAL && Scheduler::Numa::num_nodes() > 1;
+		}
+
+		/*
+		 * Returns the node of the memory at the iterator, for the node hints.
+		 */
+		static int nodeOf(_RandomAccessIterator it) {
+			return Scheduler::Numa::node_of_address(&(*it));
+		}
+
+		// non copyable
+		SortContext(const SortContext&);
+		SortContext& operator=(const SortContext&);
+
+	public:
+		/*
+		 * Creates an empty context, memory is allocated by the first reserve().
+		 */
+		SortContext() : run_buffer(NULL), buffer_capacity(0), allocation_policy(ALLOC_DEFAULT), buffer_policy(ALLOC_DEFAULT), prefaulted(0), paket_capacity(0), num_of_pakets(0), numa_policy(Scheduler::Numa::LOCAL), buffered_merge(false), splittable_merge(true), pipelined(SORT_PIPELINED_DEFAULT), helping_wait(false), helped_pakets(0) {
+		}
+
+		/*
+		 * Creates a context that is already large enough for sorting n
+		 * elements with num_of_pakets pakets.
+		 */
+		SortContext(_Distance n, unsigned int num_of_pakets) : run_buffer(NULL), buffer_capacity(0), allocation_policy(ALLOC_DEFAULT), buffer_policy(ALLOC_DEFAULT), prefaulted(0), paket_capacity(0), num_of_pakets(0), numa_policy(Scheduler::Numa::LOCAL), buffered_merge(false), splittable_merge(true), pipelined(SORT_PIPELINED_DEFAULT), helping_wait(false), helped_pakets(0) {
+			reserve(n, num_of_pakets);
+		}
+
+		~SortContext() {
+			Memory::deallocate(run_buffer, sizeof(_ValueType) * buffer_capacity, buffer_policy);
+		}
+
+		/*
+		 * Grows the workspace so that it can hold a sort of n elements with
+		 * k pakets. Does nothing if the context is already large enough.
+		 */
+		void reserve(_Distance n, unsigned int k) {
+			if (n > buffer_capacity) {
+				Memory::deallocate(run_buffer, sizeof(_ValueType) * buffer_capacity, buffer_policy);
+				run_buffer = NULL;
+				buffer_capacity = 0;
+				prefaulted = 0;
+				buffer_policy = allocation_policy;
+				run_buffer = static_cast<_ValueType*>(Memory::allocate(sizeof(_ValueType) * n, buffer_policy));
+				buffer_capacity = n;
+				if (numa_policy == Scheduler::Numa::INTERLEAVE) {
+					Scheduler::Numa::interleave(run_buffer, sizeof(_ValueType) * n, false);
+				}
+			}
+			if (k > paket_capacity) {
+				splitter_matrix.assign((k+1)*k, NULL);
+				splitter_rows.resize(k+1);
+				split_scratch.resize(k*(k+16));
+				row_prefix.resize(k+1);
+				split_roots.reserve(k);
+				split_subtrees.reserve(k);
+				row_pakets.resize(k+1);
+				join_items.reserve(k);
+				merge_scratch.resize(3*k*k);
+				merge_split_scratch.resize(k*(k+16));
+
+				// clearing before reserving avoids copying the old pakets
+				sort_pakets.clear();
+				split_pakets.clear();
+				merge_pakets.clear();
+				prefault_pakets.clear();
+				sort_pakets.reserve(k);
+				prefault_pakets.reserve(k);
+				split_pakets.reserve(k);
+				merge_pakets.reserve(k);
+				paket_capacity = k;
+			}
+		}
+
+		/*
+		 * Sets the NUMA placement policy. Switching to Numa::INTERLEAVE
+		 * migrates an already allocated buffer.
+		 */
+		void setNumaPolicy(Scheduler::Numa::Policy policy) {
+			numa_policy = policy;
+			if (policy == Scheduler::Numa::INTERLEAVE && run_buffer != NULL) {
+				Scheduler::Numa::interleave(run_buffer, sizeof(_ValueType) * buffer_capacity, true);
+			}
+		}
+
+		Scheduler::Numa::Policy numaPolicy() const {
+			return numa_policy;
+		}
+
+		/*
+		 * Sets the allocation policy of the run buffer. An already allocated
+		 * buffer is freed, the next reserve() allocates it with the new policy.
+		 */
+		void setAllocationPolicy(AllocationPolicy policy) {
+			allocation_policy = policy;
+			if (run_buffer != NULL && policy != buffer_policy) {
+				Memory::deallocate(run_buffer, sizeof(_ValueType) * buffer_capacity, buffer_policy);
+				run_buffer = NULL;
+				buffer_capacity = 0;
+				prefaulted = 0;
+			}
+		}
+
+		/*
+		 * Returns the policy the run buffer was allocated with, which differs
+		 * from the requested one if huge pages were not available.
+		 */
+		AllocationPolicy allocationPolicy() const {
+			return (run_buffer != NULL) ? buffer_policy : allocation_policy;
+		}
+
+		/*
+		 * Sets whether the merge pakets copy the parts of their sequences into
+		 * one contiguous buffer before merging, which helps if the parts are
+		 * small and scattered over many pages.
+		 */
+		void setBufferedMerge(bool buffered) {
+			buffered_merge = buffered;
+		}
+
+		bool bufferedMerge() const {
+			return buffered_merge;
+		}
+
+		/*
+		 * Sets whether large merge pakets merge in chunks, so that idle
+		 * workers can take over the rest of a running one (see MergePaket).
+		 * Buffered merge pakets are never split.
+		 */
+		void setSplittableMerge(bool splittable) {
+			splittable_merge = splittable;
+		}
+
+		bool splittableMerge() const {
+			return splittable_merge;
+		}
+
+		/*
+		 * Sets whether the phases of the sort are connected by dependencies
+		 * (see prepareDependencies()) or separated by waiting for the queue.
+		 */
+		void setPipelined(bool p) {
+			pipelined = p;
+		}
+
+		bool isPipelined() const {
+			return pipelined;
+		}
+
+		/*
+		 * Sets whether the thread calling the sort runs pakets while it waits
+		 * for them (see wait()).
+		 */
+		void setHelpingWait(bool helping) {
+			helping_wait = helping;
+		}
+
+		bool helpingWait() const {
+			return helping_wait;
+		}
+
+		/*
+		 * Waits until all pakets in the queue are done. With the helping wait
+		 * the calling thread runs pakets meanwhile, as long as its core is
+		 * not blocked if it is pinned to one.
+		 */
+		void wait(Scheduler::WorkQueue* queue) {
+			if (helping_wait) {
+				helped_pakets += Scheduler::MaleableScheduler::singleton()->helpUntilDone(queue);
+			} else {
+				queue->blockuntildone();
+			}
+		}
+
+		/*
+		 * Returns the number of pakets the calling thread ran while it waited
+		 * in the current sort call.
+		 */
+		std::size_t helpedPakets() const {
+			return helped_pakets;
+		}
+
+		/*
+		 * Faults in the pages of the first n elements of the run buffer with
+		 * num_of_pakets PrefaultPakets on the queue, unless the policy is
+		 * ALLOC_DEFAULT or they were faulted in before. The pakets split the
+		 * pages of the range like the runs, so with first touch placement the
+		 * pages end up near the threads sorting into them.
+		 */
+		void prefault(_Distance n, Scheduler::WorkQueue* queue) {
+			if (buffer_policy == ALLOC_DEFAULT || n <= prefaulted) return;
+			const std::size_t page = sysconf(_SC_PAGESIZE);
+			char* begin = reinterpret_cast<char*>(run_buffer + prefaulted);
+			char* end = reinterpret_cast<char*>(run_buffer + n);
+			// the pakets are cut at page boundaries, so that no page is
+			// touched by two pakets
+			char* first = reinterpret_cast<char*>(reinterpret_cast<std::size_t>(begin) & ~(page - 1));
+			std::size_t num_pages = (end - first + page - 1) / page;
+			std::size_t pages = 0;
+			prefault_pakets.clear();
+			for (unsigned int i = 0; i < num_of_pakets; i++) {
+				std::size_t size = paket_size(num_pages, num_of_pakets, i);
+				char* b = std::max(begin, first + pages * page);
+				char* e = std::min(end, first + (pages + size) * page);
+				pages += size;
+				if (b >= e) continue;
+				prefault_pakets.push_back(PrefaultPaket(b, e, page, false));
+				queue->push(&prefault_pakets.back());
+			}
+			wait(queue);
+			prefaulted = n;
+		}
+
+		/*
+		 * Prepares the context for one sort call with k pakets. Grows the
+		 * workspace if necessary and sets up the rows of the splitter matrix.
+		 */
+		void prepare(_Distance n, unsigned int k) {
+			reserve(n, k);
+			num_of_pakets = k;
+			helped_pakets = 0;
+			for (unsigned int i = 0; i < k+1; i++) {
+				splitter_rows[i] = &splitter_matrix[i*k];
+			}
+			sort_pakets.clear();
+			split_pakets.clear();
+			merge_pakets.clear();
+		}
+
+		/*
+		 * Returns the run buffer.
+		 */
+		_ValueType* buffer() {
+			return run_buffer;
+		}
+
+		/*
+		 * Returns the splitter matrix as array of k+1 rows with k splitters each.
+		 */
+		_ValueType*** splitters() {
+			return &splitter_rows[0];
+		}
+
+		/*
+		 * Creates the SortPaket for the run [begin,end) in the context's storage
+		 * and returns a pointer to it.
+		 */
+		_SortPaket* sortPaket(_RandomAccessIterator begin, _RandomAccessIterator end, _ValueType* buf) {
+			sort_pakets.push_back(_SortPaket(begin, end, buf, numaLocal()));
+			if (numaLocal() && begin != end) {
+				sort_pakets.back().setNode(nodeOf(begin));
+			}
+			return &sort_pakets.back();
+		}
+
+	private:
+		/*
+		 * Creates the split pakets for the rows in (lo,hi) of the bisection
+		 * tree, the paket of the middle row at the given depth. Pakets above
+		 * top_depth search between the first and last row and are collected
+		 * as roots, the others between lo and hi and are pushed by their
+		 * parents. Returns the paket of the middle row or NULL.
+		 */
+		_SplitPaket* splitTree(unsigned int lo, unsigned int hi, unsigned int depth, unsigned int top_depth, Scheduler::WorkQueue* queue) {
+			if (hi - lo < 2) return NULL;
+			unsigned int k = num_of_pakets;
+			unsigned int mid = lo + (hi-lo)/2;
+			bool top = depth < top_depth;
+			split_pakets.push_back(_SplitPaket(splitters(), k, mid, top ? 0 : lo, top ? k : hi, &row_prefix[0], &split_scratch[(mid-1)*(k+16)], queue));
+			_SplitPaket* paket = &split_pakets.back();
+			row_pakets[mid] = paket;
+			_SplitPaket* left = splitTree(lo, mid, depth+1, top_depth, queue);
+			_SplitPaket* right = splitTree(mid, hi, depth+1, top_depth, queue);
+			if (top) {
+				split_roots.push_back(paket);
+				if (depth+1 == top_depth) {
+					if (left != NULL) split_subtrees.push_back(left);
+					if (right != NULL) split_subtrees.push_back(right);
+				}
+			} else {
+				paket->setChildren(left, right);
+			}
+			return paket;
+		}
+
+	public:
+		/*
+		 * Creates the split pakets for the inner rows of the splitter matrix,
+		 * prefix_sizes[i] being the number of elements before row i+1. Rows
+		 * are computed by bisection, each between two rows that are already
+		 * known, so the selections reuse the search of the rows before them.
+		 * To keep parallelism cores busy from the start, the top levels of
+		 * the tree with about parallelism pakets are independent: first
+		 * splitRoots() are pushed, then after they are done splitSubtrees().
+		 */
+		void prepareSplit(const _Distance* prefix_sizes, unsigned int parallelism, Scheduler::WorkQueue* queue) {
+			unsigned int k = num_of_pakets;
+			row_prefix[0] = 0;
+			for (unsigned int i = 0; i < k; i++) {
+				row_prefix[i+1] = prefix_sizes[i];
+			}
+			split_roots.clear();
+			split_subtrees.clear();
+			std::fill(row_pakets.begin(), row_pakets.begin() + k+1, static_cast<_SplitPaket*>(NULL));
+			unsigned int top_depth = 1;
+			while ((1u << top_depth) - 1 < std::min(parallelism, k-1) && top_depth < 31) {
+				top_depth++;
+			}
+			splitTree(0, k, 0, top_depth, queue);
+		}
+
+		std::vector<_SplitPaket*>& splitRoots() {
+			return split_roots;
+		}
+
+		std::vector<_SplitPaket*>& splitSubtrees() {
+			return split_subtrees;
+		}
+
+		/*
+		 * Creates the MergePaket merging the elements between splitter rows
+		 * paket and paket+1 into the output.
+		 */
+		_MergePaket* mergePaket(unsigned int paket, _RandomAccessIterator output) {
+			_ValueType*** rows = splitters();
+			merge_pakets.push_back(_MergePaket(rows[paket], rows[paket+1], output, num_of_pakets, &merge_scratch[3*paket*num_of_pakets], &merge_split_scratch[paket*(num_of_pakets+16)]));
+			merge_pakets.back().setBuffered(buffered_merge);
+			merge_pakets.back().setSplittable(splittable_merge);
+			// the size of the output is the number of elements between the rows
+			if (numaLocal() && row_prefix[paket+1] > row_prefix[paket]) {
+				merge_pakets.back().setNode(nodeOf(output));
+			}
+			return &merge_pakets.back();
+		}
+
+		std::vector<_SortPaket>& sortPakets() {
+			return sort_pakets;
+		}
+
+		/*
+		 * Declares the dependencies between the pakets of the sort call, once
+		 * all sort, split and merge pakets are created: a JoinPaket depends on
+		 * all sort pakets and pushes the split roots, or the merge paket if
+		 * there is only one. Each split subtree depends on the rows bounding
+		 * it and merge paket i on the rows i and i+1. So only the sort pakets
+		 * have to be pushed, the queue pushes the others when they are ready.
+		 * Every row of the splitter matrix is searched in all runs, so no
+		 * split can start before the last run is sorted.
+		 */
+		void prepareDependencies(Scheduler::WorkQueue* queue) {
+			unsigned int k = num_of_pakets;
+			join_items.clear();
+			if (split_roots.empty()) {
+				for (unsigned int i = 0; i < merge_pakets.size(); i++) {
+					join_items.push_back(&merge_pakets[i]);
+				}
+			} else {
+				join_items.assign(split_roots.begin(), split_roots.end());
+			}
+			join_pakets.clear();
+			join_pakets.push_back(JoinPaket(join_items.empty() ? NULL : &join_items[0], join_items.size(), queue));
+			for (unsigned int i = 0; i < sort_pakets.size(); i++) {
+				join_pakets.back().dependsOn(&sort_pakets[i]);
+			}
+			for (unsigned int i = 0; i < split_subtrees.size(); i++) {
+				_SplitPaket* subtree = split_subtrees[i];
+				if (row_pakets[subtree->lowerRow()] != NULL) subtree->dependsOn(row_pakets[subtree->lowerRow()]);
+				if (row_pakets[subtree->upperRow()] != NULL) subtree->dependsOn(row_pakets[subtree->upperRow()]);
+			}
+			if (!split_roots.empty()) {
+				for (unsigned int i = 0; i < merge_pakets.size(); i++) {
+					if (i > 0) merge_pakets[i].dependsOn(row_pakets[i]);
+					if (i+1 < k) merge_pakets[i].dependsOn(row_pakets[i+1]);
+				}
+			}
+		}
+};
+
+} // namespace
+
+#endif
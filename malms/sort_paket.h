@@ -16,15 +16,21 @@
 #include <vector>
 #include <algorithm>
 #include "workpaket.h"
+#include "run_formation.h"
+#include "threadpool/numa.h"
 
 namespace malms {
 
 /*
  * Implements the Workpaket Interface. The constructor takes two Random-Access-
- * Iterators (begin and end) and saves them into the status of the SortPaket.
- * The () operator sorts the intervall [begin,end) using GNU-sort.
+ * Iterators (begin and end) and the position of the run in the buffer and saves
+ * them into the status of the SortPaket.
+ * The () operator sorts the intervall [begin,end) into the buffer, using radix
+ * sort for types with RadixTraits and GNU-sort otherwise. With _Stable, the
+ * order of equal elements is preserved. With bind_local, the run in the buffer
+ * is placed on the NUMA node of the sorting thread first.
  */
-template<typename _RandomAccessIterator, typename _BufferIterator>
+template<typename _RandomAccessIterator, typename _BufferIterator, bool _Stable = false>
 class SortPaket : public Workpaket {
 	private:
 		// typedefs
@@ -34,25 +40,30 @@ class SortPaket : public Workpaket {
 		_RandomAccessIterator begin;
 		_RandomAccessIterator end;
 		_BufferIterator buffer;
+		bool bind_local;
 		
 	public:
 		/*
-		 * Sorts the intervall [begin,end) using a buffer and GNU-sort.
+		 * Sorts the intervall [begin,end) into [buffer,buffer+(end-begin)). The
+		 * buffer is owned by the caller (see SortContext). The intervall is used
+		 * as temporary space, it is overwritten by the merge afterwards anyway.
 		 */
 		void operator()() {
+			if (bind_local && begin != end) {
+				Scheduler::Numa::bind(&(*buffer), (end-begin)*sizeof(_ValueType), Scheduler::Numa::current_node(), true);
+			}
 			// do buffered sort
-			*buffer = static_cast<_ValueType*>(::operator new(sizeof(_ValueType) * (end-begin)));
-			std::copy(begin,end,*buffer);
-			std::sort(*buffer,(*buffer)+(end-begin));
+			Sorting::form_run<_Stable>(begin,end,buffer);
 		}
 		
 		/*
 		 * Constructor initializes the sort attributes.	
 		 */
-		SortPaket(_RandomAccessIterator begin, _RandomAccessIterator end, _BufferIterator buf) {
+		SortPaket(_RandomAccessIterator begin, _RandomAccessIterator end, _BufferIterator buf, bool bind_local = false) {
 			this->begin = begin;
 			this->end = end;
 			this->buffer = buf;
+			this->bind_local = bind_local;
 		}
 };
 
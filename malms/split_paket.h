@@ -21,19 +21,23 @@ namespace malms {
 /*
  * Implements the Workpaket Interface. The constructor takes the parameters for
  * splitting and saves them into the class attributes. The () operator excutes
- * the splitting routine.
+ * the splitting routine. With _Stable, equal elements are split in the order
+ * of their sequences.
  */
-template<typename _RandomAccessIterator>
+template<typename _RandomAccessIterator, bool _Stable = false>
 class SplitPaket : public Workpaket {
 	private:
 		// typedefs
 		typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type _Distance;
+		typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
 		
 		// attributes
 		_RandomAccessIterator** splitters;
 		int num_of_pakets;
 		int paket;
 		_Distance prefix_size;
+		// scratch space of num_of_pakets+16 elements, allocated by reduce_split if NULL
+		Splitting::PartitionElement<_ValueType>* scratch;
 		
 	public:
 		/*
@@ -44,17 +48,18 @@ class SplitPaket : public Workpaket {
 		 */
 		void operator()() {
 			//Splitting::parallel_binary_split(splitters, num_of_pakets, paket, prefix_size);
-			Splitting::reduce_split(splitters, num_of_pakets, paket, prefix_size);
+			Splitting::reduce_split<_Stable>(splitters, num_of_pakets, paket, prefix_size, scratch);
 		}
 		
 		/*
 		 * Constructor initializes the splitting attributes.	
 		 */
-		SplitPaket(_RandomAccessIterator** splitters, int num_of_pakets, int paket, _Distance prefix_size) {
+		SplitPaket(_RandomAccessIterator** splitters, int num_of_pakets, int paket, _Distance prefix_size, Splitting::PartitionElement<_ValueType>* scratch = NULL) {
 			this->splitters = splitters;
 			this->num_of_pakets = num_of_pakets;
 			this->paket = paket;
 			this->prefix_size = prefix_size;
+			this->scratch = scratch;
 		}
 };
 
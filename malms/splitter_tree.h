@@ -0,0 +1,187 @@
+/*
+ *  Splitter tree of the sample sort.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the class SplitterTree, the search tree of the
+ *				super scalar sample sort by Sanders and Winkel ("Super Scalar
+ *				Sample Sort", ESA 2004). The splitters are drawn from a random
+ *				sample and stored as an implicit binary tree, an element is
+ *				classified by descending the tree without branches, and
+ *				several elements are classified at once, so that their
+ *				independent comparisons overlap in the pipeline. If a
+ *				splitter occurs several times in the sample, each splitter
+ *				gets an equality bucket of the elements equal to it, which
+ *				needs no sorting, so that frequent keys do not end up in one
+ *				large bucket that can not be split.
+ *
+ */
+
+#ifndef SPLITTER_TREE_H
+#define SPLITTER_TREE_H
+
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <cstddef>
+#include <stdint.h>
+
+// the largest number of buckets is 2^SAMPLE_SORT_MAX_LOG_BUCKETS, including
+// the equality buckets
+#define SAMPLE_SORT_MAX_LOG_BUCKETS 8
+// the number of sample elements per bucket
+#define SAMPLE_SORT_OVERSAMPLING 16
+
+namespace malms {
+
+/*
+ * The splitter tree for 2^log_buckets buckets. The splitters are stored in
+ * tree[1..buckets-1] in the order of a breadth-first traversal, the children
+ * of node j are the nodes 2j and 2j+1. An element e belongs to the bucket
+ * with the number of splitters less than e. With equality buckets, the
+ * splitters are distinct (the largest one repeated to fill the tree), and e
+ * belongs to the bucket 2b if b splitters are less than e, or to the
+ * equality bucket 2b+1 if it is equal to the splitter b.
+ */
+template<typename _ValueType>
+class SplitterTree {
+	private:
+		_ValueType tree[1 << SAMPLE_SORT_MAX_LOG_BUCKETS];
+		// the sorted splitters, for the equality buckets
+		_ValueType sorted[1 << SAMPLE_SORT_MAX_LOG_BUCKETS];
+		unsigned int log_buckets;
+		unsigned int buckets;
+		bool equal_buckets;
+
+		/*
+		 * Returns the bucket of e at the leaf j of the tree.
+		 */
+		unsigned int bucket(unsigned int j, const _ValueType& e) const {
+			unsigned int b = j - buckets;
+			if (!equal_buckets) return b;
+			return 2*b + (b + 1 < buckets && !(e < sorted[b]));
+		}
+
+		/*
+		 * Stores the sorted splitters [lo,hi) in the subtree of node j.
+		 */
+		void fill(unsigned int j, const _ValueType* splitters, unsigned int lo, unsigned int hi) {
+			if (lo >= hi) return;
+			unsigned int mid = lo + (hi-lo)/2;
+			tree[j] = splitters[mid];
+			fill(2*j, splitters, lo, mid);
+			fill(2*j+1, splitters, mid+1, hi);
+		}
+
+	public:
+		SplitterTree() : log_buckets(0), buckets(1), equal_buckets(false) {
+		}
+
+		/*
+		 * Builds the tree for 2^log_buckets buckets from a random sample of
+		 * [begin,end), drawn with a xorshift generator from the given seed,
+		 * so that concurrent pakets do not share a generator. If the sample
+		 * has repeated splitters, equality buckets are used, and the number
+		 * of buckets is halved if they would not fit otherwise.
+		 */
+		template<typename _RandomAccessIterator>
+		void build(_RandomAccessIterator begin, _RandomAccessIterator end, unsigned int log_buckets, uint64_t seed) {
+			this->log_buckets = log_buckets;
+			this->buckets = 1u << log_buckets;
+			std::size_t n = end - begin;
+			std::size_t sample_size = buckets * SAMPLE_SORT_OVERSAMPLING;
+			std::vector<_ValueType> sample(sample_size);
+			uint64_t x = seed | 1;
+			for (std::size_t i = 0; i < sample_size; i++) {
+				x ^= x << 13;
+				x ^= x >> 7;
+				x ^= x << 17;
+				sample[i] = *(begin + (x % n));
+			}
+			std::sort(sample.begin(), sample.end());
+			// the splitters are evenly spaced in the sorted sample
+			for (unsigned int i = 0; i < buckets-1; i++) {
+				sorted[i] = sample[(i+1)*SAMPLE_SORT_OVERSAMPLING];
+			}
+			equal_buckets = std::adjacent_find(sorted, sorted + buckets-1) != sorted + buckets-1;
+			if (equal_buckets) {
+				if (log_buckets == SAMPLE_SORT_MAX_LOG_BUCKETS) {
+					this->log_buckets--;
+					buckets /= 2;
+					for (unsigned int i = 0; i < buckets-1; i++) {
+						sorted[i] = sample[(i+1)*2*SAMPLE_SORT_OVERSAMPLING];
+					}
+				}
+				_ValueType* last = std::unique(sorted, sorted + buckets-1);
+				std::fill(last, sorted + buckets-1, *(last-1));
+			}
+			fill(1, sorted, 0, buckets-1);
+		}
+
+		/*
+		 * Returns the number of buckets, including the equality buckets.
+		 */
+		unsigned int numBuckets() const {
+			return equal_buckets ? 2*buckets : buckets;
+		}
+
+		/*
+		 * Returns true if all elements of bucket b are equal.
+		 */
+		bool isEqualityBucket(unsigned int b) const {
+			return equal_buckets && (b & 1);
+		}
+
+		/*
+		 * Returns the bucket of e.
+		 */
+		unsigned int classify(const _ValueType& e) const {
+			unsigned int j = 1;
+			for (unsigned int l = 0; l < log_buckets; l++) {
+				j = 2*j + (tree[j] < e);
+			}
+			return bucket(j, e);
+		}
+
+		/*
+		 * Writes the buckets of the elements in [begin,end) to oracle and
+		 * adds them to the bucket sizes in counts. Four elements descend the
+		 * tree together.
+		 */
+		template<typename _RandomAccessIterator>
+		void classify(_RandomAccessIterator begin, _RandomAccessIterator end, unsigned char* oracle, std::size_t* counts) const {
+			std::size_t n = end - begin;
+			std::size_t i = 0;
+			for (; i + 4 <= n; i += 4) {
+				unsigned int j0 = 1, j1 = 1, j2 = 1, j3 = 1;
+				const _ValueType& e0 = *(begin + i);
+				const _ValueType& e1 = *(begin + (i+1));
+				const _ValueType& e2 = *(begin + (i+2));
+				const _ValueType& e3 = *(begin + (i+3));
+				for (unsigned int l = 0; l < log_buckets; l++) {
+					j0 = 2*j0 + (tree[j0] < e0);
+					j1 = 2*j1 + (tree[j1] < e1);
+					j2 = 2*j2 + (tree[j2] < e2);
+					j3 = 2*j3 + (tree[j3] < e3);
+				}
+				oracle[i] = bucket(j0, e0);
+				oracle[i+1] = bucket(j1, e1);
+				oracle[i+2] = bucket(j2, e2);
+				oracle[i+3] = bucket(j3, e3);
+				counts[oracle[i]]++;
+				counts[oracle[i+1]]++;
+				counts[oracle[i+2]]++;
+				counts[oracle[i+3]]++;
+			}
+			for (; i < n; i++) {
+				oracle[i] = classify(*(begin + i));
+				counts[oracle[i]]++;
+			}
+		}
+};
+
+} // namespace
+
+#endif
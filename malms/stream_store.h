@@ -0,0 +1,389 @@
+/*
+ *  Output with non-temporal stores.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Implements the StreamSink, a write-combining output that
+ *				collects elements in a buffer of one cache line and writes
+ *				full lines with non-temporal (streaming) stores. The output of
+ *				the merge and of the copies is not read again while the sort
+ *				is in cache, streaming it saves the read-for-ownership of each
+ *				line and keeps the runs that are still read in the cache.
+ *				Outputs smaller than stream_store_threshold() bytes are
+ *				written with normal stores.
+ *
+ */
+
+#ifndef STREAM_STORE_H
+#define STREAM_STORE_H
+
+#include <iterator>
+#include <algorithm>
+#include <cstddef>
+#include <stdint.h>
+#include <unistd.h>
+#include <boost/type_traits/is_pod.hpp>
+#include <boost/type_traits/is_same.hpp>
+
+#include "simd_sort.h"
+
+// the size of the write-combining buffer, one cache line
+#define STREAM_STORE_LINE 64
+// outputs of at least this many bytes are streamed by default
+#define STREAM_STORE_THRESHOLD (1 << 22)
+
+namespace malms {
+
+namespace Memory {
+
+/*
+ * Returns the threshold in bytes above which outputs are streamed. It can be
+ * changed with set_stream_store_threshold(), e.g. for benchmarking.
+ */
+inline std::size_t& stream_store_threshold_ref() {
+	static std::size_t threshold = STREAM_STORE_THRESHOLD;
+	return threshold;
+}
+
+inline std::size_t stream_store_threshold() {
+	return stream_store_threshold_ref();
+}
+
+inline void set_stream_store_threshold(std::size_t bytes) {
+	stream_store_threshold_ref() = bytes;
+}
+
+/*
+ * Writes one cache line from src to the line aligned dst, bypassing the cache.
+ */
+inline void stream_line(void* dst, const void* src) {
+	#ifdef MALMS_SIMD_X86
+	const __m128i* s = static_cast<const __m128i*>(src);
+	__m128i* d = static_cast<__m128i*>(dst);
+	_mm_stream_si128(d,   _mm_loadu_si128(s));
+	_mm_stream_si128(d+1, _mm_loadu_si128(s+1));
+	_mm_stream_si128(d+2, _mm_loadu_si128(s+2));
+	_mm_stream_si128(d+3, _mm_loadu_si128(s+3));
+	#else
+	std::copy(static_cast<const char*>(src), static_cast<const char*>(src) + STREAM_STORE_LINE, static_cast<char*>(dst));
+	#endif
+}
+
+/*
+ * Orders the streaming stores before all later stores, so that other threads
+ * see the output once the paket is done.
+ */
+inline void stream_fence() {
+	#ifdef MALMS_SIMD_X86
+	_mm_sfence();
+	#endif
+}
+
+/*
+ * Whether the elements of the output iterator can be streamed: the iterator
+ * has to point into an array of plain old data of a size that divides the
+ * cache line. aligned() tells whether the output starts at a multiple of the
+ * size of the elements, so that the cache lines hold whole elements, which
+ * is not given for elements aligned to less than their size.
+ */
+template<typename _OutputIterator, bool _Contiguous = Sorting::ContiguousIterator<_OutputIterator>::value>
+struct StreamStoreTraits {
+	static const bool enabled = false;
+	static bool aligned(_OutputIterator) {
+		return false;
+	}
+};
+
+template<typename _OutputIterator>
+struct StreamStoreTraits<_OutputIterator, true> {
+	typedef typename std::iterator_traits<_OutputIterator>::value_type _ValueType;
+	static const bool enabled = boost::is_pod<_ValueType>::value
+		&& sizeof(_ValueType) <= STREAM_STORE_LINE
+		&& STREAM_STORE_LINE % sizeof(_ValueType) == 0;
+	static bool aligned(_OutputIterator out) {
+		return reinterpret_cast<uintptr_t>(Sorting::ContiguousIterator<_OutputIterator>::pointer(out)) % sizeof(_ValueType) == 0;
+	}
+};
+
+/*
+ * Returns true if an output of n elements to the output iterator should be
+ * streamed, outputs that are not aligned to the size of their elements are
+ * never streamed.
+ */
+template<typename _OutputIterator, typename _Distance>
+inline bool use_stream_store(_OutputIterator out, _Distance n) {
+	if (!StreamStoreTraits<_OutputIterator>::enabled || !StreamStoreTraits<_OutputIterator>::aligned(out)) return false;
+	typedef typename std::iterator_traits<_OutputIterator>::value_type _ValueType;
+	return static_cast<std::size_t>(n) * sizeof(_ValueType) >= stream_store_threshold();
+}
+
+/*
+ * A write-combining output iterator to [out,...), which has to be aligned to
+ * the size of the elements (see use_stream_store()). The elements are collected
+ * in the line buffer of a StreamSink and full lines are streamed. The first
+ * line is only partially owned by this output if out is not line aligned, it
+ * is written with normal stores like the last one, so that no elements before
+ * out or after the end are overwritten. The iterator holds the position, so
+ * that it is kept in registers, the final copy of the iterator has to be
+ * passed to StreamSink::finish().
+ */
+template<typename _ValueType>
+class StreamSinkIterator {
+	private:
+		static const unsigned int N = STREAM_STORE_LINE / sizeof(_ValueType);
+
+		// the line buffer of the sink
+		_ValueType* buffer;
+		// the line of the output the buffer belongs to
+		_ValueType* line;
+		// the first element of the line that belongs to the output
+		unsigned int first;
+		// the number of elements in the line, including the ones before first
+		unsigned int fill;
+
+		/*
+		 * Writes the full buffer and starts the next line.
+		 */
+		void flush() {
+			if (first == 0) {
+				stream_line(line, buffer);
+			} else {
+				writePartial();
+				first = 0;
+			}
+			line += N;
+			fill = 0;
+		}
+
+	public:
+		typedef std::output_iterator_tag iterator_category;
+		typedef void value_type;
+		typedef void difference_type;
+		typedef void pointer;
+		typedef void reference;
+
+		StreamSinkIterator(_ValueType* buffer, _ValueType* out) : buffer(buffer) {
+			uintptr_t offset = reinterpret_cast<uintptr_t>(out) % STREAM_STORE_LINE;
+			line = reinterpret_cast<_ValueType*>(reinterpret_cast<char*>(out) - offset);
+			first = offset / sizeof(_ValueType);
+			fill = first;
+		}
+
+		/*
+		 * Appends one element.
+		 */
+		void put(const _ValueType& value) {
+			buffer[fill++] = value;
+			if (fill == N) flush();
+		}
+
+		/*
+		 * Appends [begin,begin+n). Full lines are streamed directly from the
+		 * source instead of through the buffer.
+		 */
+		void write(const _ValueType* begin, std::size_t n) {
+			while (n > 0 && fill != 0) {
+				put(*begin++);
+				n--;
+			}
+			for (; n >= N; n -= N, begin += N) {
+				stream_line(line, begin);
+				line += N;
+			}
+			while (n > 0) {
+				put(*begin++);
+				n--;
+			}
+		}
+
+		/*
+		 * Writes the elements [first,fill) of the buffer with normal stores.
+		 */
+		void writePartial() {
+			std::copy(buffer + first, buffer + fill, line + first);
+		}
+
+		StreamSinkIterator& operator*() {
+			return *this;
+		}
+		StreamSinkIterator& operator=(const _ValueType& value) {
+			put(value);
+			return *this;
+		}
+		StreamSinkIterator& operator++() {
+			return *this;
+		}
+		StreamSinkIterator& operator++(int) {
+			return *this;
+		}
+};
+
+/*
+ * Owns the cache line aligned buffer of the StreamSinkIterators.
+ */
+template<typename _ValueType>
+class StreamSink {
+	private:
+		union {
+			_ValueType buffer[STREAM_STORE_LINE / sizeof(_ValueType)];
+			char aligned[STREAM_STORE_LINE] __attribute__((aligned(STREAM_STORE_LINE)));
+		};
+
+		// non copyable
+		StreamSink(const StreamSink&);
+		StreamSink& operator=(const StreamSink&);
+
+	public:
+		StreamSink() {
+		}
+
+		/*
+		 * Returns an output iterator to [out,...).
+		 */
+		StreamSinkIterator<_ValueType> iterator(_ValueType* out) {
+			return StreamSinkIterator<_ValueType>(buffer, out);
+		}
+
+		/*
+		 * Writes the last partial line of the iterator after the last element
+		 * and waits for the streaming stores.
+		 */
+		void finish(StreamSinkIterator<_ValueType> it) {
+			it.writePartial();
+			stream_fence();
+		}
+};
+
+/*
+ * Wraps an output iterator for an algorithm that writes its output in order
+ * and returns the end of the output: iterator() is a StreamSinkIterator to the
+ * output, finish() has to be called with the returned iterator. For outputs
+ * that can not be streamed iterator() is the output iterator itself.
+ */
+template<typename _OutputIterator, bool _Enabled = StreamStoreTraits<_OutputIterator>::enabled>
+class StreamOutput {
+	private:
+		_OutputIterator out;
+	public:
+		typedef _OutputIterator iterator_type;
+		StreamOutput(_OutputIterator out) : out(out) {
+		}
+		iterator_type iterator() {
+			return out;
+		}
+		void finish(iterator_type) {
+		}
+};
+
+template<typename _OutputIterator>
+class StreamOutput<_OutputIterator, true> {
+	private:
+		typedef typename std::iterator_traits<_OutputIterator>::value_type _ValueType;
+		StreamSink<_ValueType> sink;
+		_ValueType* out;
+	public:
+		typedef StreamSinkIterator<_ValueType> iterator_type;
+		StreamOutput(_OutputIterator out) : out(Sorting::ContiguousIterator<_OutputIterator>::pointer(out)) {
+		}
+		iterator_type iterator() {
+			return sink.iterator(out);
+		}
+		void finish(iterator_type it) {
+			sink.finish(it);
+		}
+};
+
+/*
+ * Returns the size in bytes from which the libc copies with streaming stores
+ * itself. glibc does so above x86_non_temporal_threshold, by default 3/4 of
+ * the shared cache, and is faster there than the copy through the sink.
+ */
+inline std::size_t libc_stream_threshold() {
+	#if defined(__GLIBC__) && defined(_SC_LEVEL3_CACHE_SIZE)
+	static std::size_t threshold = sysconf(_SC_LEVEL3_CACHE_SIZE) > 0 ? sysconf(_SC_LEVEL3_CACHE_SIZE) / 4 * 3 : static_cast<std::size_t>(-1);
+	return threshold;
+	#else
+	return static_cast<std::size_t>(-1);
+	#endif
+}
+
+/*
+ * Copies [begin,end) to target, with streaming stores if use_stream_store()
+ * allows it for the size of the copy.
+ */
+template<typename _RandomAccessIterator, typename _OutputIterator,
+         bool _Enabled = StreamStoreTraits<_OutputIterator>::enabled>
+struct StreamCopy {
+	static void copy(_RandomAccessIterator begin, _RandomAccessIterator end, _OutputIterator target) {
+		std::copy(begin, end, target);
+	}
+};
+
+/*
+ * Appends [begin,end) to the sink iterator, directly from the source array if
+ * the source is an array of the same type. Copies between arrays that are
+ * large enough for the libc to stream are left to std::copy.
+ */
+template<typename _RandomAccessIterator, typename _ValueType,
+         bool _Contiguous = Sorting::ContiguousIterator<_RandomAccessIterator>::value
+                            && boost::is_same<_ValueType, typename std::iterator_traits<_RandomAccessIterator>::value_type>::value>
+struct StreamSinkWrite {
+	static bool libcStreams(std::size_t) {
+		return false;
+	}
+	static StreamSinkIterator<_ValueType> write(StreamSinkIterator<_ValueType> it, _RandomAccessIterator begin, _RandomAccessIterator end) {
+		return std::copy(begin, end, it);
+	}
+};
+
+template<typename _RandomAccessIterator, typename _ValueType>
+struct StreamSinkWrite<_RandomAccessIterator, _ValueType, true> {
+	static bool libcStreams(std::size_t n) {
+		return n * sizeof(_ValueType) >= libc_stream_threshold();
+	}
+	static StreamSinkIterator<_ValueType> write(StreamSinkIterator<_ValueType> it, _RandomAccessIterator begin, _RandomAccessIterator end) {
+		it.write(Sorting::ContiguousIterator<_RandomAccessIterator>::pointer(begin), end - begin);
+		return it;
+	}
+};
+
+template<typename _RandomAccessIterator, typename _OutputIterator>
+struct StreamCopy<_RandomAccessIterator, _OutputIterator, true> {
+	typedef typename std::iterator_traits<_OutputIterator>::value_type _ValueType;
+	typedef StreamSinkWrite<_RandomAccessIterator,_ValueType> _Write;
+	static void copy(_RandomAccessIterator begin, _RandomAccessIterator end, _OutputIterator target) {
+		if (!use_stream_store(target, end - begin) || _Write::libcStreams(end - begin)) {
+			std::copy(begin, end, target);
+			return;
+		}
+		StreamSink<_ValueType> sink;
+		sink.finish(_Write::write(sink.iterator(Sorting::ContiguousIterator<_OutputIterator>::pointer(target)), begin, end));
+	}
+};
+
+/*
+ * Appends [begin,end) to the output of a StreamOutput and returns its end,
+ * e.g. for an output streamed over several copies.
+ */
+template<typename _RandomAccessIterator, typename _ValueType>
+inline StreamSinkIterator<_ValueType> stream_append(_RandomAccessIterator begin, _RandomAccessIterator end, StreamSinkIterator<_ValueType> it) {
+	return StreamSinkWrite<_RandomAccessIterator,_ValueType>::write(it, begin, end);
+}
+
+template<typename _RandomAccessIterator, typename _OutputIterator>
+inline _OutputIterator stream_append(_RandomAccessIterator begin, _RandomAccessIterator end, _OutputIterator out) {
+	return std::copy(begin, end, out);
+}
+
+template<typename _RandomAccessIterator, typename _OutputIterator>
+inline void stream_copy(_RandomAccessIterator begin, _RandomAccessIterator end, _OutputIterator target) {
+	StreamCopy<_RandomAccessIterator,_OutputIterator>::copy(begin, end, target);
+}
+
+} // namespace Memory
+
+} // namespace malms
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * This class implements the work-stealing deque of Chase and Lev, with the
+ * memory orders of Le et al., "Correct and Efficient Work-Stealing for Weak
+ * Memory Models". The owner pushes and pops at the bottom, other threads steal
+ * from the top.
+ */
+
+#ifndef CHASE_LEV_DEQUE_H
+#define CHASE_LEV_DEQUE_H
+
+#include <vector>
+#include <boost/atomic.hpp>
+
+// the initial capacity of a deque, a power of two
+#define CHASE_LEV_INITIAL_CAPACITY 256
+
+namespace Scheduler {
+
+template<typename _Tp>
+class ChaseLevDeque {
+	private:
+		/*
+		 * A circular array of a power of two capacity.
+		 */
+		struct Array {
+			long mask;
+			boost::atomic<_Tp*>* items;
+
+			Array(long capacity) : mask(capacity - 1), items(new boost::atomic<_Tp*>[capacity]) {
+			}
+			~Array() {
+				delete [] items;
+			}
+			long capacity() const {
+				return mask + 1;
+			}
+			_Tp* get(long i) const {
+				return items[i & mask].load(boost::memory_order_relaxed);
+			}
+			void put(long i, _Tp* item) {
+				items[i & mask].store(item, boost::memory_order_relaxed);
+			}
+		};
+
+		// top and bottom on their own cache lines, thieves only write top
+		char pad0[64];
+		boost::atomic<long> top;
+		char pad1[64 - sizeof(boost::atomic<long>)];
+		boost::atomic<long> bottom;
+		char pad2[64 - sizeof(boost::atomic<long>)];
+		boost::atomic<Array*> array;
+		// the arrays replaced by grow(), a thief may still read from them,
+		// they are deleted with the deque
+		std::vector<Array*> old_arrays;
+
+		/*
+		 * Replaces the array by one of twice the capacity, owner only.
+		 */
+		Array* grow(Array* a, long b, long t) {
+			Array* bigger = new Array(2 * a->capacity());
+			for (long i = t; i < b; i++) {
+				bigger->put(i, a->get(i));
+			}
+			old_arrays.push_back(a);
+			array.store(bigger, boost::memory_order_release);
+			return bigger;
+		}
+
+		// non copyable
+		ChaseLevDeque(const ChaseLevDeque&);
+		ChaseLevDeque& operator=(const ChaseLevDeque&);
+
+	public:
+		ChaseLevDeque() : top(0), bottom(0), array(new Array(CHASE_LEV_INITIAL_CAPACITY)) {
+		}
+
+		~ChaseLevDeque() {
+			delete array.load(boost::memory_order_relaxed);
+			for (std::size_t i = 0; i < old_arrays.size(); i++) {
+				delete old_arrays[i];
+			}
+		}
+
+		/*
+		 * Pushes the item at the bottom, owner only.
+		 */
+		void push(_Tp* item) {
+			long b = bottom.load(boost::memory_order_relaxed);
+			long t = top.load(boost::memory_order_acquire);
+			Array* a = array.load(boost::memory_order_relaxed);
+			if (b - t > a->mask) {
+				a = grow(a, b, t);
+			}
+			a->put(b, item);
+			boost::atomic_thread_fence(boost::memory_order_release);
+			bottom.store(b + 1, boost::memory_order_relaxed);
+		}
+
+		/*
+		 * Pops the item at the bottom, owner only. Returns NULL if the deque
+		 * is empty.
+		 */
+		_Tp* pop() {
+			long b = bottom.load(boost::memory_order_relaxed) - 1;
+			Array* a = array.load(boost::memory_order_relaxed);
+			bottom.store(b, boost::memory_order_relaxed);
+			boost::atomic_thread_fence(boost::memory_order_seq_cst);
+			long t = top.load(boost::memory_order_relaxed);
+			if (t > b) {
+				// empty
+				bottom.store(b + 1, boost::memory_order_relaxed);
+				return NULL;
+			}
+			_Tp* item = a->get(b);
+			if (t == b) {
+				// the last item, race against the thieves
+				if (!top.compare_exchange_strong(t, t + 1, boost::memory_order_seq_cst, boost::memory_order_relaxed)) {
+					item = NULL;
+				}
+				bottom.store(b + 1, boost::memory_order_relaxed);
+			}
+			return item;
+		}
+
+		/*
+		 * Steals the item at the top, any thread. Returns NULL if the deque is
+		 * empty or if another thread took the item first.
+		 */
+		_Tp* steal() {
+			long t = top.load(boost::memory_order_acquire);
+			boost::atomic_thread_fence(boost::memory_order_seq_cst);
+			long b = bottom.load(boost::memory_order_acquire);
+			if (t >= b) return NULL;
+			Array* a = array.load(boost::memory_order_consume);
+			_Tp* item = a->get(t);
+			if (!top.compare_exchange_strong(t, t + 1, boost::memory_order_seq_cst, boost::memory_order_relaxed)) {
+				return NULL;
+			}
+			return item;
+		}
+
+		/*
+		 * Returns whether the deque looks empty, any thread.
+		 */
+		bool empty() const {
+			long b = bottom.load(boost::memory_order_acquire);
+			long t = top.load(boost::memory_order_acquire);
+			return t >= b;
+		}
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,119 @@
+/*
+ * Detection of cores contended by other processes, for the contention
+ * monitor of the Maleable Scheduler.
+ *
+ * The busy time of each CPU is read from /proc/stat, the time a thread of
+ * the scheduler ran and waited for its CPU from its schedstat in /proc. The
+ * load of a core in a period is the larger of the share of the period its
+ * thread waited while others ran, and the share of the period the CPU was
+ * busy without running the thread. A core becomes contended after
+ * CONTENTION_SAMPLES periods above CONTENTION_HIGH, and free again after
+ * CONTENTION_SAMPLES periods below CONTENTION_LOW.
+ */
+
+#ifndef CONTENTION_H
+#define CONTENTION_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include <sys/types.h>
+
+// the load above which a core becomes contended
+#define CONTENTION_HIGH 0.3
+// the load below which a contended core becomes free again
+#define CONTENTION_LOW 0.1
+// the number of periods in a row that change the state of a core
+#define CONTENTION_SAMPLES 2
+// the default period of the monitor in milliseconds
+#define CONTENTION_MONITOR_PERIOD 100
+
+namespace Scheduler {
+
+namespace Contention {
+
+/*
+ * Reads the busy seconds of each CPU since boot from /proc/stat, indexed by
+ * the CPU id, i.e. all but the idle and iowait time. Returns false if the
+ * file cannot be read.
+ */
+inline bool read_cpu_busy(std::vector<double>& busy) {
+	std::ifstream stat("/proc/stat");
+	if (!stat) return false;
+	double tick = 1.0 / sysconf(_SC_CLK_TCK);
+	busy.clear();
+	std::string line;
+	while (std::getline(stat, line)) {
+		// the lines of single CPUs, not the sum of all
+		if (line.compare(0, 3, "cpu") != 0 || line.size() < 4 || line[3] == ' ') continue;
+		std::istringstream ls(line.substr(3));
+		std::size_t cpu;
+		ls >> cpu;
+		unsigned long long time, total = 0, idle = 0;
+		for (int field = 0; ls >> time; field++) {
+			// the guest times are already part of user and nice
+			if (field >= 8) break;
+			total += time;
+			// idle and iowait
+			if (field == 3 || field == 4) idle += time;
+		}
+		if (busy.size() <= cpu) busy.resize(cpu + 1, 0);
+		busy[cpu] = (total - idle) * tick;
+	}
+	return true;
+}
+
+/*
+ * Reads the seconds the thread tid of this process ran and waited for a
+ * CPU. Returns false if the kernel has no schedstat.
+ */
+inline bool read_schedstat(pid_t tid, double& run, double& wait) {
+	std::ostringstream name;
+	name << "/proc/self/task/" << tid << "/schedstat";
+	std::ifstream stat(name.str().c_str());
+	unsigned long long run_ns, wait_ns;
+	if (!(stat >> run_ns >> wait_ns)) return false;
+	run = run_ns * 1e-9;
+	wait = wait_ns * 1e-9;
+	return true;
+}
+
+/*
+ * The state of one core with the hysteresis between contended and free.
+ */
+class Detector {
+	private:
+		bool contended;
+		// the periods in a row that would change the state
+		int count;
+
+	public:
+		Detector() : contended(false), count(0) {
+		}
+
+		/*
+		 * Takes the load of the core in the last period, returns whether
+		 * the core is contended.
+		 */
+		bool sample(double load) {
+			bool change = contended ? load < CONTENTION_LOW : load > CONTENTION_HIGH;
+			count = change ? count + 1 : 0;
+			if (count >= CONTENTION_SAMPLES) {
+				contended = !contended;
+				count = 0;
+			}
+			return contended;
+		}
+
+		bool isContended() const {
+			return contended;
+		}
+};
+
+} // namespace
+
+} // namespace
+
+#endif
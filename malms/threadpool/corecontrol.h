@@ -0,0 +1,150 @@
+/*
+ * Control messages for the available cores of the Maleable Scheduler.
+ *
+ * A message is a batch of lines, each a command and a list of cores like
+ * "0-3,8" or "0 1 2":
+ *   block 1,3       the cores 1 and 3 are not available
+ *   unblock 0-2     the cores 0, 1 and 2 are available again
+ *   set 0,2-3       only the cores 0, 2 and 3 are available
+ * The scheduler applies all lines of a message in one step. It receives the
+ * messages as datagrams on a Unix domain socket, by default the one named
+ * by CORE_CONTROL_SOCKET and the pid of the process.
+ */
+
+#ifndef CORE_CONTROL_H
+#define CORE_CONTROL_H
+
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// the default path of the control socket of a process, with its pid
+#define CORE_CONTROL_SOCKET "/tmp/malms-%d.sock"
+// the maximal size of a message in bytes
+#define CORE_CONTROL_MAX_MESSAGE 4096
+
+namespace Scheduler {
+
+namespace CoreControl {
+
+/*
+ * Returns the default path of the control socket of the process pid.
+ */
+inline std::string socket_path(int pid) {
+	char path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+	snprintf(path, sizeof(path), CORE_CONTROL_SOCKET, pid);
+	return std::string(path);
+}
+
+/*
+ * Fills the socket address for the path, returns false if it is too long.
+ */
+inline bool socket_address(const std::string& path, struct sockaddr_un& address) {
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) return false;
+	strcpy(address.sun_path, path.c_str());
+	return true;
+}
+
+/*
+ * Parses a list of cores like "0-3,8" or "0 1 2" and marks its cores in the
+ * vector, the cores beyond the vector are ignored. Returns false if the list
+ * is malformed.
+ */
+inline bool parse_cores(const std::string& list, std::vector<bool>& cores) {
+	std::string items(list);
+	for (std::size_t i = 0; i < items.size(); i++) {
+		if (items[i] == ',') items[i] = ' ';
+	}
+	std::istringstream ss(items);
+	std::string range;
+	while (ss >> range) {
+		char* end;
+		long first = strtol(range.c_str(), &end, 10);
+		long last = first;
+		if (end == range.c_str() || first < 0) return false;
+		if (*end == '-') {
+			const char* second = end + 1;
+			last = strtol(second, &end, 10);
+			if (end == second || last < first) return false;
+		}
+		if (*end != '\0') return false;
+		// ranges are clamped to the cores, any range costs at most their number
+		last = std::min(last, static_cast<long>(cores.size()) - 1);
+		for (long c = first; c <= last; c++) cores[c] = true;
+	}
+	return true;
+}
+
+/*
+ * Applies the message to the availability of the cores, cores beyond the
+ * vector are ignored. Returns false if a line is malformed, the
+ * availability is unchanged then.
+ */
+inline bool apply(const std::string& message, std::vector<bool>& available) {
+	std::vector<bool> result(available);
+	std::istringstream lines(message);
+	std::string line;
+	while (std::getline(lines, line)) {
+		std::istringstream ls(line);
+		std::string command;
+		if (!(ls >> command)) continue;
+		std::string rest;
+		std::getline(ls, rest);
+		std::vector<bool> cores(result.size(), false);
+		if (!parse_cores(rest, cores)) return false;
+		if (command == "set") {
+			result.assign(result.size(), false);
+		} else if (command != "block" && command != "unblock") {
+			return false;
+		}
+		bool value = command != "block";
+		for (std::size_t i = 0; i < cores.size(); i++) {
+			if (cores[i]) result[i] = value;
+		}
+	}
+	available = result;
+	return true;
+}
+
+/*
+ * Returns the line of the command for the cores, e.g. "block 1,3\n".
+ */
+inline std::string line(const char* command, const std::vector<int>& cores) {
+	std::ostringstream ss;
+	ss << command << " ";
+	for (std::size_t i = 0; i < cores.size(); i++) {
+		if (i > 0) ss << ",";
+		ss << cores[i];
+	}
+	ss << "\n";
+	return ss.str();
+}
+
+/*
+ * Sends the message to the control socket at the path. Returns false if
+ * there is no such socket or the message could not be sent.
+ */
+inline bool send(const std::string& path, const std::string& message) {
+	struct sockaddr_un address;
+	if (!socket_address(path, address) || message.size() > CORE_CONTROL_MAX_MESSAGE) return false;
+	int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (fd < 0) return false;
+	bool sent = sendto(fd, message.data(), message.size(), 0, (struct sockaddr*)&address, sizeof(address)) == (ssize_t)message.size();
+	close(fd);
+	return sent;
+}
+
+} // namespace
+
+} // namespace
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * The CPUs the Maleable Scheduler may use, and the assignment of its
+ * threads to them.
+ *
+ * The allowed CPUs are the online CPUs of /sys/devices/system/cpu/online in
+ * the cpuset of the process' cgroup (cpuset.cpus.effective of cgroup v2, or
+ * cpuset.effective_cpus of the v1 cpuset hierarchy), and in the affinity of
+ * the thread creating the scheduler, if that is narrower, e.g. by taskset.
+ * The online CPUs and the cpuset can change at runtime by CPU hotplug or by
+ * moving or changing the cgroup.
+ */
+
+#ifndef CPUSET_H
+#define CPUSET_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <iterator>
+#include <unistd.h>
+#include <sched.h>
+#include "numa.h"
+
+// the file with the online CPUs
+#define CPUSET_ONLINE_FILE "/sys/devices/system/cpu/online"
+// the period in milliseconds in which the CPUs are checked, as neither
+// sysfs nor all cgroup files notify about changes
+#define CPUSET_POLL_PERIOD 1000
+
+namespace Scheduler {
+
+namespace Cpuset {
+
+/*
+ * Reads the list of CPUs like "0-3,8" in the file, an empty list if the
+ * file cannot be read.
+ */
+inline std::vector<int> read_list(const std::string& path) {
+	std::ifstream file(path.c_str());
+	std::string list;
+	if (!(file >> list)) return std::vector<int>();
+	return Numa::parse_list(list);
+}
+
+/*
+ * Returns the cpuset file of the cgroup of the process, with the CPUs it
+ * may use, an empty string if there is none.
+ */
+inline std::string cgroup_file() {
+	std::ifstream cgroups("/proc/self/cgroup");
+	std::string line;
+	std::string v2;
+	while (std::getline(cgroups, line)) {
+		// hierarchy-id:controllers:path
+		std::size_t first = line.find(':');
+		std::size_t second = line.find(':', first + 1);
+		if (first == std::string::npos || second == std::string::npos) continue;
+		std::string controllers = line.substr(first + 1, second - first - 1);
+		std::string path = line.substr(second + 1);
+		if (path == "/") path = "";
+		std::string controller;
+		std::istringstream cs(controllers);
+		while (std::getline(cs, controller, ',')) {
+			if (controller == "cpuset") {
+				std::string file = "/sys/fs/cgroup/cpuset" + path + "/cpuset.effective_cpus";
+				if (access(file.c_str(), R_OK) == 0) return file;
+			}
+		}
+		if (controllers.empty() && line.compare(0, first, "0") == 0) v2 = path;
+	}
+	// the nearest cgroup of the v2 hierarchy with the cpuset controller
+	while (true) {
+		std::string file = "/sys/fs/cgroup" + v2 + "/cpuset.cpus.effective";
+		if (access(file.c_str(), R_OK) == 0) return file;
+		if (v2.empty()) return std::string();
+		v2 = v2.substr(0, v2.rfind('/'));
+	}
+}
+
+/*
+ * Returns the CPUs of the calling thread's affinity.
+ */
+inline std::vector<int> affinity() {
+	std::vector<int> cpus;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(cpu_set_t), &set) != 0) return cpus;
+	for (int c = 0; c < CPU_SETSIZE; c++) {
+		if (CPU_ISSET(c, &set)) cpus.push_back(c);
+	}
+	return cpus;
+}
+
+/*
+ * Returns the CPUs in both sorted lists, or the first one if the second is
+ * empty.
+ */
+inline std::vector<int> intersect(const std::vector<int>& a, const std::vector<int>& b) {
+	if (b.empty()) return a;
+	std::vector<int> result;
+	std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+	return result;
+}
+
+/*
+ * Returns the allowed CPUs, the online ones in the cgroup's cpuset file
+ * (unless it is empty) and in the restriction (unless it is empty).
+ */
+inline std::vector<int> allowed(const std::string& cgroup, const std::vector<int>& restriction) {
+	std::vector<int> cpus = read_list(CPUSET_ONLINE_FILE);
+	if (cpus.empty()) {
+		for (long c = 0; c < sysconf(_SC_NPROCESSORS_ONLN); c++) cpus.push_back(c);
+	}
+	if (!cgroup.empty()) {
+		std::vector<int> cpuset = read_list(cgroup);
+		std::sort(cpuset.begin(), cpuset.end());
+		cpus = intersect(cpus, cpuset);
+	}
+	return intersect(cpus, restriction);
+}
+
+/*
+ * Returns the CPU of each thread for the allowed CPUs, -1 for a parked
+ * thread: a thread keeps its CPU if it is still allowed, the other threads
+ * take the remaining CPUs in order, and are parked if there are none left.
+ */
+inline std::vector<int> assign(const std::vector<int>& current, const std::vector<int>& cpus) {
+	std::vector<int> result(current.size(), -1);
+	std::vector<bool> taken(cpus.size(), false);
+	for (std::size_t i = 0; i < current.size(); i++) {
+		std::size_t c = std::find(cpus.begin(), cpus.end(), current[i]) - cpus.begin();
+		if (c < cpus.size() && !taken[c]) {
+			result[i] = current[i];
+			taken[c] = true;
+		}
+	}
+	std::size_t c = 0;
+	for (std::size_t i = 0; i < current.size(); i++) {
+		if (result[i] >= 0) continue;
+		while (c < cpus.size() && taken[c]) c++;
+		if (c == cpus.size()) break;
+		result[i] = cpus[c];
+		taken[c] = true;
+	}
+	return result;
+}
+
+} // namespace
+
+} // namespace
+
+#endif
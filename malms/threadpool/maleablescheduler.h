@@ -1,5 +1,31 @@
 /*
  * This class implements the Maleable Scheduler.
+ *
+ * With fair share enabled, the scheduler splits the cores that are not blocked
+ * among its jobs by their weights, and rebalances when a job is created or
+ * deleted, its weight changes or a core is blocked or unblocked. A core moved
+ * to another job is handed over when its thread finishes its current paket.
+ *
+ * Jobs with pending pakets come first: a job with a deadline gets the cores
+ * it needs to finish its pending pakets in time, at the cost per paket it had
+ * so far, then the jobs of the highest priority class share the rest, at most
+ * one core per pending paket, then the next class. Jobs without pending
+ * pakets only get cores nobody else can use. While jobs compete, a rebalancer
+ * thread repeats this every SCHEDULER_REBALANCE_PERIOD microseconds.
+ *
+ * The available cores are set with setAvailableCores(), with a control
+ * message on the socket started by startControlSocket() (see corecontrol.h),
+ * or with one realtime signal per core. Each update is applied in one step.
+ * The contention monitor started by startContentionMonitor() blocks the
+ * cores other processes contend for by the same path, but never the last
+ * available core, and unblocks them when the load is gone (see
+ * contention.h).
+ *
+ * Thread i is pinned to the CPU cpuOfCore(i), the CPUs are the ones the
+ * process may use (see cpuset.h). A thread without a CPU is parked, i.e.
+ * its core is not available. A thread watches the allowed CPUs, when they
+ * change by CPU hotplug or a change of the cgroup cpuset, the threads keep
+ * their CPUs as far as possible, the others are re-pinned or parked.
  */
 
 #ifndef MALEABLE_SCHEDULER_H
@@ -7,29 +33,89 @@
 
 #include <vector>
 #include <list>
+#include <map>
+#include <cmath>
+#include <iostream>
+#include <time.h>
 #include <algorithm>
 #include <boost/thread.hpp>
 #include <pthread.h>
 #include <sched.h>
 #include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/inotify.h>
 #include "workqueue.h"
+#include "numa.h"
+#include "corecontrol.h"
+#include "contention.h"
+#include "cpuset.h"
 
 #define SIGBLOCKCORE SIGRTMIN+1
 #define SIGUNBLOCKCORE SIGRTMIN+2
 #define SIGSTOPSIGNALTHREAD SIGRTMIN+3
 
+// the period of the rebalancing while jobs compete for the cores, in microseconds
+#define SCHEDULER_REBALANCE_PERIOD 1000
+
 
 namespace Scheduler {
 
+/*
+ * The priority classes of jobs, a job of a higher class takes the cores of
+ * the jobs of lower classes.
+ */
+enum Priority {
+	PRIORITY_BACKGROUND = 0,
+	PRIORITY_NORMAL = 1,
+	PRIORITY_HIGH = 2
+};
+
 class MaleableScheduler {
 	private:
-		// the current jobs
+		/*
+		 * The attributes of a job for fair share.
+		 */
+		struct JobInfo {
+			unsigned int weight;
+			int priority;
+			// the deadline in seconds of the monotonic clock, 0 for none
+			double deadline;
+			// the core seconds the job had and the pakets it completed since
+			// the deadline was set, for its cost per paket
+			double core_seconds;
+			long completed;
+			// the time of the last update of core_seconds
+			double updated;
+		};
+		
+		// the current jobs and their attributes for fair share
 		std::list<WorkQueue*> jobs;
+		std::map<WorkQueue*, JobInfo> job_info;
+		// protects the jobs and the changes of the schedule by fair share
+		boost::mutex jobs_mutex;
+		// whether the cores are split among the jobs by their weights
+		volatile bool fair_share;
+		
+		// the thread rebalancing when a job gets pakets or is done and
+		// periodically while jobs compete
+		boost::thread* rebalancer;
+		boost::mutex rebalance_mutex;
+		boost::condition_variable rebalance_cd;
+		bool rebalance_requested;
+		bool rebalance_stop;
 		
 		// the current "hard" schedule, this is the schedule for the pinned threads
 		// if a core is disabled, the "hard" schedule is NULL for that thread
 		std::vector<WorkQueue*> schedule;
 		
+		// the job each thread is taking a paket from, protected by its mutex,
+		// and whether deleteJob() waits for a thread to leave its job
+		std::vector<WorkQueue*> working;
+		volatile bool deleting;
+		
 		// each thread needs a condition variable and a mutex
 		std::vector<boost::thread*> threads;
 		std::vector<boost::condition_variable*> thread_cd;
@@ -39,6 +125,9 @@ class MaleableScheduler {
 		// started and scheduled
 		int p;
 		
+		// the NUMA node of each thread, -1 for all if there is only one node
+		std::vector<int> thread_node;
+		
 		// the number of sleeping threads
 		int sleeping;
 		
@@ -61,15 +150,56 @@ class MaleableScheduler {
 		// this is also used by the scheduler, and the p threads to decide wether 
 		// they are working on their schedule or going to sleep (when their core gets disabled)
 		volatile bool * availableCores; 
+		// serializes the updates of the available cores
+		boost::mutex cores_mutex;
+		
+		// the thread receiving control messages, its socket, the eventfd
+		// stopping it and the path of the socket
+		boost::thread* controlThread;
+		int control_socket;
+		int control_stop;
+		std::string control_path;
+		
+		// the thread monitoring the contention of the cores, its period in
+		// milliseconds, the contended cores and the cores it blocked
+		boost::thread* monitor;
+		boost::mutex monitor_mutex;
+		boost::condition_variable monitor_cd;
+		bool monitor_stop;
+		int monitor_period;
+		std::vector<char> monitor_contended;
+		std::vector<bool> monitor_blocked;
+		
+		// the kernel thread id of each thread, for its schedstat
+		std::vector<pid_t> thread_tid;
+		
+		// the CPU of each thread, -1 if it is parked
+		std::vector<int> thread_cpu;
+		// the availability of the cores without the parking
+		std::vector<bool> requested;
+		// the cpuset file of the cgroup, and the CPUs of the affinity of the
+		// thread creating the scheduler if that is narrower than the allowed ones
+		std::string cgroup_cpuset;
+		std::vector<int> cpu_restriction;
+		// the thread watching the allowed CPUs, its inotify fd and the
+		// eventfd stopping it
+		boost::thread* cpusetThread;
+		int cpuset_notify;
+		int cpuset_stop;
 		
 		// Singleton: this holds the only Reference to the only object of this class
 		static MaleableScheduler * instance;
 		
-		void pin_to_core(int cpuid) {
+		/*
+		 * Pins the thread tid, by default the calling one, to the CPU, unless
+		 * it is -1.
+		 */
+		void pin_to_core(int cpuid, pid_t tid = 0) {
+			if (cpuid < 0) return;
 			cpu_set_t set;
 			CPU_ZERO(&set);
 			CPU_SET(cpuid,&set);
-			sched_setaffinity(0,sizeof(cpu_set_t),&set);
+			sched_setaffinity(tid,sizeof(cpu_set_t),&set);
 		}
 		
 		void block_all_signals() {
@@ -81,11 +211,15 @@ class MaleableScheduler {
 		
 		struct ThreadWork {
 			void operator()(MaleableScheduler* scheduler, int coreid) {
-				scheduler->pin_to_core(coreid);
+				scheduler->pin_to_core(scheduler->thread_cpu[coreid]);
 				scheduler->block_all_signals();
+				scheduler->thread_tid[coreid] = syscall(SYS_gettid);
 				while(true) {
 					boost::unique_lock<boost::mutex> lock(*(scheduler->thread_mutex[coreid]),boost::defer_lock_t());
 					lock.lock();
+					// the thread left the job of its last paket
+					scheduler->working[coreid] = NULL;
+					if (scheduler->deleting) scheduler->thread_cd[coreid]->notify_all();
 					// wait until this thread is scheduled to a job
 					while (scheduler->schedule[coreid] == NULL || scheduler->availableCores[coreid] == false) {
 						boost::unique_lock<boost::mutex> l(scheduler->sleeping_mutex);
@@ -96,16 +230,19 @@ class MaleableScheduler {
 						l.lock();
 						scheduler->sleeping--;
 						if (scheduler->destruct) return;
+						// pinned again after sleeping, but not before every paket,
+						// the system calls would cost more than a short paket
+						scheduler->pin_to_core(scheduler->thread_cpu[coreid]);
+						scheduler->block_all_signals();
 					}
 					
-					scheduler->pin_to_core(coreid);
-					scheduler->block_all_signals();
-					
 					// do one paket of work
 					WorkQueue* queue = scheduler->schedule[coreid];
+					scheduler->working[coreid] = queue;
 					lock.unlock();
 					
-					queue->wait_and_workOne();
+					// the core is the index of the thread's deque in the queue
+					queue->wait_and_workOne(scheduler->thread_node[coreid], coreid);
 
 					// TODO maybe reschedule
 				}
@@ -117,6 +254,8 @@ class MaleableScheduler {
 		void scheduleOnCore(WorkQueue* job, int core) {
 			boost::unique_lock<boost::mutex> lock(*thread_mutex[core]);
 			bool notify = schedule[core] == NULL;
+			// a thread sleeping in the queue of its old job returns to take the new one
+			if (schedule[core] != NULL && schedule[core] != job) schedule[core]->wakeWorkers();
 			schedule[core] = job;
 			if (notify) {
 				thread_cd[core]->notify_all();
@@ -185,34 +324,224 @@ class MaleableScheduler {
 				
 				// enable/disable cores when this signal arrives
 				if (sched->receivedSignal) {
+					boost::unique_lock<boost::mutex> lock(sched->cores_mutex);
 					sched->receivedSignal = false;
-					
-					// set new schedule
+					std::vector<bool> cores(sched->p);
+					for (int i = 0; i < sched->p; i++) {
+						cores[i] = sched->new_availableCores[i];
+					}
+					sched->applyAvailableCores(cores);
+				}
+			}
+		}
+		
+		
+		/*
+		 * Blocks and unblocks the cores to match the given availability and
+		 * the parked threads, then rebalances once. The signals of the
+		 * changed cores that are not yet handled are overridden. cores_mutex
+		 * has to be locked.
+		 */
+		void applyAvailableCores(const std::vector<bool>& requested_cores) {
+			std::vector<bool> cores(p);
+			for (int i = 0; i < p; i++) {
+				if (requested[i] != requested_cores[i]) new_availableCores[i] = requested_cores[i];
+				requested[i] = requested_cores[i];
+				cores[i] = requested[i] && thread_cpu[i] >= 0;
+			}
+			for (int i = 0; i < p; i++) {
+				if (availableCores[i] == false && cores[i]) {
+					// core i is unblocked:
+					// the lock is necessary here, otherwise (scenario):
+					// -> Pinned Thread checks available Cores, it is not available
+					// -> Pinned Thread prepares to go to sleep
+					// -> The updating thread (here) sets availableCores[i] to true and
+					//    notifies the (not yet sleeping thread)
+					// -> the notify does not reach the pinned thread, because it is not
+					//    yet sleeping
+					// -> the pinned thread goes to sleep, the notify never reaches it, so
+					//    it does not wake up (i.e. might sleep forever)
+					boost::unique_lock<boost::mutex> lock(*(thread_mutex[i]));
+					availableCores[i] = true;
+					// notify thread that it can continue work
+					thread_cd[i]->notify_all();
+				} else if (availableCores[i] == true && !cores[i]) {
+					// the core i is blocked: its thread finishes the current paket,
+					// giving away parts of it if it is splittable, or is woken if
+					// it sleeps in the queue, and then waits here
+					boost::unique_lock<boost::mutex> lock(*(thread_mutex[i]));
+					availableCores[i] = false;
+					if (schedule[i] != NULL) {
+						schedule[i]->yieldWorker(i);
+						schedule[i]->wakeWorkers();
+					}
+				}
+			}
+			rebalance();
+		}
+		
+		/*
+		 * Function for the thread receiving the control messages, until the
+		 * eventfd is written.
+		 */
+		static void controlthreadfunction(MaleableScheduler* sched) {
+			sched->block_all_signals();
+			struct pollfd fds[2];
+			fds[0].fd = sched->control_socket;
+			fds[0].events = POLLIN;
+			fds[1].fd = sched->control_stop;
+			fds[1].events = POLLIN;
+			char buffer[CORE_CONTROL_MAX_MESSAGE];
+			while (true) {
+				if (poll(fds, 2, -1) < 0) continue;
+				if (fds[1].revents != 0) return;
+				if (fds[0].revents == 0) continue;
+				ssize_t length = recv(sched->control_socket, buffer, sizeof(buffer), 0);
+				if (length <= 0) continue;
+				boost::unique_lock<boost::mutex> lock(sched->cores_mutex);
+				std::vector<bool> cores(sched->requested);
+				if (CoreControl::apply(std::string(buffer, length), cores)) {
+					sched->applyAvailableCores(cores);
+				}
+			}
+		}
+		
+		/*
+		 * Function for the thread monitoring the contention of the cores,
+		 * samples the load of each core every period until it is stopped.
+		 */
+		static void monitorfunction(MaleableScheduler* sched) {
+			sched->block_all_signals();
+			std::vector<Contention::Detector> detector(sched->p);
+			std::vector<double> busy, last_busy, run(sched->p), last_run(sched->p), wait(sched->p), last_wait(sched->p);
+			double last_time = seconds_now();
+			bool ok = Contention::read_cpu_busy(last_busy);
+			for (int i = 0; ok && i < sched->p; i++) {
+				ok = Contention::read_schedstat(sched->thread_tid[i], last_run[i], last_wait[i]);
+			}
+			if (!ok) {
+				std::cerr << "MaleableScheduler: no /proc/stat or schedstat, the contention monitor stops" << std::endl;
+				return;
+			}
+			boost::unique_lock<boost::mutex> l(sched->monitor_mutex);
+			while (!sched->monitor_stop) {
+				sched->monitor_cd.timed_wait(l, boost::posix_time::milliseconds(sched->monitor_period));
+				if (sched->monitor_stop) break;
+				double time = seconds_now();
+				double period = time - last_time;
+				Contention::read_cpu_busy(busy);
+				for (int i = 0; i < sched->p; i++) {
+					Contention::read_schedstat(sched->thread_tid[i], run[i], wait[i]);
+					// the load of the CPU the thread is pinned to, none if it is parked
+					std::size_t cpu = sched->thread_cpu[i];
+					double foreign = 0;
+					if (cpu < busy.size() && cpu < last_busy.size()) {
+						foreign = (busy[cpu] - last_busy[cpu]) - (run[i] - last_run[i]);
+					}
+					sched->monitor_contended[i] = detector[i].sample(std::max(wait[i] - last_wait[i], foreign) / period);
+				}
+				last_time = time;
+				last_busy.swap(busy);
+				last_run.swap(run);
+				last_wait.swap(wait);
+				l.unlock();
+				{
+					boost::unique_lock<boost::mutex> lock(sched->cores_mutex);
+					std::vector<bool> cores(sched->requested);
+					int available = 0;
+					for (int i = 0; i < sched->p; i++) {
+						if (sched->availableCores[i]) available++;
+					}
+					// only the cores the monitor blocked are unblocked, and the
+					// last available core is kept, a contended core is better
+					// than none
+					bool changed = false;
 					for (int i = 0; i < sched->p; i++) {
-						if (sched->availableCores[i] == false && sched->new_availableCores[i] == true) {
-							// core i is unblocked:
-							// the lock is necessary here, otherwise (scenario):
-							// -> Pinned Thread checks available Cores, it is not available
-							// -> Pinned Thread prepares to go to sleep
-							// -> Signal hander thread (here) sets availableCores[i] to true and
-							//    notifies the (not yet sleeping thread)
-							// -> the notify does not reach the pinned thread, because it is not
-							//    yet sleeping
-							// -> the pinned thread goes to sleep, the notify never reaches it, so
-							//    it does not wake up (i.e. might sleep forever)
-							boost::unique_lock<boost::mutex> lock(*(sched->thread_mutex[i]));
-							sched->availableCores[i] = true;
-							// notify thread that it can continue work
-							sched->thread_cd[i]->notify_all();
-						} else if (sched->availableCores[i] == true && sched->new_availableCores[i] == false) {
-							// the core i is blocked
-							sched->availableCores[i] = false;
+						if (sched->monitor_contended[i] && !sched->monitor_blocked[i] && sched->availableCores[i] && available > 1) {
+							cores[i] = false;
+							sched->monitor_blocked[i] = true;
+							available--;
+							changed = true;
+						} else if (!sched->monitor_contended[i] && sched->monitor_blocked[i]) {
+							cores[i] = true;
+							sched->monitor_blocked[i] = false;
+							changed = true;
 						}
 					}
+					if (changed) sched->applyAvailableCores(cores);
 				}
+				l.lock();
 			}
 		}
 		
+		/*
+		 * Re-pins and parks the threads for the allowed CPUs, and rebalances
+		 * if a thread is parked or unparked. cores_mutex has to be locked.
+		 */
+		void updateCpusLocked() {
+			std::vector<int> cpus = Cpuset::allowed(cgroup_cpuset, cpu_restriction);
+			// no CPU at all is a transient state, the threads stay
+			if (cpus.empty()) return;
+			std::vector<int> assigned = Cpuset::assign(thread_cpu, cpus);
+			if (assigned == thread_cpu) return;
+			for (int i = 0; i < p; i++) {
+				if (assigned[i] == thread_cpu[i]) continue;
+				{
+					boost::unique_lock<boost::mutex> lock(*thread_mutex[i]);
+					thread_cpu[i] = assigned[i];
+					if (Numa::num_nodes() > 1 && assigned[i] >= 0) thread_node[i] = Numa::node_of_cpu(assigned[i]);
+				}
+				// a running thread moves at once, a sleeping one is pinned
+				// again when it wakes up
+				pin_to_core(assigned[i], thread_tid[i]);
+			}
+			applyAvailableCores(requested);
+		}
+		
+		/*
+		 * Function for the thread watching the allowed CPUs, until the
+		 * eventfd is written. The files are watched with inotify, and read
+		 * every CPUSET_POLL_PERIOD milliseconds for the changes without
+		 * notification.
+		 */
+		static void cpusetthreadfunction(MaleableScheduler* sched) {
+			sched->block_all_signals();
+			struct pollfd fds[2];
+			fds[0].fd = sched->cpuset_stop;
+			fds[0].events = POLLIN;
+			fds[1].fd = sched->cpuset_notify;
+			fds[1].events = POLLIN;
+			int nfds = (sched->cpuset_notify >= 0) ? 2 : 1;
+			char buffer[4096];
+			while (true) {
+				int ready = poll(fds, nfds, CPUSET_POLL_PERIOD);
+				if (ready > 0 && fds[0].revents != 0) return;
+				// drains the notifications
+				if (ready > 0 && nfds == 2 && fds[1].revents != 0) {
+					while (read(sched->cpuset_notify, buffer, sizeof(buffer)) > 0) {
+					}
+				}
+				boost::unique_lock<boost::mutex> lock(sched->cores_mutex);
+				sched->updateCpusLocked();
+			}
+		}
+		
+		/*
+		 * Starts the thread watching the allowed CPUs, with inotify if the
+		 * kernel has it.
+		 */
+		void startCpusetThread() {
+			cpusetThread = NULL;
+			cpuset_stop = eventfd(0, EFD_CLOEXEC);
+			cpuset_notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (cpuset_notify >= 0) {
+				inotify_add_watch(cpuset_notify, CPUSET_ONLINE_FILE, IN_MODIFY);
+				if (!cgroup_cpuset.empty()) inotify_add_watch(cpuset_notify, cgroup_cpuset.c_str(), IN_MODIFY);
+			}
+			if (cpuset_stop >= 0) {
+				cpusetThread = new boost::thread(&MaleableScheduler::cpusetthreadfunction, this);
+			}
+		}
 		
 		void init(int num_threads) {
 			// block signals for signal thread in main thread
@@ -226,15 +555,37 @@ class MaleableScheduler {
 		
 			p = num_threads;
 			
+			fair_share = false;
+			deleting = false;
+			rebalance_requested = false;
+			rebalance_stop = false;
+			
 			// init variables for signal handling/core blocking
 			receivedSignal = false;
 			receivedStopSignal = false;
 			new_availableCores = new volatile bool[p];
 			availableCores = new volatile bool[p];
+			// the CPUs of the threads, the affinity of the calling thread
+			// restricts them only if it is narrower than the allowed CPUs
+			cgroup_cpuset = Cpuset::cgroup_file();
+			std::vector<int> affinity = Cpuset::affinity();
+			if (Cpuset::allowed(cgroup_cpuset, affinity) != Cpuset::allowed(cgroup_cpuset, std::vector<int>())) {
+				cpu_restriction = affinity;
+			}
+			thread_cpu = Cpuset::assign(std::vector<int>(p, -1), Cpuset::allowed(cgroup_cpuset, cpu_restriction));
+			requested = std::vector<bool>(p, true);
 			for (int i = 0; i < p; i++) {
-				availableCores[i] = true;
+				availableCores[i] = thread_cpu[i] >= 0;
 				new_availableCores[i] = true;
 			}
+			controlThread = NULL;
+			control_socket = -1;
+			control_stop = -1;
+			monitor = NULL;
+			monitor_stop = false;
+			monitor_period = CONTENTION_MONITOR_PERIOD;
+			monitor_contended = std::vector<char>(p, false);
+			monitor_blocked = std::vector<bool>(p, false);
 			// start signal thread
 			signalThread = new boost::thread(&MaleableScheduler::signalthreadfunction,this);
 			
@@ -243,6 +594,14 @@ class MaleableScheduler {
 			sleeping = 0;
 			threads = std::vector<boost::thread*>(p,NULL);
 			schedule = std::vector<WorkQueue*>(p,NULL);
+			working = std::vector<WorkQueue*>(p,NULL);
+			thread_tid = std::vector<pid_t>(p,0);
+			thread_node = std::vector<int>(p,-1);
+			if (Numa::num_nodes() > 1) {
+				for (int i = 0; i < p; i++) {
+					if (thread_cpu[i] >= 0) thread_node[i] = Numa::node_of_cpu(thread_cpu[i]);
+				}
+			}
 			thread_cd = std::vector<boost::condition_variable*>(p,NULL);
 			thread_mutex = std::vector<boost::mutex*>(p,NULL);
 			// init and start work-threads
@@ -251,6 +610,7 @@ class MaleableScheduler {
 				thread_cd[i] = new boost::condition_variable();
 				threads[i] = new boost::thread(threadWork,this,i);
 			}
+			rebalancer = new boost::thread(&MaleableScheduler::rebalancerfunction,this);
 			
 			// wait until all threads are ready
 			{
@@ -259,22 +619,48 @@ class MaleableScheduler {
 					sleeping_cd.wait(l);
 				}
 			}
+			// the thread ids are known now
+			startCpusetThread();
 		}
 		
 		/* 
 		 * Creates the Scheduler with as many Threads as there are
-		 * Hardware-Threads in the System.
+		 * Hardware-Threads in the System, including the offline ones, which
+		 * are parked until their CPUs come online.
 		 */
 		MaleableScheduler() {
-			int hwthreads = boost::thread::hardware_concurrency();
+			int hwthreads = std::max<long>(boost::thread::hardware_concurrency(), sysconf(_SC_NPROCESSORS_CONF));
 			init(hwthreads);
 		}
 		
 		~MaleableScheduler() {
+			stopContentionMonitor();
+			stopControlSocket();
+			
+			// quit the thread watching the CPUs
+			if (cpusetThread != NULL) {
+				uint64_t one = 1;
+				if (write(cpuset_stop, &one, sizeof(one)) == sizeof(one)) {
+					cpusetThread->join();
+				}
+				delete cpusetThread;
+			}
+			if (cpuset_notify >= 0) close(cpuset_notify);
+			if (cpuset_stop >= 0) close(cpuset_stop);
+			
 			// quit signal thread
 			pthread_kill(signalThread->native_handle(), SIGSTOPSIGNALTHREAD);
 			signalThread->join();
 			//std::cout << "Signal-Thread joined " << std::endl;
+			
+			// quit the rebalancer
+			{
+				boost::unique_lock<boost::mutex> l(rebalance_mutex);
+				rebalance_stop = true;
+				rebalance_cd.notify_all();
+			}
+			rebalancer->join();
+			delete rebalancer;
 		
 			// clear schedule
 			for (std::vector<WorkQueue*>::iterator it = schedule.begin(); it != schedule.end(); ++it) {
@@ -326,6 +712,200 @@ class MaleableScheduler {
 		
 		}
 		
+		static double seconds_now() {
+			struct timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec + ts.tv_nsec * 1e-9;
+		}
+		
+		/*
+		 * Returns the number of cores the job with a deadline needs to finish
+		 * its pending pakets in time, at its cost per paket since the
+		 * deadline was set. Until a paket is done, or if the deadline has
+		 * passed, it needs a core for each pending paket.
+		 */
+		int neededCores(WorkQueue* job, const JobInfo& info, double now) {
+			long pending = job->pendingJobs();
+			if (pending == 0) return 0;
+			long done = job->completedJobs() - info.completed;
+			double left = info.deadline - now;
+			if (done <= 0 || left <= 0) return std::min<long>(pending, p);
+			double needed = pending * (info.core_seconds / done) / left;
+			return std::max(1, static_cast<int>(std::min<double>(std::ceil(needed), std::min<long>(pending, p))));
+		}
+		
+		/*
+		 * Returns the number of cores of each of the jobs js: first the cores
+		 * the jobs with deadlines need, earliest deadline first, then the
+		 * classes from the highest priority by the weights, at most a core
+		 * per pending paket, then the rest by the weights of the jobs with
+		 * pending pakets, or of all jobs if none has.
+		 */
+		std::vector<int> jobShares(const std::vector<WorkQueue*>& js, int available, double now) {
+			std::size_t n = js.size();
+			std::vector<int> shares(n, 0);
+			std::vector<long> pending(n);
+			std::vector<JobInfo*> info(n);
+			bool any_pending = false;
+			for (std::size_t j = 0; j < n; j++) {
+				pending[j] = js[j]->pendingJobs();
+				info[j] = &job_info[js[j]];
+				if (pending[j] > 0) any_pending = true;
+			}
+			int left = available;
+			// the jobs with deadlines
+			std::vector<std::pair<double, std::size_t> > deadlines;
+			for (std::size_t j = 0; j < n; j++) {
+				if (info[j]->deadline > 0 && pending[j] > 0) deadlines.push_back(std::make_pair(info[j]->deadline, j));
+			}
+			std::sort(deadlines.begin(), deadlines.end());
+			for (std::size_t d = 0; d < deadlines.size() && left > 0; d++) {
+				std::size_t j = deadlines[d].second;
+				shares[j] = std::min(left, neededCores(js[j], *info[j], now));
+				left -= shares[j];
+			}
+			// the priority classes, from the highest
+			std::vector<int> classes;
+			for (std::size_t j = 0; j < n; j++) {
+				if (info[j]->deadline <= 0 && pending[j] > 0) classes.push_back(info[j]->priority);
+			}
+			std::sort(classes.begin(), classes.end());
+			classes.erase(std::unique(classes.begin(), classes.end()), classes.end());
+			for (int c = static_cast<int>(classes.size()) - 1; c >= 0 && left > 0; c--) {
+				std::vector<std::size_t> members;
+				std::vector<unsigned int> w;
+				for (std::size_t j = 0; j < n; j++) {
+					if (info[j]->deadline <= 0 && pending[j] > 0 && info[j]->priority == classes[c]) {
+						members.push_back(j);
+						w.push_back(info[j]->weight);
+					}
+				}
+				std::vector<int> class_shares = fairShares(w, left);
+				for (std::size_t m = 0; m < members.size(); m++) {
+					int s = std::min<long>(class_shares[m], pending[members[m]]);
+					shares[members[m]] += s;
+					left -= s;
+				}
+			}
+			// the cores nobody can use
+			if (left > 0) {
+				std::vector<std::size_t> members;
+				std::vector<unsigned int> w;
+				for (std::size_t j = 0; j < n; j++) {
+					if (pending[j] > 0 || !any_pending) {
+						members.push_back(j);
+						w.push_back(info[j]->weight);
+					}
+				}
+				std::vector<int> rest = fairShares(w, left);
+				for (std::size_t m = 0; m < members.size(); m++) {
+					shares[members[m]] += rest[m];
+				}
+			}
+			return shares;
+		}
+		
+		/*
+		 * Splits the cores among the jobs of the current schedule, keeping the
+		 * cores a job already has as far as its share allows. jobs_mutex has
+		 * to be locked. Returns true if the jobs compete for the cores, i.e.
+		 * if there is a job with a deadline or more than one job with
+		 * pending pakets.
+		 */
+		bool rebalanceLocked() {
+			if (!fair_share) return false;
+			double now = seconds_now();
+			std::vector<WorkQueue*> js(jobs.begin(), jobs.end());
+			int competing = 0;
+			bool deadline = false;
+			for (std::size_t j = 0; j < js.size(); j++) {
+				JobInfo& info = job_info[js[j]];
+				info.core_seconds += coresOfJob(js[j]) * (now - info.updated);
+				info.updated = now;
+				if (js[j]->pendingJobs() > 0) {
+					competing++;
+					if (info.deadline > 0) deadline = true;
+				}
+			}
+			int available = 0;
+			for (int i = 0; i < p; i++) {
+				if (availableCores[i]) available++;
+			}
+			std::vector<int> left = jobShares(js, available, now);
+			std::vector<WorkQueue*> target(p, static_cast<WorkQueue*>(NULL));
+			// the cores a job keeps
+			for (int i = 0; i < p; i++) {
+				if (!availableCores[i] || schedule[i] == NULL) continue;
+				std::size_t j = std::find(js.begin(), js.end(), schedule[i]) - js.begin();
+				if (j < js.size() && left[j] > 0) {
+					target[i] = js[j];
+					left[j]--;
+				}
+			}
+			// the cores that change their job
+			std::size_t j = 0;
+			for (int i = 0; i < p; i++) {
+				if (!availableCores[i] || target[i] != NULL) continue;
+				while (j < js.size() && left[j] == 0) j++;
+				if (j == js.size()) break;
+				target[i] = js[j];
+				left[j]--;
+			}
+			for (int i = 0; i < p; i++) {
+				if (target[i] != schedule[i]) scheduleOnCore(target[i], i);
+			}
+			return deadline || competing > 1;
+		}
+		
+		/*
+		 * Called by a job when it gets its first pending paket and when its
+		 * last one is done.
+		 */
+		static void jobActivity(void* scheduler) {
+			static_cast<MaleableScheduler*>(scheduler)->requestRebalance();
+		}
+		
+		/*
+		 * Function for the rebalancer thread.
+		 */
+		static void rebalancerfunction(MaleableScheduler* sched) {
+			sched->block_all_signals();
+			bool periodic = false;
+			boost::unique_lock<boost::mutex> l(sched->rebalance_mutex);
+			while (!sched->rebalance_stop) {
+				if (!sched->rebalance_requested) {
+					if (periodic) {
+						sched->rebalance_cd.timed_wait(l, boost::posix_time::microseconds(SCHEDULER_REBALANCE_PERIOD));
+					} else {
+						sched->rebalance_cd.wait(l);
+					}
+					if (sched->rebalance_stop) break;
+				}
+				sched->rebalance_requested = false;
+				l.unlock();
+				{
+					boost::unique_lock<boost::mutex> lock(sched->jobs_mutex);
+					periodic = sched->rebalanceLocked();
+				}
+				l.lock();
+			}
+		}
+		
+		/*
+		 * Adds the job with the attributes, jobs_mutex has to be locked.
+		 */
+		void addJob(WorkQueue* job, unsigned int weight, int priority) {
+			JobInfo info;
+			info.weight = std::max(weight, 1u);
+			info.priority = priority;
+			info.deadline = 0;
+			info.core_seconds = 0;
+			info.completed = 0;
+			info.updated = seconds_now();
+			jobs.push_back(job);
+			job_info[job] = info;
+		}
+		
 	public:		
 		/*
 		 * This implements the Singleton Pattern, and returns the only Reference 
@@ -350,43 +930,360 @@ class MaleableScheduler {
 		}
 	
 		/* 
-		 * Creates a new Queue and adds it as new Job to the Job list. Then returns the 
-		 * new WorkQueue for the procedure generating Workpakets.
+		 * Creates a new Queue and adds it as new Job with the given weight and
+		 * priority class to the Job list. Then returns the new WorkQueue for the
+		 * procedure generating Workpakets. With fair share the Job gets its
+		 * share of the cores.
 		 */
-		WorkQueue* newJob() {
-			WorkQueue* newjob = new WorkQueue();
-			jobs.push_back(newjob);
-			// TODO: schedule?
+		WorkQueue* newJob(unsigned int weight = 1, int priority = PRIORITY_NORMAL) {
+			WorkQueue* newjob = new WorkQueue(p);
+			newjob->setActivityListener(&MaleableScheduler::jobActivity, this);
+			boost::unique_lock<boost::mutex> lock(jobs_mutex);
+			addJob(newjob, weight, priority);
+			rebalanceLocked();
 			return newjob;
 		}
 		
 		/*
 		 * Tells the Scheduler, that the Job represented by the given Queue is done,
 		 * and the Queue can be destructed, and the Threads working on that Queue be
-		 * rescheduled.
+		 * rescheduled. The Job should have no pending pakets, and no other thread may
+		 * wait for it or push into it. Waits until the Threads of the cores have left
+		 * the Queue before it is destructed.
 		 */
-		 // TODO this function is not yet safe
 		void deleteJob(WorkQueue* jobQueue) {
+			boost::unique_lock<boost::mutex> lock(jobs_mutex);
 			// delete job from list
 			std::list<WorkQueue*>::iterator pos = std::find(jobs.begin(),jobs.end(),jobQueue);
-			if (pos != jobs.end()) {
-				jobs.erase(pos);
+			if (pos == jobs.end()) return;
+			jobs.erase(pos);
+			job_info.erase(jobQueue);
+			// take the cores from the job, then release the threads that are
+			// still waiting on that Queue
+			for (int i = 0; i < p; i++) {
+				if (schedule[i] == jobQueue) scheduleOnCore(NULL, i);
 			}
-			// set the schedule for all threads that worked on that job to NULL
-			for (std::vector<WorkQueue*>::iterator it = schedule.begin(); it != schedule.end(); ++it) {
-				if (*it == jobQueue) {
-					*it = NULL;
+			deleting = true;
+			jobQueue->releaseWaitingThreads();
+			// a thread may have taken the job from the schedule before, and
+			// not yet entered the Queue
+			for (int i = 0; i < p; i++) {
+				boost::unique_lock<boost::mutex> l(*thread_mutex[i]);
+				while (working[i] == jobQueue) {
+					thread_cd[i]->wait(l);
 				}
 			}
-			// destruct the Queue, releasing all threads that are still waiting on that Queue.
-			// TODO destructing queue before all threads are sleeping in Scheduler is potentially
-			// 		dangerous.
-			std::cout << "Attention: using deleteJob() is not safe!" << std::endl;
+			deleting = false;
 			delete jobQueue;
-			jobQueue = NULL;
-			
+			rebalanceLocked();
+		}
+		
+		/*
+		 * Enables or disables fair share. Enabling it rebalances the cores at
+		 * once, later calls of scheduleJob(), scheduleToFirst() or
+		 * scheduleToAll() only last until the next rebalancing.
+		 */
+		void setFairShare(bool enabled) {
+			{
+				boost::unique_lock<boost::mutex> lock(jobs_mutex);
+				fair_share = enabled;
+				rebalanceLocked();
+			}
+			requestRebalance();
+		}
+		
+		bool fairShare() const {
+			return fair_share;
+		}
+		
+		/*
+		 * Sets the weight of the Job for fair share, at least 1.
+		 */
+		void setJobWeight(WorkQueue* job, unsigned int weight) {
+			boost::unique_lock<boost::mutex> lock(jobs_mutex);
+			if (job_info.find(job) == job_info.end()) return;
+			job_info[job].weight = std::max(weight, 1u);
+			rebalanceLocked();
+		}
+		
+		/*
+		 * Sets the priority class of the Job for fair share, see Priority.
+		 */
+		void setJobPriority(WorkQueue* job, int priority) {
+			boost::unique_lock<boost::mutex> lock(jobs_mutex);
+			if (job_info.find(job) == job_info.end()) return;
+			job_info[job].priority = priority;
+			rebalanceLocked();
+		}
+		
+		/*
+		 * Sets the deadline of the Job for fair share to the given number of
+		 * seconds from now, 0 removes it. Until then, the Job gets the cores
+		 * it needs for its pending pakets before any Job without a deadline,
+		 * at the cost per paket it has from now on.
+		 */
+		void setJobDeadline(WorkQueue* job, double seconds) {
+			boost::unique_lock<boost::mutex> lock(jobs_mutex);
+			if (job_info.find(job) == job_info.end()) return;
+			JobInfo& info = job_info[job];
+			info.deadline = (seconds > 0) ? seconds_now() + seconds : 0;
+			info.core_seconds = 0;
+			info.completed = job->completedJobs();
+			info.updated = seconds_now();
+			rebalanceLocked();
+		}
+		
+		/*
+		 * Asks the rebalancer thread to rebalance the cores, without waiting
+		 * for it.
+		 */
+		void requestRebalance() {
+			if (!fair_share) return;
+			boost::unique_lock<boost::mutex> l(rebalance_mutex);
+			rebalance_requested = true;
+			rebalance_cd.notify_all();
+		}
+		
+		/*
+		 * Sets which cores are available, core i is available if cores[i] is
+		 * true, cores beyond the vector keep their state. The threads of the
+		 * cores that become blocked finish or split their current pakets,
+		 * then the cores are rebalanced once.
+		 */
+		void setAvailableCores(const std::vector<bool>& cores) {
+			boost::unique_lock<boost::mutex> lock(cores_mutex);
+			std::vector<bool> available(p);
+			for (int i = 0; i < p; i++) {
+				available[i] = (static_cast<std::size_t>(i) < cores.size()) ? cores[i] : requested[i];
+			}
+			applyAvailableCores(available);
+		}
+		
+		/*
+		 * Sets which cores are available by a bitmask, bit i for core i. The
+		 * cores from 64 on keep their state.
+		 */
+		void setAvailableCores(unsigned long long mask) {
+			std::vector<bool> cores(std::min(p, 64));
+			for (std::size_t i = 0; i < cores.size(); i++) {
+				cores[i] = (mask >> i) & 1;
+			}
+			setAvailableCores(cores);
+		}
+		
+		/*
+		 * Returns whether the core is available, i.e. neither blocked nor
+		 * parked.
+		 */
+		bool coreAvailable(int core) const {
+			return availableCores[core];
+		}
+		
+		/*
+		 * Starts the thread receiving the control messages of corecontrol.h on
+		 * a Unix domain socket at the given path, by default the one of
+		 * CORE_CONTROL_SOCKET with the pid of the process. An existing file
+		 * at the path is replaced. Returns false if the socket could not be
+		 * created.
+		 */
+		bool startControlSocket(const std::string& path = std::string()) {
+			if (controlThread != NULL) return true;
+			control_path = path.empty() ? CoreControl::socket_path(getpid()) : path;
+			struct sockaddr_un address;
+			if (!CoreControl::socket_address(control_path, address)) return false;
+			control_socket = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+			if (control_socket < 0) return false;
+			unlink(control_path.c_str());
+			control_stop = eventfd(0, EFD_CLOEXEC);
+			if (control_stop < 0 || bind(control_socket, (struct sockaddr*)&address, sizeof(address)) != 0) {
+				close(control_socket);
+				if (control_stop >= 0) close(control_stop);
+				control_socket = -1;
+				control_stop = -1;
+				return false;
+			}
+			controlThread = new boost::thread(&MaleableScheduler::controlthreadfunction, this);
+			return true;
+		}
+		
+		/*
+		 * Stops the thread receiving the control messages and removes its
+		 * socket.
+		 */
+		void stopControlSocket() {
+			if (controlThread == NULL) return;
+			uint64_t one = 1;
+			if (write(control_stop, &one, sizeof(one)) != sizeof(one)) return;
+			controlThread->join();
+			delete controlThread;
+			controlThread = NULL;
+			close(control_socket);
+			close(control_stop);
+			unlink(control_path.c_str());
+			control_socket = -1;
+			control_stop = -1;
+		}
+		
+		/*
+		 * Starts the thread monitoring the contention of the cores, which
+		 * samples the load of each core every period milliseconds. A core
+		 * other processes contend for is blocked, and unblocked again when
+		 * their load is gone. Returns false if it already runs.
+		 */
+		bool startContentionMonitor(int period = CONTENTION_MONITOR_PERIOD) {
+			boost::unique_lock<boost::mutex> l(monitor_mutex);
+			if (monitor != NULL) return false;
+			monitor_stop = false;
+			monitor_period = std::max(period, 1);
+			monitor = new boost::thread(&MaleableScheduler::monitorfunction, this);
+			return true;
+		}
+		
+		/*
+		 * Stops the contention monitor, the cores it blocked are unblocked.
+		 */
+		void stopContentionMonitor() {
+			{
+				boost::unique_lock<boost::mutex> l(monitor_mutex);
+				if (monitor == NULL) return;
+				monitor_stop = true;
+				monitor_cd.notify_all();
+			}
+			monitor->join();
+			delete monitor;
+			monitor = NULL;
+			boost::unique_lock<boost::mutex> lock(cores_mutex);
+			std::vector<bool> cores(p);
+			for (int i = 0; i < p; i++) {
+				cores[i] = requested[i] || monitor_blocked[i];
+				monitor_contended[i] = false;
+				monitor_blocked[i] = false;
+			}
+			applyAvailableCores(cores);
+		}
+		
+		/*
+		 * Returns whether the contention monitor found the core contended.
+		 * The monitor blocks a contended core unless it is the last
+		 * available one.
+		 */
+		bool contendedCore(int core) const {
+			return monitor_contended[core];
+		}
+		
+		/*
+		 * Splits the cores among the Jobs by their weights, if fair share is
+		 * enabled. Called after cores are blocked or unblocked.
+		 */
+		void rebalance() {
+			boost::unique_lock<boost::mutex> lock(jobs_mutex);
+			rebalanceLocked();
+		}
+		
+		/*
+		 * Returns the number of cores of each job for the given weights: the
+		 * shares proportional to the weights, rounded by the largest
+		 * remainders, earlier jobs first on ties. If there are at least as
+		 * many cores as jobs, every job gets at least one core, taken from
+		 * the jobs with the most cores.
+		 */
+		static std::vector<int> fairShares(const std::vector<unsigned int>& w, int cores) {
+			std::size_t n = w.size();
+			std::vector<int> shares(n, 0);
+			if (n == 0 || cores <= 0) return shares;
+			unsigned long long total = 0;
+			for (std::size_t j = 0; j < n; j++) total += w[j];
+			std::vector<std::pair<unsigned long long, std::size_t> > remainders(n);
+			int given = 0;
+			for (std::size_t j = 0; j < n; j++) {
+				unsigned long long exact = static_cast<unsigned long long>(cores) * w[j];
+				shares[j] = exact / total;
+				given += shares[j];
+				// sorted by the largest remainder, then the earliest job
+				remainders[j] = std::make_pair(total - exact % total, j);
+			}
+			std::sort(remainders.begin(), remainders.end());
+			for (std::size_t r = 0; given < cores; r++, given++) {
+				shares[remainders[r].second]++;
+			}
+			if (static_cast<std::size_t>(cores) >= n) {
+				for (std::size_t j = 0; j < n; j++) {
+					if (shares[j] > 0) continue;
+					std::size_t most = std::max_element(shares.begin(), shares.end()) - shares.begin();
+					shares[most]--;
+					shares[j]++;
+				}
+			}
+			return shares;
 		}
 		
+		/*
+		 * Checks the allowed CPUs at once, e.g. after a CPU was hotplugged,
+		 * instead of at the next notification or period of the thread
+		 * watching them.
+		 */
+		void updateCpus() {
+			boost::unique_lock<boost::mutex> lock(cores_mutex);
+			updateCpusLocked();
+		}
+		
+		/*
+		 * Returns the CPU the thread of the given core is pinned to, -1 if it
+		 * is parked.
+		 */
+		int cpuOfCore(int core) const {
+			return thread_cpu[core];
+		}
+		
+		/*
+		 * Returns the NUMA node of the thread pinned to the given core, -1 if
+		 * the machine has only one node.
+		 */
+		int nodeOfCore(int core) const {
+			return thread_node[core];
+		}
+		
+		/*
+		 * Returns the core the calling thread is pinned to, or -1 if it may
+		 * run on more than one core or on a core without a thread of the
+		 * scheduler.
+		 */
+		int pinnedCore() const {
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			if (sched_getaffinity(0, sizeof(cpu_set_t), &set) != 0 || CPU_COUNT(&set) != 1) return -1;
+			for (int i = 0; i < p; i++) {
+				if (thread_cpu[i] >= 0 && CPU_ISSET(thread_cpu[i], &set)) return i;
+			}
+			return -1;
+		}
+
+		/*
+		 * Waits until all pakets of the Job are done, running pakets of the Job
+		 * in the calling thread meanwhile. A calling thread which is pinned to
+		 * a core of the scheduler only takes pakets while its core is not
+		 * blocked, and prefers the pakets of the core's NUMA node. Returns the
+		 * number of pakets the calling thread ran.
+		 */
+		std::size_t helpUntilDone(WorkQueue* job) {
+			int core = pinnedCore();
+			if (core < 0) {
+				return job->helpuntildone();
+			}
+			return job->helpuntildone(&availableCores[core], thread_node[core]);
+		}
+
+		/*
+		 * Returns the number of cores the given Job is scheduled on and which
+		 * are not blocked.
+		 */
+		int coresOfJob(WorkQueue* job) const {
+			int cores = 0;
+			for (int i = 0; i < p; i++) {
+				if (schedule[i] == job && availableCores[i]) cores++;
+			}
+			return cores;
+		}
 		
 		/*
 		 * Schedules the given Job onto the cores flagged in the given Bit-Vector
@@ -0,0 +1,173 @@
+/*
+ * NUMA topology and memory placement for the Maleable Scheduler.
+ *
+ * The topology is read from sysfs, memory is placed with the mbind and
+ * get_mempolicy system calls, so no libnuma is needed. On machines with a
+ * single node all placement functions do nothing.
+ */
+
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstddef>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+namespace Scheduler {
+
+namespace Numa {
+
+/*
+ * Placement of the memory of a sort: as it is first touched, on the node of
+ * the thread working on it, or interleaved over all nodes.
+ */
+enum Policy {FIRST_TOUCH, LOCAL, INTERLEAVE};
+
+/*
+ * Parses a sysfs list like "0-3,8,10-11" into the list of its numbers.
+ */
+inline std::vector<int> parse_list(const std::string& list) {
+	std::vector<int> result;
+	std::stringstream ss(list);
+	std::string range;
+	while (std::getline(ss, range, ',')) {
+		if (range.empty() || range[0] == '\n') continue;
+		int first, last;
+		char dash;
+		std::stringstream rs(range);
+		rs >> first;
+		if (rs >> dash >> last) {
+			for (int i = first; i <= last; i++) result.push_back(i);
+		} else {
+			result.push_back(first);
+		}
+	}
+	return result;
+}
+
+/*
+ * The NUMA topology of the machine: the node of each CPU.
+ */
+class Topology {
+	private:
+		std::vector<int> cpu_node;
+		int nodes;
+
+		Topology() : nodes(1) {
+			std::ifstream online("/sys/devices/system/node/online");
+			std::string list;
+			if (!(online >> list)) return;
+			std::vector<int> node_ids = parse_list(list);
+			if (node_ids.empty()) return;
+			nodes = node_ids.back() + 1;
+			for (std::size_t i = 0; i < node_ids.size(); i++) {
+				std::ostringstream name;
+				name << "/sys/devices/system/node/node" << node_ids[i] << "/cpulist";
+				std::ifstream cpulist(name.str().c_str());
+				std::string cpus;
+				if (!(cpulist >> cpus)) continue;
+				std::vector<int> cpu_ids = parse_list(cpus);
+				for (std::size_t c = 0; c < cpu_ids.size(); c++) {
+					if (cpu_ids[c] >= static_cast<int>(cpu_node.size())) {
+						cpu_node.resize(cpu_ids[c]+1, 0);
+					}
+					cpu_node[cpu_ids[c]] = node_ids[i];
+				}
+			}
+		}
+
+	public:
+		/*
+		 * Returns the topology, which is read once.
+		 */
+		static const Topology& get() {
+			static Topology topology;
+			return topology;
+		}
+
+		int num_nodes() const {
+			return nodes;
+		}
+
+		int node_of_cpu(int cpu) const {
+			if (cpu < 0 || cpu >= static_cast<int>(cpu_node.size())) return 0;
+			return cpu_node[cpu];
+		}
+};
+
+/*
+ * Returns the number of NUMA nodes, 1 if the topology is unknown.
+ */
+inline int num_nodes() {
+	return Topology::get().num_nodes();
+}
+
+/*
+ * Returns the node of the given CPU.
+ */
+inline int node_of_cpu(int cpu) {
+	return Topology::get().node_of_cpu(cpu);
+}
+
+/*
+ * Returns the node of the CPU the calling thread runs on.
+ */
+inline int current_node() {
+	return node_of_cpu(sched_getcpu());
+}
+
+/*
+ * Returns the node of the page at addr (which is faulted in if necessary),
+ * or -1 if it cannot be determined.
+ */
+inline int node_of_address(const void* addr) {
+	int node = -1;
+	if (syscall(SYS_get_mempolicy, &node, NULL, 0, addr, MPOL_F_NODE | MPOL_F_ADDR) != 0) {
+		return -1;
+	}
+	return node;
+}
+
+/*
+ * Applies the memory policy mode with the given nodemask to the whole pages
+ * inside [addr,addr+len). Existing pages are migrated if move is true.
+ */
+inline bool set_policy(void* addr, std::size_t len, int mode, unsigned long nodemask, bool move) {
+	const std::size_t page = sysconf(_SC_PAGESIZE);
+	std::size_t begin = (reinterpret_cast<std::size_t>(addr) + page - 1) & ~(page - 1);
+	std::size_t end = (reinterpret_cast<std::size_t>(addr) + len) & ~(page - 1);
+	if (end <= begin) return true;
+	return syscall(SYS_mbind, begin, end - begin, mode, &nodemask, sizeof(nodemask)*8, move ? MPOL_MF_MOVE : 0) == 0;
+}
+
+/*
+ * Places the memory [addr,addr+len) on the given node, if there is more than
+ * one node. The node is preferred, so allocation falls back to other nodes.
+ */
+inline bool bind(void* addr, std::size_t len, int node, bool move) {
+	if (num_nodes() <= 1 || node < 0 || node >= static_cast<int>(sizeof(unsigned long)*8)) return true;
+	return set_policy(addr, len, MPOL_PREFERRED, 1UL << node, move);
+}
+
+/*
+ * Interleaves the memory [addr,addr+len) over all nodes, if there is more
+ * than one node.
+ */
+inline bool interleave(void* addr, std::size_t len, bool move) {
+	int nodes = num_nodes();
+	if (nodes <= 1) return true;
+	unsigned long mask = (nodes >= static_cast<int>(sizeof(unsigned long)*8)) ? ~0UL : ((1UL << nodes) - 1);
+	return set_policy(addr, len, MPOL_INTERLEAVE, mask, move);
+}
+
+} // namespace Numa
+
+} // namespace
+
+#endif
@@ -1,5 +1,20 @@
 /*
- * This class implements a Blocking-Synchronized Queue with the Method blockuntildone()
+ * This class implements the WorkQueue of a Job: a work-stealing queue with the
+ * Method blockuntildone().
+ *
+ * Every worker (the thread of one core, see MaleableScheduler) owns a
+ * Chase-Lev deque. Pakets pushed by a paket that runs on a worker go to the
+ * bottom of its deque and are taken from there again by the worker, without
+ * a lock. Pakets pushed by other threads go to a shared injection queue. A
+ * worker without work takes from the injection queue and then steals from the
+ * top of the deques of the other workers, starting at a random one. The deque
+ * of a worker whose core is blocked stays stealable.
+ *
+ * A splittable paket (see WorkQueueItem::setSplittable()) can give away part
+ * of its work while it runs: a worker that finds nothing to steal asks a
+ * worker running one to split it, and a worker whose core is blocked is asked
+ * on every poll. The paket polls splitRequested() between chunks of its work
+ * and pushes the part it gives away with pushSplit().
  */
 
 #ifndef WORKQUEUE_H
@@ -7,31 +22,404 @@
 
 #include <vector>
 #include <deque>
+#include <iostream>
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <time.h>
 #include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+#include "chase_lev_deque.h"
+
+// the number of items that can depend on one WorkQueueItem
+#define WORKQUEUE_MAX_SUCCESSORS 4
 
 namespace Scheduler {
 
 class WorkQueueItem {
+	private:
+		// the NUMA node preferred for this item, -1 for any
+		int preferred_node;
+		// the items that depend on this one
+		WorkQueueItem* successors[WORKQUEUE_MAX_SUCCESSORS];
+		int num_successors;
+		// the number of items this one depends on that are not done yet
+		boost::atomic<int> dependencies;
+		// whether the item can be split while it runs, and whether it is a
+		// part pushed by pushSplit(), which the WorkQueue deletes when done
+		bool splittable;
+		bool split_part;
+
+		friend class WorkQueue;
+
+	protected:
+		/*
+		 * Declares whether the item polls splitRequested() while it runs.
+		 */
+		void setSplittable(bool s) {
+			splittable = s;
+		}
+
+		/*
+		 * Returns true if the item should give away part of its remaining
+		 * work, because an idle worker asked for it or because the core of
+		 * the running worker is blocked. Only called while the item runs.
+		 */
+		bool splitRequested();
+
+		/*
+		 * Pushes the part of its work the running item gives away. The part
+		 * is allocated with new and deleted by the WorkQueue once it is done,
+		 * it gets the successors of this item, so that they wait for both.
+		 */
+		void pushSplit(WorkQueueItem* part);
+
 	public:
+		WorkQueueItem() : preferred_node(-1), num_successors(0), dependencies(0), splittable(false), split_part(false) {
+		}
+
+		WorkQueueItem(const WorkQueueItem& other) : preferred_node(other.preferred_node), num_successors(other.num_successors), dependencies(other.dependencies.load()), splittable(other.splittable), split_part(false) {
+			std::copy(other.successors, other.successors + num_successors, successors);
+		}
+
+		WorkQueueItem& operator=(const WorkQueueItem& other) {
+			preferred_node = other.preferred_node;
+			num_successors = other.num_successors;
+			dependencies.store(other.dependencies.load());
+			splittable = other.splittable;
+			std::copy(other.successors, other.successors + num_successors, successors);
+			return *this;
+		}
+
+		virtual ~WorkQueueItem() {
+		}
+
 		virtual void operator()() = 0;
+
+		/*
+		 * Sets the NUMA node on which the item should preferably be executed.
+		 */
+		void setNode(int node) {
+			preferred_node = node;
+		}
+
+		int node() const {
+			return preferred_node;
+		}
+
+		bool isSplittable() const {
+			return splittable;
+		}
+
+		/*
+		 * Declares that this item can only run after the predecessor is done.
+		 * An item with dependencies is not pushed by the caller, the WorkQueue
+		 * pushes it when the last of its predecessors is done. The dependencies
+		 * have to be declared before the predecessor is pushed, an item takes
+		 * at most WORKQUEUE_MAX_SUCCESSORS successors, otherwise
+		 * std::length_error is thrown.
+		 */
+		void dependsOn(WorkQueueItem* predecessor) {
+			if (predecessor->num_successors == WORKQUEUE_MAX_SUCCESSORS) {
+				throw std::length_error("WorkQueueItem::dependsOn: too many successors");
+			}
+			predecessor->successors[predecessor->num_successors++] = this;
+			dependencies.fetch_add(1, boost::memory_order_relaxed);
+		}
+
+		/*
+		 * Returns the number of predecessors which are not done yet.
+		 */
+		int unresolvedDependencies() const {
+			return dependencies.load(boost::memory_order_acquire);
+		}
 };
 
 class WorkQueue {
 	private:
+		/*
+		 * The state of one worker.
+		 */
+		struct Worker {
+			ChaseLevDeque<WorkQueueItem> deque;
+			// the NUMA node the worker runs on, -1 for any
+			volatile int node;
+			// whether the worker runs a splittable paket, whether an idle
+			// worker asked it to split, and whether its core got blocked
+			// while it runs the paket
+			boost::atomic<bool> running_splittable;
+			boost::atomic<bool> split_request;
+			boost::atomic<bool> yielding;
+
+			Worker() : node(-1), running_splittable(false), split_request(false), yielding(false) {
+			}
+		};
+
+		/*
+		 * The queue and the worker the calling thread currently runs a paket
+		 * for, and the state of its random victim selection.
+		 */
+		struct CurrentWorker {
+			WorkQueue* queue;
+			int worker;
+			unsigned int seed;
+		};
+
+		static CurrentWorker& current() {
+			static __thread CurrentWorker c = {NULL, -1, 0};
+			return c;
+		}
+
+		std::vector<Worker*> workers;
+
+		friend class WorkQueueItem;
+
+		// protects the injection queue and the sleeping of the threads
 		boost::mutex mut;
 		boost::condition_variable cd;
 		boost::condition_variable external_cd;
-		std::deque<WorkQueueItem*> q;
-		int active;
-		int sleeping;
-		volatile bool destruct;
-		
+		// the pakets pushed by threads that are not workers of this queue
+		std::deque<WorkQueueItem*> injected;
+		boost::atomic<long> injected_size;
+		// the number of pakets pushed and not yet done, and pushed in total
+		boost::atomic<long> pending;
+		boost::atomic<long> pushed;
+		// the number of pakets pushed and not yet taken
+		boost::atomic<long> queued;
+		// the number of threads sleeping in the queue and inside wait_and_workOne()
+		// or helpuntildone(), and the number of sleeping helping threads
+		boost::atomic<int> sleeping;
+		boost::atomic<int> inside;
+		int helpers;
+		// the nanoseconds threads spent sleeping in the queue
+		boost::atomic<long long> idle;
+		// the number of parts split off running pakets
+		boost::atomic<long> split_jobs;
+		// called when the first paket is pushed into the empty queue and
+		// when the last pending one is done
+		void (*activity_listener)(void*);
+		void* activity_arg;
+		// incremented by wakeWorkers(), so that the sleeping threads return
+		unsigned int epoch;
+		boost::atomic<bool> destruct;
+
+		/*
+		 * Returns a random number for the victim selection.
+		 */
+		static unsigned int nextRandom() {
+			unsigned int& x = current().seed;
+			if (x == 0) x = reinterpret_cast<std::size_t>(&x) | 1;
+			// xorshift
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			return x;
+		}
+
+		/*
+		 * Takes the first paket of the injection queue, or the first one
+		 * preferring the given NUMA node.
+		 */
+		WorkQueueItem* takeInjected(int node) {
+			if (injected_size.load(boost::memory_order_acquire) == 0) return NULL;
+			boost::unique_lock<boost::mutex> lock(mut);
+			if (injected.empty()) return NULL;
+			std::deque<WorkQueueItem*>::iterator it = injected.begin();
+			if (node >= 0) {
+				while (it != injected.end() && (*it)->node() != node) ++it;
+				if (it == injected.end()) it = injected.begin();
+			}
+			WorkQueueItem* job = *it;
+			injected.erase(it);
+			injected_size.fetch_sub(1, boost::memory_order_relaxed);
+			return job;
+		}
+
+		/*
+		 * Steals a paket from the deque of another worker, starting at a
+		 * random one. If the calling thread runs on a NUMA node, the workers
+		 * of the same node are tried first.
+		 */
+		WorkQueueItem* steal(int worker, int node) {
+			int w = workers.size();
+			int start = nextRandom() % w;
+			for (int pass = (node >= 0) ? 0 : 1; pass < 2; pass++) {
+				for (int i = 0; i < w; i++) {
+					int victim = (start + i) % w;
+					if (victim == worker) continue;
+					if (pass == 0 && workers[victim]->node != node) continue;
+					ChaseLevDeque<WorkQueueItem>& d = workers[victim]->deque;
+					while (!d.empty()) {
+						WorkQueueItem* job = d.steal();
+						if (job != NULL) return job;
+					}
+				}
+			}
+			return NULL;
+		}
+
+		/*
+		 * Asks one of the other workers running a splittable paket, starting
+		 * at a random one, to split it. The part is pushed to the deque of
+		 * that worker, which wakes the sleeping threads.
+		 */
+		void requestSplit(int worker) {
+			int w = workers.size();
+			int start = nextRandom() % w;
+			for (int i = 0; i < w; i++) {
+				int victim = (start + i) % w;
+				if (victim == worker) continue;
+				Worker* v = workers[victim];
+				if (v->running_splittable.load(boost::memory_order_relaxed) && !v->split_request.load(boost::memory_order_relaxed)) {
+					v->split_request.store(true, boost::memory_order_relaxed);
+					return;
+				}
+			}
+		}
+
+		/*
+		 * Takes a paket: the last one of the own deque, then the first one of
+		 * the injection queue, then a stolen one. Returns NULL if there is none,
+		 * after asking a running paket to split.
+		 */
+		WorkQueueItem* take(int worker, int node) {
+			WorkQueueItem* job = NULL;
+			if (worker >= 0) job = workers[worker]->deque.pop();
+			if (job == NULL) job = takeInjected(node);
+			if (job == NULL) job = steal(worker, node);
+			if (job != NULL) {
+				queued.fetch_sub(1, boost::memory_order_relaxed);
+			} else {
+				requestSplit(worker);
+			}
+			return job;
+		}
+
+		/*
+		 * Runs the paket as the given worker and notifies blockuntildone() if
+		 * it was the last pending one.
+		 */
+		void run(WorkQueueItem* job, int worker) {
+			CurrentWorker saved = current();
+			current().queue = this;
+			current().worker = worker;
+			// only workers can be asked to split, a helping thread has no deque
+			bool splittable = job->splittable && worker >= 0;
+			if (splittable) {
+				workers[worker]->split_request.store(false, boost::memory_order_relaxed);
+				workers[worker]->yielding.store(false, boost::memory_order_relaxed);
+				workers[worker]->running_splittable.store(true, boost::memory_order_relaxed);
+			}
+			(*job)();
+			if (splittable) {
+				workers[worker]->running_splittable.store(false, boost::memory_order_relaxed);
+				workers[worker]->yielding.store(false, boost::memory_order_relaxed);
+			}
+			// push the successors this was the last predecessor of, before the
+			// job counts as done, so that blockuntildone() waits for them
+			WorkQueueItem* ready[WORKQUEUE_MAX_SUCCESSORS];
+			int num_ready = 0;
+			for (int i = 0; i < job->num_successors; i++) {
+				if (job->successors[i]->dependencies.fetch_sub(1, boost::memory_order_acq_rel) == 1) {
+					ready[num_ready++] = job->successors[i];
+				}
+			}
+			push(ready, num_ready);
+			current().queue = saved.queue;
+			current().worker = saved.worker;
+			if (job->split_part) delete job;
+			if (pending.fetch_sub(1, boost::memory_order_acq_rel) == 1) {
+				{
+					boost::unique_lock<boost::mutex> lock(mut);
+					external_cd.notify_all();
+					// the helping threads sleep with the workers
+					if (helpers > 0) cd.notify_all();
+				}
+				if (activity_listener != NULL) activity_listener(activity_arg);
+			}
+		}
+
+		/*
+		 * Returns the monotonic time in nanoseconds.
+		 */
+		static long long now() {
+			struct timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+		}
+
+		/*
+		 * Sleeps until a paket is queued, or, for a helping thread, until all
+		 * pakets are done. Returns false if the thread was woken by
+		 * wakeWorkers() or releaseWaitingThreads() instead.
+		 */
+		bool sleep(bool helping = false) {
+			boost::unique_lock<boost::mutex> lock(mut);
+			unsigned int e = epoch;
+			// the push increments queued before it reads sleeping, so
+			// either it sees this thread sleeping or this thread sees the paket
+			sleeping.fetch_add(1);
+			if (helping) helpers++;
+			if (queued.load() == 0 && !destruct && epoch == e && !(helping && pending.load() == 0)) {
+				long long start = now();
+				while (queued.load() == 0 && !destruct && epoch == e && !(helping && pending.load() == 0)) {
+					cd.wait(lock);
+				}
+				idle.fetch_add(now() - start, boost::memory_order_relaxed);
+			}
+			if (helping) helpers--;
+			sleeping.fetch_sub(1);
+			return !destruct && epoch == e;
+		}
+
+		/*
+		 * Called by each thread leaving the queue.
+		 */
+		void leave() {
+			if (inside.fetch_sub(1) == 1 && destruct) {
+				// this thread is the last one to leave
+				boost::unique_lock<boost::mutex> lock(mut);
+				external_cd.notify_all();
+			}
+		}
+
+		/*
+		 * Wakes sleeping threads for n new pakets.
+		 */
+		void wake(std::size_t n) {
+			if (sleeping.load() == 0) return;
+			boost::unique_lock<boost::mutex> lock(mut);
+			if (n == 1) {
+				cd.notify_one();
+			} else {
+				cd.notify_all();
+			}
+		}
+
+		/*
+		 * Returns the worker of this queue the calling thread runs a paket
+		 * for, -1 if it is none.
+		 */
+		int pushingWorker() const {
+			return (current().queue == this) ? current().worker : -1;
+		}
+
+		// non copyable
+		WorkQueue(const WorkQueue&);
+		WorkQueue& operator=(const WorkQueue&);
+
 	public:
 	
 		/*
-		 * Constructor for the WorkQueue, initializing its attributes.
+		 * Constructor for the WorkQueue, with a deque for each of the given
+		 * number of workers.
 		 */
-		WorkQueue() : active(0), sleeping(0), destruct(false) {
+		WorkQueue(int num_workers = boost::thread::hardware_concurrency())
+			: injected_size(0), pending(0), pushed(0), queued(0), sleeping(0), inside(0), helpers(0), idle(0), split_jobs(0), activity_listener(NULL), activity_arg(NULL), epoch(0), destruct(false) {
+			if (num_workers < 1) num_workers = 1;
+			for (int i = 0; i < num_workers; i++) {
+				workers.push_back(new Worker());
+			}
 		}
 		
 		/*
@@ -45,72 +433,184 @@ class WorkQueue {
 				// shouldnt happen
 				std::cout << "WAAAAA This shoudl not happen, ARGH -.-" << std::endl;
 			}
+			for (std::size_t i = 0; i < workers.size(); i++) {
+				delete workers[i];
+			}
 			//std::cout << "Destructor done!" << std::endl;
 		}
 		
 		/*
-		 * Gets the front Job from the Queue and completes that Job before returning.
-		 * If the Queue is currently emtpy, this method blocks, until a job is available
-		 * in the Queue or until the WorkQueue object is destructed, then the waiting Threads
-		 * will be released. Threadsafe!
+		 * Takes a Job from the Queue and completes that Job before returning.
+		 * The worker is the index of the calling thread's deque, -1 for a thread
+		 * without a deque. If the calling thread runs on a NUMA node (node >= 0),
+		 * Jobs preferring that node and the deques of workers on that node are
+		 * tried first.
+		 * If the Queue is currently empty, this method blocks until a Job is
+		 * available, until wakeWorkers() is called or until the WorkQueue object
+		 * is destructed; then it returns without a Job. Threadsafe!
 		 */
-		void wait_and_workOne() {
-			if (destruct) return;
-			boost::unique_lock<boost::mutex> lock(mut);
-			active++;
-			// wait until queue is not empty and lock is aquired
-			while (q.empty()) {
-				active--;
-				if (active == 0) {
-					external_cd.notify_all();
-				}
-				sleeping++;
-				//std::cout << "Thread sleeping at WorkQueue with active= " << active << " and sleeping= " << sleeping << std::endl;
-				cd.wait(lock);
-				sleeping--;
-				active++;
-				if (destruct) {
-					active--;
-					if (sleeping == 0 && active == 0) {
-						// this thread is the last one to leave
-						external_cd.notify_all();
-					}
-					//std::cout << "Thread Leaving WorkQueue with active= " << active << " and sleeping= " << sleeping << std::endl;
-					return;
+		void wait_and_workOne(int node = -1, int worker = -1) {
+			inside.fetch_add(1);
+			if (worker >= static_cast<int>(workers.size())) worker = -1;
+			if (worker >= 0) workers[worker]->node = node;
+			while (!destruct) {
+				WorkQueueItem* job = take(worker, node);
+				if (job != NULL) {
+					run(job, worker);
+					break;
 				}
+				if (!sleep()) break;
 			}
-			
-			WorkQueueItem* job = q.front();
-			q.pop_front();
-			// unlock before doing job
-			lock.unlock();
-			(*job)();
-			lock.lock();
-			active--;
-			if (destruct && sleeping == 0 && active == 0)
-				external_cd.notify_all();
-			lock.unlock();
+			leave();
 		}
 		
 		/*
 		 * Pushes a new Job into the WorkQueue, this is Threadsafe!
 		 */
 		void push(WorkQueueItem* it) {
-			boost::unique_lock<boost::mutex> lock(mut);
-			q.push_back(it);
-			cd.notify_one();
+			push(&it, 1);
+		}
+
+		/*
+		 * Pushes the n Jobs items[0..n) into the WorkQueue at once, waking the
+		 * sleeping threads once. Threadsafe!
+		 */
+		template<typename _Item>
+		void push(_Item* const* items, std::size_t n) {
+			if (n == 0) return;
+			// counted before they can be taken and be done
+			bool first = pending.fetch_add(n, boost::memory_order_relaxed) == 0;
+			pushed.fetch_add(n, boost::memory_order_relaxed);
+			int worker = pushingWorker();
+			if (worker >= 0) {
+				for (std::size_t i = 0; i < n; i++) {
+					workers[worker]->deque.push(items[i]);
+				}
+				queued.fetch_add(n);
+				wake(n);
+			} else {
+				boost::unique_lock<boost::mutex> lock(mut);
+				for (std::size_t i = 0; i < n; i++) {
+					injected.push_back(items[i]);
+				}
+				injected_size.fetch_add(n, boost::memory_order_release);
+				queued.fetch_add(n);
+				if (sleeping.load() > 0) {
+					if (n == 1) {
+						cd.notify_one();
+					} else {
+						cd.notify_all();
+					}
+				}
+			}
+			if (first && activity_listener != NULL) activity_listener(activity_arg);
 		}
 		
 		/*
-		 * This Method blocks until there is no more active Thread working on
-		 * the Jobs in the Queue.
+		 * This Method blocks until all Jobs pushed into the Queue are done,
+		 * including the ones pushed by Jobs while they run.
 		 */
 		void blockuntildone() {
 			boost::unique_lock<boost::mutex> l(mut);
-			while (!q.empty() || active > 0) {
+			while (pending.load(boost::memory_order_acquire) > 0) {
 				external_cd.wait(l);
 			}
 		}
+
+		/*
+		 * Like blockuntildone(), but the calling thread runs Jobs of the Queue
+		 * while it waits, like a worker without a deque, preferring the given
+		 * NUMA node. If available is given, the thread only takes a Job while
+		 * *available is true, otherwise it waits for the Jobs to be done.
+		 * Returns the number of Jobs the calling thread ran.
+		 */
+		std::size_t helpuntildone(volatile bool* available = NULL, int node = -1) {
+			std::size_t helped = 0;
+			inside.fetch_add(1);
+			while (pending.load(boost::memory_order_acquire) > 0 && !destruct) {
+				if (available == NULL || *available) {
+					WorkQueueItem* job = take(-1, node);
+					if (job != NULL) {
+						run(job, -1);
+						helped++;
+					} else {
+						sleep(true);
+					}
+				} else {
+					boost::unique_lock<boost::mutex> l(mut);
+					if (pending.load(boost::memory_order_acquire) > 0) {
+						external_cd.wait(l);
+					}
+				}
+			}
+			leave();
+			return helped;
+		}
+
+		/*
+		 * Returns the number of Jobs pushed into the Queue and not yet done.
+		 */
+		long pendingJobs() const {
+			return pending.load(boost::memory_order_acquire);
+		}
+
+		/*
+		 * Returns the number of Jobs pushed into the Queue that are done.
+		 */
+		long completedJobs() const {
+			// a Job pushed in between counts as pending, not as done
+			long p = pushed.load(boost::memory_order_acquire);
+			return std::max(0L, p - pending.load(boost::memory_order_acquire));
+		}
+
+		/*
+		 * Sets the function called with arg when the first Job is pushed into
+		 * the Queue while no Job is pending, and when the last pending Job is
+		 * done. It is called by the pushing or working thread, without locks
+		 * of the Queue held, so it must not wait for the Queue.
+		 */
+		void setActivityListener(void (*listener)(void*), void* arg) {
+			activity_arg = arg;
+			activity_listener = listener;
+		}
+
+		/*
+		 * Returns the seconds the threads of the Queue spent sleeping while
+		 * they had no Job, summed over the threads.
+		 */
+		double idleTime() const {
+			return idle.load(boost::memory_order_relaxed) * 1e-9;
+		}
+
+		/*
+		 * Returns the number of Jobs split off running Jobs.
+		 */
+		long splitJobs() const {
+			return split_jobs.load(boost::memory_order_relaxed);
+		}
+
+		/*
+		 * Asks the splittable Job the worker runs, if any, to give away part
+		 * of its work on every poll until it is done. The scheduler calls
+		 * this when the core of the worker is blocked.
+		 */
+		void yieldWorker(int worker) {
+			if (worker < 0 || worker >= static_cast<int>(workers.size())) return;
+			if (workers[worker]->running_splittable.load(boost::memory_order_relaxed)) {
+				workers[worker]->yielding.store(true, boost::memory_order_relaxed);
+			}
+		}
+
+		/*
+		 * Wakes all threads sleeping in the Queue, they return from
+		 * wait_and_workOne() without a Job. The scheduler calls this when a
+		 * core is blocked, so that its thread stops taking work.
+		 */
+		void wakeWorkers() {
+			boost::unique_lock<boost::mutex> lock(mut);
+			epoch++;
+			cd.notify_all();
+		}
 		
 		/*
 		 * Releases all waiting Threads and puts the Queue in a status where it does not accept new Threads.
@@ -120,14 +620,37 @@ class WorkQueue {
 			destruct = true;
 			//std::cout << "Notifying Sleeping Threads" << std::endl;
 			cd.notify_all();
+			external_cd.notify_all();
 			// wait for all threads to leave before destructing attributes (mutex, etc)
-			while (active != 0 || sleeping != 0) {
+			while (inside.load() != 0) {
 				external_cd.wait(lock);
-				//std::cout << "Got Notified with active= " << active << " and sleeping= " << sleeping << std::endl;
+				//std::cout << "Got Notified with inside= " << inside << std::endl;
 			}
 		}
 };
 
+inline bool WorkQueueItem::splitRequested() {
+	WorkQueue* queue = WorkQueue::current().queue;
+	int worker = WorkQueue::current().worker;
+	if (queue == NULL || worker < 0) return false;
+	WorkQueue::Worker* w = queue->workers[worker];
+	if (w->yielding.load(boost::memory_order_relaxed)) return true;
+	return w->split_request.load(boost::memory_order_relaxed) && w->split_request.exchange(false, boost::memory_order_relaxed);
+}
+
+inline void WorkQueueItem::pushSplit(WorkQueueItem* part) {
+	part->split_part = true;
+	// this item is not done, so the successors can not become ready meanwhile
+	for (int i = 0; i < num_successors; i++) {
+		part->successors[i] = successors[i];
+		successors[i]->dependencies.fetch_add(1, boost::memory_order_relaxed);
+	}
+	part->num_successors = num_successors;
+	WorkQueue* queue = WorkQueue::current().queue;
+	queue->split_jobs.fetch_add(1, boost::memory_order_relaxed);
+	queue->push(part);
+}
+
 } // namespace
 
 #endif
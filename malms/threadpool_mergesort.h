@@ -27,6 +27,9 @@
 #include "merge_paket.h"
 #include "split_paket.h"
 #include "copy_paket.h"
+#include "sort_context.h"
+#include "paket_size.h"
+#include "autotune.h"
 
 
 #ifdef TIMING_PHASES
@@ -47,6 +50,9 @@ namespace malms {
 void outputTime(std::string name,double time) {
 	std::cout << "        " << name << ": " << time << " s" << std::endl;
 }
+void outputHelped(std::string name,std::size_t pakets) {
+	std::cout << "        " << name << ": " << pakets << " pakets run by the calling thread" << std::endl;
+}
 #endif
 #ifdef TIMING_THREADS
 void outputThreadTime(std::string name,double time) {
@@ -54,26 +60,24 @@ void outputThreadTime(std::string name,double time) {
 }
 #endif
 
-// Returns the size of each paket for any number of pakets and any paket.
-template<typename _Distance>
-inline _Distance paket_size(_Distance n,unsigned int num_pakets,unsigned int paket) {
-	return n/num_pakets + ((paket < n%num_pakets)?1:0);
-}
-
-
 
 /*
  * The Mergesort function, sorting the sequence given by [begin,end) using
  * num_of_pakets pakets in each step and the workqueue given by queue.
+ * All memory used by the sort is taken from the given context, which can be
+ * reused for subsequent calls. The sort is stable if the context is. With a
+ * pipelined context the phases overlap, otherwise the sort waits for the queue
+ * after each phase.
  */
-template<typename _RandomAccessIterator>
-void sort(_RandomAccessIterator begin,_RandomAccessIterator end, unsigned int num_of_pakets, Scheduler::WorkQueue* queue) {
+template<typename _RandomAccessIterator, bool _Stable>
+void sort(_RandomAccessIterator begin,_RandomAccessIterator end, unsigned int num_of_pakets, Scheduler::WorkQueue* queue, SortContext<_RandomAccessIterator,_Stable>& context) {
 	typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type _Distance;
 	typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;	
 	
 	#ifdef TIMING_PHASES
 	CPUTimer timer;
 	timer.start();
+	std::size_t helped = 0;
 	#endif
 	#ifdef TIMING_PHASES_CSV
 	CPUTimer timer;
@@ -82,24 +86,65 @@ void sort(_RandomAccessIterator begin,_RandomAccessIterator end, unsigned int nu
 	// get size
 	_Distance n = end - begin;
 	
-	// array for buffering
-	std::vector<_ValueType*> buffers(num_of_pakets);
+	// get workspace for buffering, splitting and the pakets
+	context.prepare(n, num_of_pakets);
+	context.prefault(n, queue);
+	_ValueType* buffer = context.buffer();
+	_ValueType*** splitters = context.splitters();
 	
+	// the first and last row of the splitters are the begins and ends of
+	// the runs, they and the number of elements before each row are known
+	// before the runs are sorted
+	_RandomAccessIterator begin_i = begin;
+	_Distance sumsizes[num_of_pakets];
+	for (unsigned int i = 0; i < num_of_pakets;i++) {
+		// init upper and lower splitters with begin and ends of the
+		// sorted sequences
+		splitters[0][i] = buffer + (begin_i - begin);
+		begin_i = begin_i + paket_size(n,num_of_pakets,i);
+		splitters[num_of_pakets][i] = buffer + (begin_i - begin);
+		// init prefix sum of paket sizes
+		sumsizes[i] = begin_i - begin;
+	}
 	
-	// create pakets for run formation
-	typedef typename std::vector<_ValueType*>::iterator _bufIt;
+	if (context.isPipelined()) {
+		// create all pakets and connect them by their dependencies, only the
+		// sort pakets are pushed, the queue pushes the split and merge
+		// pakets as soon as their input is ready
+		begin_i = begin;
+		for (unsigned int i = 0; i < num_of_pakets; i++) {
+			context.sortPaket(begin_i,begin_i+paket_size(n,num_of_pakets,i),buffer+(begin_i-begin));
+			begin_i = begin_i + paket_size(n,num_of_pakets,i);
+		}
+		context.prepareSplit(sumsizes, boost::thread::hardware_concurrency(), queue);
+		begin_i = begin;
+		for (unsigned int i = 0; i < num_of_pakets; i++) {
+			context.mergePaket(i,begin_i);
+			begin_i = begin_i + paket_size(n,num_of_pakets,i);
+		}
+		context.prepareDependencies(queue);
+		for (unsigned int i = 0; i < num_of_pakets; i++) {
+			queue->push(&context.sortPakets()[i]);
+		}
+		context.wait(queue);
+		return;
+	}
 	
-	_RandomAccessIterator begin_i = begin;
+	// create pakets for run formation, each run is sorted into the buffer
+	// at the same offset as its slice in the input
+	begin_i = begin;
 	for (unsigned int i = 0; i < num_of_pakets; i++) {
-		queue->push(new SortPaket<_RandomAccessIterator,_bufIt>(begin_i,begin_i+paket_size(n,num_of_pakets,i),buffers.begin()+i));
+		queue->push(context.sortPaket(begin_i,begin_i+paket_size(n,num_of_pakets,i),buffer+(begin_i-begin)));
 		begin_i = begin_i + paket_size(n,num_of_pakets,i);
 	}
 	// wait until all pakets are done
-	queue->blockuntildone();
+	context.wait(queue);
 	
 	#ifdef TIMING_PHASES
 	timer.stop();
 	outputTime("Sorting Phase",timer.getTime());
+	if (context.helpingWait()) outputHelped("Sorting Phase",context.helpedPakets() - helped);
+	helped = context.helpedPakets();
 	timer.start();
 	#endif
 	
@@ -109,35 +154,23 @@ void sort(_RandomAccessIterator begin,_RandomAccessIterator end, unsigned int nu
 	timer.start();
 	#endif
 	
-	/* initialize for parallel splitting */
-	
-	_ValueType*** splitters =  new _ValueType**[(num_of_pakets+1)];
-	for (unsigned int i=0; i < num_of_pakets+1;i++) {
-		splitters[i] = new _ValueType*[num_of_pakets];
+	// compute the splitter rows by bisection, the independent top rows first
+	context.prepareSplit(sumsizes, boost::thread::hardware_concurrency(), queue);
+	if (!context.splitRoots().empty()) {
+		queue->push(&context.splitRoots()[0], context.splitRoots().size());
+		context.wait(queue);
 	}
-	
-	begin_i = begin;
-	_Distance sumsizes[num_of_pakets];
-	for (unsigned int i = 0; i < num_of_pakets;i++) {
-		// init upper and lower splitters with begin and ends of the
-		// sorted sequences
-		splitters[0][i] = buffers[i];
-		begin_i = begin_i + paket_size(n,num_of_pakets,i);
-		splitters[num_of_pakets][i] = buffers[i] + paket_size(n,num_of_pakets,i);
-		// init prefix sum of paket sizes
-		sumsizes[i] = begin_i - begin;
-	}
-	
-	for (unsigned int i = 0; i < num_of_pakets-1; i++) {
-		queue->push(new SplitPaket<_ValueType*>(splitters, num_of_pakets, i, sumsizes[i]));
+	if (!context.splitSubtrees().empty()) {
+		queue->push(&context.splitSubtrees()[0], context.splitSubtrees().size());
+		context.wait(queue);
 	}
 	
-	queue->blockuntildone();
-	
 	
 	#ifdef TIMING_PHASES
 	timer.stop();
 	outputTime("Split",timer.getTime());
+	if (context.helpingWait()) outputHelped("Split",context.helpedPakets() - helped);
+	helped = context.helpedPakets();
 	timer.start();
 	#endif
 	
@@ -162,16 +195,18 @@ void sort(_RandomAccessIterator begin,_RandomAccessIterator end, unsigned int nu
 	_RandomAccessIterator buffer_curPos = begin;
 
 	for (unsigned int i=0;i<num_of_pakets;i++) {
-		queue->push(new MergePaket<_ValueType*,_RandomAccessIterator>(splitters[i],splitters[i+1],buffer_curPos,num_of_pakets));
+		queue->push(context.mergePaket(i,buffer_curPos));
 		buffer_curPos += paket_size(n,num_of_pakets,i);
 	}
 
-	queue->blockuntildone();
+	context.wait(queue);
 	
 	
 	#ifdef TIMING_PHASES
 	timer.stop();
 	outputTime("Merge",timer.getTime());
+	if (context.helpingWait()) outputHelped("Merge",context.helpedPakets() - helped);
+	helped = context.helpedPakets();
 	timer.start();
 	#endif
 	
@@ -200,14 +235,7 @@ void sort(_RandomAccessIterator begin,_RandomAccessIterator end, unsigned int nu
 	timer.start();
 	#endif
 	
-	// clean up
-	for (unsigned int i = 0; i < num_of_pakets;i++) {
-		delete [] splitters[i];
-		delete [] buffers[i];
-	}
-	delete [] splitters[num_of_pakets];
-	delete [] splitters;
-	//delete buffer;
+	// nothing to clean up, all memory is owned by the context
 	
 	#ifdef TIMING_PHASES
 	timer.stop();
@@ -215,6 +243,77 @@ void sort(_RandomAccessIterator begin,_RandomAccessIterator end, unsigned int nu
 	#endif
 }
 
+/*
+ * The Mergesort function, sorting the sequence given by [begin,end) using
+ * num_of_pakets pakets in each step and the workqueue given by queue.
+ * Uses a temporary SortContext, which is freed before returning.
+ */
+template<typename _RandomAccessIterator>
+void sort(_RandomAccessIterator begin,_RandomAccessIterator end, unsigned int num_of_pakets, Scheduler::WorkQueue* queue) {
+	SortContext<_RandomAccessIterator> context;
+	sort(begin, end, num_of_pakets, queue, context);
+}
+
+/*
+ * The stable Mergesort function, like sort, but equal elements keep their
+ * order: runs are formed with a stable sort and equal elements of different
+ * runs are split and merged in the order of the runs.
+ */
+template<typename _RandomAccessIterator>
+void stable_sort(_RandomAccessIterator begin,_RandomAccessIterator end, unsigned int num_of_pakets, Scheduler::WorkQueue* queue, SortContext<_RandomAccessIterator,true>& context) {
+	sort(begin, end, num_of_pakets, queue, context);
+}
+
+/*
+ * The stable Mergesort function using a temporary SortContext.
+ */
+template<typename _RandomAccessIterator>
+void stable_sort(_RandomAccessIterator begin,_RandomAccessIterator end, unsigned int num_of_pakets, Scheduler::WorkQueue* queue) {
+	SortContext<_RandomAccessIterator,true> context;
+	sort(begin, end, num_of_pakets, queue, context);
+}
+
+/*
+ * The Mergesort function choosing its parameters itself: the number of pakets,
+ * whether the merge is buffered, and whether the input is small enough to be
+ * sorted sequentially, from the tuning table or the cache sizes and the cores
+ * of the job (see autotune.h). The buffered merge setting of the context is
+ * overwritten.
+ */
+template<typename _RandomAccessIterator, bool _Stable>
+void sort(_RandomAccessIterator begin,_RandomAccessIterator end, Scheduler::WorkQueue* queue, SortContext<_RandomAccessIterator,_Stable>& context) {
+	typedef typename std::iterator_traits<_RandomAccessIterator>::value_type _ValueType;
+	Tuning::Parameters p = Tuning::choose<_ValueType>(end - begin, Tuning::job_cores(queue));
+	if (p.sequential) {
+		if (_Stable) {
+			std::stable_sort(begin, end);
+		} else {
+			std::sort(begin, end);
+		}
+		return;
+	}
+	context.setBufferedMerge(p.buffered_merge);
+	sort(begin, end, p.num_of_pakets, queue, context);
+}
+
+/*
+ * The self-tuning Mergesort function using a temporary SortContext.
+ */
+template<typename _RandomAccessIterator>
+void sort(_RandomAccessIterator begin,_RandomAccessIterator end, Scheduler::WorkQueue* queue) {
+	SortContext<_RandomAccessIterator> context;
+	sort(begin, end, queue, context);
+}
+
+/*
+ * The self-tuning stable Mergesort function using a temporary SortContext.
+ */
+template<typename _RandomAccessIterator>
+void stable_sort(_RandomAccessIterator begin,_RandomAccessIterator end, Scheduler::WorkQueue* queue) {
+	SortContext<_RandomAccessIterator,true> context;
+	sort(begin, end, queue, context);
+}
+
 } // namespace
 
 #endif
@@ -2,9 +2,17 @@
 #include <vector>
 #include <algorithm>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <limits>
 
 // algorithm to test
 #include "../malms/threadpool_mergesort.h"
+#include "../malms/indirect_sort.h"
+#include "../malms/bounded_mergesort.h"
+#include "../malms/external_sort.h"
+#include "../malms/sample_sort.h"
 #include "../malms/threadpool/maleablescheduler.h"
 
 
@@ -13,6 +21,7 @@
 #define INPUT_SORTED_INT 2
 #define INPUT_SAME_INT 3
 #define INPUT_REV_SORTED_INT 4
+#define INPUT_HALF_SAME_INT 5
 
 
 int testcase = 0;
@@ -37,6 +46,20 @@ struct TestdataComp {
 	}
 } ;
 
+// a large record for the indirect sort
+struct LargeTestdata {
+	int value;
+	long long pos;
+	char payload[48];
+};
+
+struct LargeTestdataKey {
+	typedef int result_type;
+	int operator() (const LargeTestdata& t) const {
+		return t.value;
+	}
+};
+
 // testing also if output is permutation of input
 void test2(long long size,int cores, int workpakets, int type) {
 	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Cores: " << cores << ", Workpakets: " << workpakets << ", Type: ";
@@ -169,6 +192,1024 @@ void test(long long size, int cores, int workpakets, int type) {
 	}
 }
 
+// testing the indirect sort with (key,index) pairs for large records
+void test_indirect(long long size, int cores, int workpakets, int type) {
+	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Cores: " << cores << ", Workpakets: " << workpakets << ", Type: ";
+	
+	std::vector<LargeTestdata> input(size);
+	long long j = 0;
+	for (std::vector<LargeTestdata>::iterator i = input.begin();i != input.end();i++) {
+		(*i).pos = j++;
+		(*i).value = (type == INPUT_SAME_INT) ? 5 : rand() - RAND_MAX/2;
+		memset((*i).payload, (int)((*i).pos % 128), sizeof((*i).payload));
+	}
+	std::cout << ((type == INPUT_SAME_INT) ? "Indirect All the Same] " : "Indirect Random Ints] ");
+	std::cout.flush();
+	
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToFirst(queue, cores);
+	malms::sort_indirect(input.begin(),input.end(),workpakets,queue,LargeTestdataKey());
+	Scheduler::MaleableScheduler::deleteSingleton();
+	
+	// check order, that each record is complete and that the output is a permutation
+	bool c = true;
+	std::vector<bool> exist(size,false);
+	for (long long i = 0; i < size; i++) {
+		if (i > 0 && input[i].value < input[i-1].value) c = false;
+		if (exist[input[i].pos]) c = false;
+		exist[input[i].pos] = true;
+		if (input[i].payload[47] != (char)(input[i].pos % 128)) c = false;
+	}
+	
+	if (c) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+// testing the radix run formation for signed, 64 bit and floating point values
+template<typename _ValueType>
+void test_radix(long long size, int cores, int workpakets, const char* name) {
+	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Cores: " << cores << ", Workpakets: " << workpakets << ", Type: ";
+	std::cout << "Random " << name << "] ";
+	std::cout.flush();
+	
+	std::vector<_ValueType> input(size);
+	for (typename std::vector<_ValueType>::iterator i = input.begin();i != input.end();i++) {
+		// random values with both signs and all bytes used
+		*i = static_cast<_ValueType>((long long)rand() * (long long)rand() - (long long)RAND_MAX * (RAND_MAX/2)) / static_cast<_ValueType>(3);
+	}
+	std::vector<_ValueType> correct(input);
+	std::sort(correct.begin(),correct.end());
+	
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToFirst(queue, cores);
+	malms::sort(input.begin(),input.end(),workpakets,queue);
+	Scheduler::MaleableScheduler::deleteSingleton();
+	
+	bool c = std::equal(input.begin(),input.end(),correct.begin());
+	if (c) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+// testing repeated sorts reusing one SortContext, with growing and shrinking sizes
+void test_context(long long size, int cores, int workpakets, int repeat) {
+	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Cores: " << cores << ", Workpakets: " << workpakets << ", Type: ";
+	std::cout << "Reused Context x" << repeat << "] ";
+	std::cout.flush();
+	
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToFirst(queue, cores);
+	
+	malms::SortContext<std::vector<int>::iterator> context;
+	bool c = true;
+	for (int r = 0; r < repeat; r++) {
+		// vary size and number of pakets, so that the context has to grow
+		// and is reused for smaller sorts
+		long long n = size / (1 + (r % 3));
+		int k = workpakets / (1 + (r % 2));
+		if (k == 0) k = 1;
+		std::vector<int> input(n);
+		std::generate(input.begin(),input.end(),rand);
+		std::vector<int> correct(input);
+		std::sort(correct.begin(),correct.end());
+		malms::sort(input.begin(),input.end(),k,queue,context);
+		c = c && std::equal(input.begin(),input.end(),correct.begin());
+	}
+	Scheduler::MaleableScheduler::deleteSingleton();
+	
+	if (c) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+// testing the stable sort: equal values have to keep the order of their positions
+void test_stable(long long size, int cores, int workpakets, int type) {
+	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Cores: " << cores << ", Workpakets: " << workpakets << ", Type: ";
+	
+	std::vector<Testdata> input(size);
+	long long j = 0;
+	for (std::vector<Testdata>::iterator i = input.begin();i != input.end();i++) {
+		(*i).pos = j++;
+		(*i).value = (type == INPUT_SAME_INT) ? 5 : rand() % 100;
+	}
+	if (type == INPUT_SAME_INT) {
+		std::cout << "Stable All the Same] ";
+	} else {
+		std::cout << "Stable Duplicate Ints] ";
+	}
+	std::cout.flush();
+	
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToFirst(queue, cores);
+	malms::stable_sort(input.begin(),input.end(),workpakets,queue);
+	Scheduler::MaleableScheduler::deleteSingleton();
+	
+	bool c = true;
+	for (long long i = 1; i < size; i++) {
+		if (input[i] < input[i-1] || (input[i] == input[i-1] && input[i].pos < input[i-1].pos)) {
+			c = false;
+			break;
+		}
+	}
+	
+	if (c) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+// testing the memory-bounded sort, also if output is permutation of input
+void test_bounded(long long size, int cores, int workpakets, long long extra, int type) {
+	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Cores: " << cores << ", Workpakets: " << workpakets << ", Type: ";
+	
+	std::vector<Testdata> input(size);
+	long long j = 0;
+	for (std::vector<Testdata>::iterator i = input.begin();i != input.end();i++) {
+		(*i).pos = j++;
+		(*i).value = (type == INPUT_SAME_INT) ? 5 : rand();
+	}
+	if (type == INPUT_SAME_INT) {
+		std::cout << "Bounded All the Same, Extra " << extra << "] ";
+	} else {
+		std::cout << "Bounded Random Ints, Extra " << extra << "] ";
+	}
+	std::cout.flush();
+	
+	std::vector<Testdata> correct(input);
+	std::sort(correct.begin(),correct.end());
+	
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToFirst(queue, cores);
+	malms::sort_bounded(input.begin(),input.end(),workpakets,queue,extra);
+	Scheduler::MaleableScheduler::deleteSingleton();
+	
+	bool c = std::equal(input.begin(),input.end(),correct.begin());
+	std::vector<bool> exist(size,false);
+	for (std::vector<Testdata>::iterator i = input.begin();c && i != input.end();i++) {
+		c = !exist[(*i).pos];
+		exist[(*i).pos] = true;
+	}
+	
+	if (c) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+// testing the file sort, sorting a file of random ints within the memory limit
+void test_external(long long size, int cores, int workpakets, long long memory) {
+	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Cores: " << cores << ", Workpakets: " << workpakets << ", Type: ";
+	std::cout << "File Random Ints, Memory " << memory << "] ";
+	std::cout.flush();
+	
+	const char* input_name = "testmergesort_input.data";
+	const char* output_name = "testmergesort_output.data";
+	std::vector<int> input(size);
+	std::generate(input.begin(),input.end(),rand);
+	std::ofstream input_file(input_name, std::ios::out | std::ios::binary | std::ios::trunc);
+	input_file.write(reinterpret_cast<char*>(&input[0]), size*sizeof(int));
+	input_file.close();
+	std::sort(input.begin(),input.end());
+	
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToFirst(queue, cores);
+	bool c = malms::sort_file<int>(input_name,output_name,workpakets,queue,memory);
+	Scheduler::MaleableScheduler::deleteSingleton();
+	
+	std::vector<int> output(size);
+	std::ifstream output_file(output_name, std::ios::in | std::ios::binary);
+	output_file.read(reinterpret_cast<char*>(&output[0]), size*sizeof(int));
+	c = c && output_file.gcount() == static_cast<std::streamsize>(size*sizeof(int));
+	output_file.close();
+	remove(input_name);
+	remove(output_name);
+	c = c && std::equal(output.begin(),output.end(),input.begin());
+	
+	if (c) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+// testing the sort with each NUMA placement policy of the context
+void test_numa(long long size, int cores, int workpakets, Scheduler::Numa::Policy policy) {
+	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Cores: " << cores << ", Workpakets: " << workpakets << ", Type: ";
+	std::cout << "NUMA Policy " << policy << "] ";
+	std::cout.flush();
+	
+	std::vector<int> input(size);
+	std::generate(input.begin(),input.end(),rand);
+	std::vector<int> correct(input);
+	std::sort(correct.begin(),correct.end());
+	
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToFirst(queue, cores);
+	malms::SortContext<std::vector<int>::iterator> context;
+	context.setNumaPolicy(policy);
+	malms::sort(input.begin(),input.end(),workpakets,queue,context);
+	Scheduler::MaleableScheduler::deleteSingleton();
+	
+	if (std::equal(input.begin(),input.end(),correct.begin())) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+// testing the sort with each allocation policy of the run buffer, sorting a
+// smaller and a larger sequence to exercise the reuse and the prefaulting
+void test_allocation(long long size, int cores, int workpakets, malms::AllocationPolicy policy) {
+	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Cores: " << cores << ", Workpakets: " << workpakets << ", Type: ";
+	std::cout << "Allocation Policy " << policy << "] ";
+	std::cout.flush();
+	
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToFirst(queue, cores);
+	malms::SortContext<std::vector<int>::iterator> context;
+	context.setAllocationPolicy(policy);
+	bool ok = true;
+	for (long long n = size/3; n <= size; n += size - size/3) {
+		std::vector<int> input(n);
+		std::generate(input.begin(),input.end(),rand);
+		std::vector<int> correct(input);
+		std::sort(correct.begin(),correct.end());
+		malms::sort(input.begin(),input.end(),workpakets,queue,context);
+		ok = ok && std::equal(input.begin(),input.end(),correct.begin());
+	}
+	Scheduler::MaleableScheduler::deleteSingleton();
+	
+	if (ok) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+// testing the sample sort, with recursion into large buckets
+void test_sample(long long size, int cores, int workpakets, int type) {
+	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Cores: " << cores << ", Workpakets: " << workpakets << ", Type: ";
+	
+	std::vector<int> input(size);
+	if (type == INPUT_RANDOM_INT) {
+		std::generate(input.begin(),input.end(),rand);
+		std::cout << "Sample Sort Random Ints] ";
+	} else if (type == INPUT_SORTED_INT) {
+		for (long long i = 0; i < size; i++) input[i] = i;
+		std::cout << "Sample Sort Sorted Ints] ";
+	} else if (type == INPUT_HALF_SAME_INT) {
+		// one frequent key, which gets an equality bucket
+		for (long long i = 0; i < size; i++) input[i] = (i % 2 == 0) ? 12345 : rand();
+		std::cout << "Sample Sort Half One Value] ";
+	} else {
+		// few distinct values, so that buckets cannot be split further
+		for (long long i = 0; i < size; i++) input[i] = rand() % 3;
+		std::cout << "Sample Sort Three Values] ";
+	}
+	std::cout.flush();
+	std::vector<int> correct(input);
+	std::sort(correct.begin(),correct.end());
+	
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToFirst(queue, cores);
+	malms::sample_sort(input.begin(),input.end(),workpakets,queue);
+	Scheduler::MaleableScheduler::deleteSingleton();
+	
+	if (std::equal(input.begin(),input.end(),correct.begin())) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+// a record that is aligned to less than its size
+struct MergeRecord {
+	long long key;
+	long long pos;
+	bool operator<(const MergeRecord& other) const {
+		return key < other.key;
+	}
+};
+
+// testing the multiway merge directly, with empty runs and keys equal to the
+// sentinel of the loser tree, and streamed into an output that is not
+// aligned to the size of its elements
+void test_merge(long long size, unsigned int k) {
+	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Runs: " << k << ", Type: Merge with Max Ints] ";
+	std::cout.flush();
+	
+	std::vector<int> input(size);
+	for (long long i = 0; i < size; i++) {
+		input[i] = (rand() % 4 == 0) ? std::numeric_limits<int>::max() : rand() % 1000;
+	}
+	std::vector<std::vector<int>::iterator> lower(k), upper(k);
+	for (unsigned int j = 0; j < k; j++) {
+		// every third run is empty
+		lower[j] = input.begin() + ((j % 3 == 0) ? size*(j+1)/k : size*j/k);
+		upper[j] = input.begin() + size*(j+1)/k;
+		std::sort(input.begin() + size*j/k, upper[j]);
+	}
+	std::vector<int> correct;
+	for (unsigned int j = 0; j < k; j++) {
+		correct.insert(correct.end(), lower[j], upper[j]);
+	}
+	std::sort(correct.begin(),correct.end());
+	
+	std::vector<MergeRecord> records(size);
+	std::vector<MergeRecord*> record_lower(k), record_upper(k);
+	for (long long i = 0; i < size; i++) {
+		records[i].key = input[i];
+		records[i].pos = i;
+	}
+	for (unsigned int j = 0; j < k; j++) {
+		record_lower[j] = &records[0] + (lower[j] - input.begin());
+		record_upper[j] = &records[0] + (upper[j] - input.begin());
+	}
+	
+	std::vector<int> output(correct.size());
+	malms::Merging::multiwaymerge(&lower[0], &upper[0], output.begin(), k);
+	bool ok = std::equal(output.begin(),output.end(),correct.begin());
+	
+	// the outputs start 8 bytes after a multiple of 16, between guard words
+	std::vector<long long> raw(4*correct.size() + 8, -1);
+	std::size_t first = (reinterpret_cast<uintptr_t>(&raw[1]) % 16 == 8) ? 1 : 2;
+	MergeRecord* merged = reinterpret_cast<MergeRecord*>(&raw[first]);
+	MergeRecord* copied = merged + correct.size() + 1;
+	malms::Memory::set_stream_store_threshold(0);
+	malms::Merging::multiwaymerge(&record_lower[0], &record_upper[0], merged, k);
+	malms::Memory::stream_copy(merged, merged + correct.size(), copied);
+	malms::Memory::set_stream_store_threshold(STREAM_STORE_THRESHOLD);
+	for (std::size_t i = 0; ok && i < correct.size(); i++) {
+		ok = merged[i].key == correct[i] && copied[i].key == correct[i];
+	}
+	ok = ok && raw[first-1] == -1 && raw[first + 2*correct.size()] == -1 && raw[first + 2*correct.size() + 1] == -1 && raw[first + 4*correct.size() + 2] == -1;
+	
+	if (ok) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+// testing the self-tuning sort (workpakets 0) or the buffered merge
+void test_tuned(long long size, int cores, int workpakets, bool stable) {
+	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Cores: " << cores << ", Workpakets: " << workpakets << ", Type: ";
+	
+	std::vector<Testdata> input(size);
+	long long j = 0;
+	for (std::vector<Testdata>::iterator i = input.begin();i != input.end();i++) {
+		(*i).pos = j++;
+		(*i).value = rand() % 1000;
+	}
+	std::cout << (stable ? "Stable " : "") << ((workpakets == 0) ? "Tuned] " : "Buffered Merge] ");
+	std::cout.flush();
+	std::vector<Testdata> correct(input);
+	std::stable_sort(correct.begin(),correct.end());
+	
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToFirst(queue, cores);
+	if (workpakets == 0) {
+		if (stable) {
+			malms::stable_sort(input.begin(),input.end(),queue);
+		} else {
+			malms::sort(input.begin(),input.end(),queue);
+		}
+	} else {
+		malms::SortContext<std::vector<Testdata>::iterator,true> context;
+		context.setBufferedMerge(true);
+		malms::sort(input.begin(),input.end(),workpakets,queue,context);
+	}
+	Scheduler::MaleableScheduler::deleteSingleton();
+	
+	bool ok = true;
+	for (long long i = 0; i < size; i++) {
+		if (input[i].value != correct[i].value || ((stable || workpakets != 0) && input[i].pos != correct[i].pos)) {
+			ok = false;
+			break;
+		}
+	}
+	if (ok) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+// a paket of the work queue test, pushing its two children in a tree of pakets
+class TreeTestPaket : public Scheduler::WorkQueueItem {
+	public:
+		std::vector<TreeTestPaket>* pakets;
+		Scheduler::WorkQueue* queue;
+		long long index;
+		int runs;
+		void operator()() {
+			runs++;
+			long long n = pakets->size();
+			TreeTestPaket* children[2];
+			int c = 0;
+			if (2*index + 1 < n) children[c++] = &(*pakets)[2*index + 1];
+			if (2*index + 2 < n) children[c++] = &(*pakets)[2*index + 2];
+			// the first paket of each level pushes its children at once
+			if (index % 2 == 0) {
+				queue->push(children, c);
+			} else {
+				for (int i = 0; i < c; i++) queue->push(children[i]);
+			}
+		}
+};
+
+// testing the work stealing queue: pakets pushing pakets, a bulk push and
+// blocked cores, each paket has to run exactly once before blockuntildone returns
+void test_workqueue(long long size, int cores, int blocked) {
+	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Cores: " << cores << ", Blocked: " << blocked << ", Type: WorkQueue] ";
+	std::cout.flush();
+	
+	std::vector<TreeTestPaket> tree(size);
+	std::vector<TreeTestPaket> flat(size);
+	std::vector<TreeTestPaket*> flat_items(size);
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	for (long long i = 0; i < size; i++) {
+		tree[i].pakets = &tree;
+		tree[i].queue = queue;
+		tree[i].index = i;
+		tree[i].runs = 0;
+		// without children
+		flat[i] = tree[i];
+		flat[i].pakets = &flat;
+		flat[i].index = size;
+		flat_items[i] = &flat[i];
+	}
+	sched->scheduleToFirst(queue, cores);
+	
+	// block the first cores through the signal thread, they are unblocked
+	// again while the pakets are running, in case these are all the cores
+	union sigval core;
+	for (int i = 0; i < blocked; i++) {
+		core.sival_int = i;
+		sigqueue(getpid(), SIGBLOCKCORE, core);
+	}
+	if (size > 0) {
+		queue->push(&tree[0]);
+		queue->push(&flat_items[0], size);
+	}
+	boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+	for (int i = 0; i < blocked; i++) {
+		core.sival_int = i;
+		sigqueue(getpid(), SIGUNBLOCKCORE, core);
+	}
+	queue->blockuntildone();
+	bool ok = queue->pendingJobs() == 0;
+	Scheduler::MaleableScheduler::deleteSingleton();
+	
+	for (long long i = 0; i < size; i++) {
+		if (tree[i].runs != 1 || flat[i].runs != 1) ok = false;
+	}
+	// an item takes at most WORKQUEUE_MAX_SUCCESSORS successors
+	std::vector<TreeTestPaket> items(WORKQUEUE_MAX_SUCCESSORS + 2);
+	bool thrown = false;
+	try {
+		for (int i = 1; i < WORKQUEUE_MAX_SUCCESSORS + 2; i++) items[i].dependsOn(&items[0]);
+	} catch (std::length_error&) {
+		thrown = true;
+	}
+	ok = ok && thrown && items.back().unresolvedDependencies() == 0;
+	if (ok) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+// testing the sort with its phases connected by dependencies or separated
+void test_pipelined(long long size, int cores, int workpakets, bool pipelined) {
+	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Cores: " << cores << ", Workpakets: " << workpakets << ", Type: ";
+	std::cout << (pipelined ? "Pipelined] " : "Phased] ");
+	std::cout.flush();
+	
+	std::vector<int> input(size);
+	for (long long i = 0; i < size; i++) {
+		input[i] = rand();
+	}
+	std::vector<int> correct(input);
+	std::sort(correct.begin(),correct.end());
+	
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToFirst(queue, cores);
+	malms::SortContext<std::vector<int>::iterator> context;
+	context.setPipelined(pipelined);
+	// twice, so that the pakets of the reused context are connected again
+	malms::sort(input.begin(),input.end(),workpakets,queue,context);
+	bool ok = std::equal(input.begin(),input.end(),correct.begin());
+	std::random_shuffle(input.begin(),input.end());
+	malms::sort(input.begin(),input.end(),workpakets,queue,context);
+	ok = ok && std::equal(input.begin(),input.end(),correct.begin()) && queue->pendingJobs() == 0;
+	Scheduler::MaleableScheduler::deleteSingleton();
+	
+	if (ok) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+// unblocks the core after a while, from another thread
+void unblock_core_later(int core) {
+	boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+	union sigval value;
+	value.sival_int = core;
+	sigqueue(getpid(), SIGUNBLOCKCORE, value);
+}
+
+// testing the helping wait: the calling thread runs pakets, unless it is
+// pinned to a blocked core
+void test_helping(long long size, int cores, int workpakets, bool pinned_blocked) {
+	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Cores: " << cores << ", Workpakets: " << workpakets << ", Type: ";
+	std::cout << (pinned_blocked ? "Helping Wait on Blocked Core] " : "Helping Wait] ");
+	std::cout.flush();
+	
+	std::vector<int> input(size);
+	for (long long i = 0; i < size; i++) {
+		input[i] = rand();
+	}
+	std::vector<int> correct(input);
+	std::sort(correct.begin(),correct.end());
+	
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToFirst(queue, cores);
+	cpu_set_t old_set;
+	sched_getaffinity(0, sizeof(cpu_set_t), &old_set);
+	boost::thread* unblocker = NULL;
+	if (pinned_blocked) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(0, &set);
+		sched_setaffinity(0, sizeof(cpu_set_t), &set);
+		union sigval value;
+		value.sival_int = 0;
+		sigqueue(getpid(), SIGBLOCKCORE, value);
+		unblocker = new boost::thread(&unblock_core_later, 0);
+	}
+	malms::SortContext<std::vector<int>::iterator> context;
+	context.setHelpingWait(true);
+	malms::sort(input.begin(),input.end(),workpakets,queue,context);
+	if (unblocker != NULL) {
+		unblocker->join();
+		delete unblocker;
+	}
+	sched_setaffinity(0, sizeof(cpu_set_t), &old_set);
+	bool ok = std::equal(input.begin(),input.end(),correct.begin()) && queue->pendingJobs() == 0;
+	Scheduler::MaleableScheduler::deleteSingleton();
+	
+	if (ok) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+// asks worker 0 of the queue to split its running paket every millisecond,
+// like the scheduler does for a blocked core, until done is set
+void yield_until_done(Scheduler::WorkQueue* queue, volatile bool* done) {
+	while (!*done) {
+		queue->yieldWorker(0);
+		boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+	}
+}
+
+// testing merge and copy pakets that are split while they run: the parts have
+// to write the same output, and a paket depending on the merge has to wait for
+// all of its parts
+void test_split_running(long long size, int cores, int workpakets) {
+	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Cores: " << cores << ", Workpakets: " << workpakets << ", Type: Split Running] ";
+	std::cout.flush();
+	
+	std::vector<int> input(size);
+	for (long long i = 0; i < size; i++) {
+		input[i] = rand();
+	}
+	std::vector<int> correct(input);
+	std::sort(correct.begin(),correct.end());
+	
+	// the sequences to merge
+	std::vector<int> runs(input);
+	std::vector<int*> lower(workpakets);
+	std::vector<int*> upper(workpakets);
+	for (int i = 0; i < workpakets; i++) {
+		lower[i] = &runs[0] + size * i / workpakets;
+		upper[i] = &runs[0] + size * (i+1) / workpakets;
+		std::sort(lower[i], upper[i]);
+	}
+	std::vector<int> merged(size);
+	std::vector<int> copied(size);
+	std::vector<int> sorted(input);
+	
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToFirst(queue, cores);
+	volatile bool done = false;
+	boost::thread yielder(&yield_until_done, queue, &done);
+	
+	malms::MergePaket<int*,std::vector<int>::iterator> merge(&lower[0], &upper[0], merged.begin(), workpakets);
+	merge.setSplittable(true);
+	malms::CopyPaket<std::vector<int>::iterator,std::vector<int>::iterator> copy(merged.begin(), merged.end(), copied.begin());
+	copy.setSplittable(true);
+	copy.dependsOn(&merge);
+	queue->push(&merge);
+	queue->blockuntildone();
+	// and a sort with splittable merge pakets
+	malms::SortContext<std::vector<int>::iterator> context;
+	malms::sort(sorted.begin(),sorted.end(),workpakets,queue,context);
+	done = true;
+	yielder.join();
+	
+	bool ok = std::equal(merged.begin(),merged.end(),correct.begin());
+	ok = ok && std::equal(copied.begin(),copied.end(),correct.begin());
+	ok = ok && std::equal(sorted.begin(),sorted.end(),correct.begin());
+	ok = ok && queue->splitJobs() > 0 && queue->pendingJobs() == 0;
+	Scheduler::MaleableScheduler::deleteSingleton();
+	// the buffered merge is never split
+	merge.setBuffered(true);
+	ok = ok && !merge.isSplittable();
+	merge.setSplittable(true);
+	ok = ok && !merge.isSplittable();
+	
+	if (ok) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+// sorts the input with its own job of the given weight, which is deleted after
+void sort_as_job(std::vector<int>* input, unsigned int weight, int workpakets) {
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob(weight);
+	malms::sort(input->begin(),input->end(),workpakets,queue);
+	sched->deleteJob(queue);
+}
+
+// testing fair share: the shares of the cores, the cores of the jobs after they
+// are created, and concurrent sorts with their own jobs, which are deleted
+void test_fair_share(long long size, int jobs, int workpakets) {
+	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Jobs: " << jobs << ", Workpakets: " << workpakets << ", Type: Fair Share] ";
+	std::cout.flush();
+	
+	// weights 3:1 on 8 cores, 5:1:1 on 3 cores with at least one core each,
+	// and 1:1:1 on 2 cores, where the last job gets none
+	std::vector<unsigned int> w(2);
+	w[0] = 3; w[1] = 1;
+	std::vector<int> shares = Scheduler::MaleableScheduler::fairShares(w, 8);
+	bool ok = shares[0] == 6 && shares[1] == 2;
+	w.assign(3, 1);
+	w[0] = 5;
+	shares = Scheduler::MaleableScheduler::fairShares(w, 3);
+	ok = ok && shares[0] == 1 && shares[1] == 1 && shares[2] == 1;
+	w.assign(3, 1);
+	shares = Scheduler::MaleableScheduler::fairShares(w, 2);
+	ok = ok && shares[0] == 1 && shares[1] == 1 && shares[2] == 0;
+	
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	sched->setFairShare(true);
+	int p = boost::thread::hardware_concurrency();
+	Scheduler::WorkQueue* first = sched->newJob(1);
+	ok = ok && sched->coresOfJob(first) == p;
+	Scheduler::WorkQueue* second = sched->newJob(1);
+	w.assign(2, 1);
+	shares = Scheduler::MaleableScheduler::fairShares(w, p);
+	ok = ok && sched->coresOfJob(first) == shares[0] && sched->coresOfJob(second) == shares[1];
+	sched->deleteJob(first);
+	ok = ok && sched->coresOfJob(second) == p;
+	sched->deleteJob(second);
+	
+	std::vector<std::vector<int> > inputs(jobs, std::vector<int>(size));
+	std::vector<boost::thread*> threads(jobs);
+	for (int j = 0; j < jobs; j++) {
+		std::generate(inputs[j].begin(), inputs[j].end(), rand);
+		threads[j] = new boost::thread(&sort_as_job, &inputs[j], j+1, workpakets);
+	}
+	for (int j = 0; j < jobs; j++) {
+		threads[j]->join();
+		delete threads[j];
+		for (long long i = 1; i < size; i++) {
+			if (inputs[j][i] < inputs[j][i-1]) ok = false;
+		}
+	}
+	Scheduler::MaleableScheduler::deleteSingleton();
+	
+	if (ok) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+double seconds_now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// a paket spinning for the given microseconds
+class SpinTestPaket : public Scheduler::WorkQueueItem {
+	public:
+		long micros;
+		SpinTestPaket() : micros(0) {
+		}
+		void operator()() {
+			double end = seconds_now() + micros * 1e-6;
+			while (seconds_now() < end) {
+			}
+		}
+};
+
+// pushes the spinning pakets into the queue
+void push_spinning(std::vector<SpinTestPaket>& pakets, long micros, Scheduler::WorkQueue* queue) {
+	for (std::size_t i = 0; i < pakets.size(); i++) {
+		pakets[i].micros = micros;
+		queue->push(&pakets[i]);
+	}
+}
+
+// testing priority classes and deadlines: a high priority job arriving
+// later takes the cores of a background job and is done first, and a job with
+// a deadline is done in time although a high priority job competes
+void test_priorities(int pakets) {
+	std::cout << "Testcase # " << ++testcase << ": [Pakets: " << pakets << ", Type: Priorities and Deadlines] ";
+	std::cout.flush();
+	
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	sched->setFairShare(true);
+	int p = boost::thread::hardware_concurrency();
+	std::vector<SpinTestPaket> low(p * pakets);
+	std::vector<SpinTestPaket> high(p * pakets / 10);
+	std::vector<SpinTestPaket> high_again(p * pakets);
+	std::vector<SpinTestPaket> timed(p * pakets / 10);
+	
+	Scheduler::WorkQueue* low_job = sched->newJob(1, Scheduler::PRIORITY_BACKGROUND);
+	push_spinning(low, 1000, low_job);
+	boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+	Scheduler::WorkQueue* high_job = sched->newJob(1, Scheduler::PRIORITY_HIGH);
+	push_spinning(high, 1000, high_job);
+	high_job->blockuntildone();
+	bool ok = low_job->pendingJobs() > 0;
+	
+	// the deadline leaves time for ten times the work of the job
+	Scheduler::WorkQueue* timed_job = sched->newJob(1, Scheduler::PRIORITY_NORMAL);
+	double deadline = 1e-3 * pakets;
+	push_spinning(high_again, 1000, high_job);
+	double start = seconds_now();
+	sched->setJobDeadline(timed_job, deadline);
+	push_spinning(timed, 1000, timed_job);
+	timed_job->blockuntildone();
+	ok = ok && seconds_now() - start < deadline;
+	
+	high_job->blockuntildone();
+	low_job->blockuntildone();
+	ok = ok && low_job->pendingJobs() == 0 && high_job->pendingJobs() == 0;
+	sched->deleteJob(low_job);
+	sched->deleteJob(high_job);
+	sched->deleteJob(timed_job);
+	Scheduler::MaleableScheduler::deleteSingleton();
+	
+	if (ok) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+// makes all cores available after a while, by a control message or the API
+void unblock_all_later(bool socket) {
+	boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	int p = boost::thread::hardware_concurrency();
+	if (socket) {
+		std::ostringstream message;
+		message << "unblock 0-" << p - 1 << "\n";
+		Scheduler::CoreControl::send(Scheduler::CoreControl::socket_path(getpid()), message.str());
+	} else {
+		sched->setAvailableCores(std::vector<bool>(p, true));
+	}
+}
+
+// testing the updates of the available cores: all cores are blocked at once
+// and unblocked again while the sort waits for them
+void test_core_control(long long size, int workpakets, bool socket) {
+	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Workpakets: " << workpakets << ", Type: ";
+	std::cout << (socket ? "Core Control Socket] " : "Core Control API] ");
+	std::cout.flush();
+	
+	// the messages are applied as a whole or not at all
+	std::vector<bool> available(4, true);
+	bool ok = Scheduler::CoreControl::apply("block 0-2\nunblock 1\n", available);
+	ok = ok && !available[0] && available[1] && !available[2] && available[3];
+	ok = ok && !Scheduler::CoreControl::apply("set 3\nblock x\n", available) && available[1];
+	ok = ok && Scheduler::CoreControl::apply("set 1,3", available) && !available[0] && available[1] && available[3];
+	// ranges beyond the cores are clamped, and cost nothing
+	ok = ok && Scheduler::CoreControl::apply("block 2-9223372036854775807\nunblock 9-2000000000\n", available);
+	ok = ok && !available[0] && available[1] && !available[2] && !available[3];
+	
+	std::vector<int> input(size);
+	for (long long i = 0; i < size; i++) {
+		input[i] = rand();
+	}
+	std::vector<int> correct(input);
+	std::sort(correct.begin(),correct.end());
+	
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	int p = boost::thread::hardware_concurrency();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToAll(queue);
+	if (socket) {
+		ok = ok && sched->startControlSocket();
+		ok = ok && Scheduler::CoreControl::send(Scheduler::CoreControl::socket_path(getpid()), "set\n");
+		// the message is applied by the thread of the socket
+		for (int i = 0; i < 1000 && sched->coresOfJob(queue) > 0; i++) {
+			boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+		}
+	} else {
+		sched->setAvailableCores(0ULL);
+	}
+	ok = ok && sched->coresOfJob(queue) == 0;
+	boost::thread unblocker(&unblock_all_later, socket);
+	malms::sort(input.begin(),input.end(),workpakets,queue);
+	unblocker.join();
+	ok = ok && std::equal(input.begin(),input.end(),correct.begin()) && sched->coresOfJob(queue) == p;
+	if (socket) {
+		sched->stopControlSocket();
+		ok = ok && access(Scheduler::CoreControl::socket_path(getpid()).c_str(), F_OK) != 0;
+	}
+	Scheduler::MaleableScheduler::deleteSingleton();
+	
+	if (ok) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+// a foreign load spinning on the core until stop is set
+void spin_on_core(int core, volatile bool* stop) {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core, &set);
+	sched_setaffinity(0, sizeof(cpu_set_t), &set);
+	while (!*stop) {
+	}
+}
+
+// testing the contention monitor: a core with a foreign load is blocked,
+// unless it is the only core, and unblocked again when the load is gone
+void test_contention(int period) {
+	std::cout << "Testcase # " << ++testcase << ": [Period: " << period << " ms, Type: Contention Monitor] ";
+	std::cout.flush();
+	
+	// the hysteresis of a single core
+	Scheduler::Contention::Detector detector;
+	bool ok = !detector.sample(0.9) && detector.sample(0.9) && detector.sample(0.2);
+	ok = ok && detector.sample(0.05) && !detector.sample(0.05) && !detector.sample(0.2);
+	
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	int p = boost::thread::hardware_concurrency();
+	int core = p - 1;
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToAll(queue);
+	std::vector<SpinTestPaket> pakets(100 * p);
+	push_spinning(pakets, 1000, queue);
+	ok = ok && sched->startContentionMonitor(period);
+	volatile bool stop = false;
+	boost::thread load(&spin_on_core, core, &stop);
+	for (int i = 0; i < 2000 && !sched->contendedCore(core); i++) {
+		boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+	}
+	ok = ok && sched->contendedCore(core) && sched->coreAvailable(core) == (p == 1);
+	stop = true;
+	load.join();
+	for (int i = 0; i < 2000 && sched->contendedCore(core); i++) {
+		boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+	}
+	ok = ok && sched->coreAvailable(core) && !sched->contendedCore(core);
+	queue->blockuntildone();
+	sched->stopContentionMonitor();
+	ok = ok && queue->pendingJobs() == 0 && sched->coresOfJob(queue) == p;
+	Scheduler::MaleableScheduler::deleteSingleton();
+	
+	if (ok) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
+// checks the allowed CPUs every millisecond, until done is set
+void update_cpus_until_done(volatile bool* done) {
+	while (!*done) {
+		Scheduler::MaleableScheduler::singleton()->updateCpus();
+		boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+	}
+}
+
+// testing the threads on the allowed CPUs: the assignment keeps the CPUs of
+// the threads and parks the threads without one, each allowed CPU has a
+// thread, and checking the CPUs while sorting changes nothing
+void test_cpuset(long long size, int workpakets) {
+	std::cout << "Testcase # " << ++testcase << ": [Size: " << size << ", Workpakets: " << workpakets << ", Type: CPU Set] ";
+	std::cout.flush();
+	
+	std::vector<int> current;
+	current.push_back(0);
+	current.push_back(1);
+	current.push_back(-1);
+	current.push_back(-1);
+	std::vector<int> cpus;
+	cpus.push_back(1);
+	cpus.push_back(2);
+	cpus.push_back(3);
+	std::vector<int> assigned = Scheduler::Cpuset::assign(current, cpus);
+	bool ok = assigned[0] == 2 && assigned[1] == 1 && assigned[2] == 3 && assigned[3] == -1;
+	cpus.resize(1);
+	assigned = Scheduler::Cpuset::assign(assigned, cpus);
+	ok = ok && assigned[0] == -1 && assigned[1] == 1 && assigned[2] == -1 && assigned[3] == -1;
+	
+	std::vector<int> input(size);
+	for (long long i = 0; i < size; i++) {
+		input[i] = rand();
+	}
+	std::vector<int> correct(input);
+	std::sort(correct.begin(),correct.end());
+	
+	Scheduler::MaleableScheduler * sched = Scheduler::MaleableScheduler::singleton();
+	std::vector<int> allowed = Scheduler::Cpuset::allowed(Scheduler::Cpuset::cgroup_file(), Scheduler::Cpuset::affinity());
+	int p = boost::thread::hardware_concurrency();
+	std::vector<int> pinned;
+	for (int i = 0; i < p; i++) {
+		if (sched->cpuOfCore(i) >= 0) pinned.push_back(sched->cpuOfCore(i));
+	}
+	std::sort(pinned.begin(), pinned.end());
+	ok = ok && pinned == allowed;
+	
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToAll(queue);
+	volatile bool done = false;
+	boost::thread updater(&update_cpus_until_done, &done);
+	malms::sort(input.begin(),input.end(),workpakets,queue);
+	done = true;
+	updater.join();
+	ok = ok && std::equal(input.begin(),input.end(),correct.begin()) && sched->coresOfJob(queue) == static_cast<int>(allowed.size());
+	for (int i = 0; i < p; i++) {
+		if (sched->cpuOfCore(i) >= 0 && !std::binary_search(pinned.begin(), pinned.end(), sched->cpuOfCore(i))) ok = false;
+	}
+	Scheduler::MaleableScheduler::deleteSingleton();
+	
+	if (ok) {
+		std::cout << "\t\tOK" << std::endl;
+	} else {
+		std::cout << "\t\tFAIL" << std::endl;
+		errors++;
+	}
+}
+
 int main() {
 	test(1000,1,4,INPUT_RANDOM_INT);
 	
@@ -206,6 +1247,72 @@ int main() {
 	
 	test(100000000,3,100,INPUT_RANDOM_INT);
 	
+	// many pakets (bisection of the splitter rows)
+	test(300000,4,1000,INPUT_RANDOM_INT);
+	test(300000,4,700,INPUT_SAME_INT);
+	
+	// test the loser tree merge
+	test_merge(10000,5);
+	test_merge(100000,64);
+	test_merge(3000,1000);
+	
+	// test the merge kernels for few pakets
+	test_radix<int>(100001,2,2,"Signed Ints");
+	test_radix<long long>(100001,2,2,"Long Longs");
+	test_stable(100000,2,3,INPUT_RANDOM_INT);
+	test_stable(100000,2,5,INPUT_RANDOM_INT);
+	
+	// test streaming stores for all outputs, with unaligned pakets
+	malms::Memory::set_stream_store_threshold(0);
+	test(100003,3,7,INPUT_RANDOM_INT);
+	test_stable(30001,2,5,INPUT_RANDOM_INT);
+	test_radix<long long>(9999,2,3,"Long Longs");
+	test_split_running(1500001,3,7);
+	malms::Memory::set_stream_store_threshold(STREAM_STORE_THRESHOLD);
+	
+	// test the self-tuning sort and the buffered merge
+	test_tuned(100,2,0,false);
+	test_tuned(1000000,4,0,false);
+	test_tuned(300001,3,0,true);
+	test_tuned(100000,4,16,true);
+	
+	// test the work stealing queue
+	test_workqueue(0,2,0);
+	test_workqueue(100000,4,0);
+	test_workqueue(30000,3,2);
+	
+	// test the pipelined and the phased sort
+	test_pipelined(1000000,4,64,true);
+	test_pipelined(100000,3,1,true);
+	test_pipelined(5000,2,300,true);
+	test_pipelined(300000,4,33,false);
+	
+	// test the helping wait
+	test_helping(1000000,4,64,false);
+	test_helping(100000,2,16,true);
+	
+	// test merge and copy pakets split while they run
+	test_split_running(2000000,1,2);
+	test_split_running(1500001,4,5);
+	test_split_running(3000000,2,64);
+	
+	// test fair share between concurrent jobs
+	test_fair_share(100000,3,8);
+	test_fair_share(1000000,5,32);
+	
+	// test priority classes and deadlines of jobs
+	test_priorities(100);
+	
+	// test the updates of the available cores
+	test_core_control(1000000,16,false);
+	test_core_control(300000,8,true);
+	
+	// test the contention monitor
+	test_contention(20);
+	
+	// test the threads on the allowed CPUs
+	test_cpuset(1000000,32);
+	
 	// test sorted and reverse sorted
 	test(1000,2,2,INPUT_SORTED_INT);
 	test(1000,2,2,INPUT_REV_SORTED_INT);
@@ -220,6 +1327,63 @@ int main() {
 	test2(250,1,1,INPUT_SAME_INT);
 	test2(250,1,3,INPUT_SAME_INT);
 	
+	// test radix sorted types
+	test_radix<int>(100000,4,4,"Signed Ints");
+	test_radix<unsigned int>(100000,4,7,"Unsigned Ints");
+	test_radix<long long>(100000,4,4,"Long Longs");
+	test_radix<float>(100000,4,5,"Floats");
+	test_radix<double>(100000,4,4,"Doubles");
+	
+	// test small pakets (vectorized run formation)
+	test_radix<int>(100000,4,64,"Signed Ints");
+	test_radix<long long>(100000,4,64,"Long Longs");
+	test_radix<long>(9999,2,33,"Longs");
+	
+	// test indirect sort
+	test_indirect(0,2,4,INPUT_RANDOM_INT);
+	test_indirect(1000,3,7,INPUT_RANDOM_INT);
+	test_indirect(300000,4,16,INPUT_RANDOM_INT);
+	test_indirect(5000,2,3,INPUT_SAME_INT);
+	
+	// test reusing the workspace
+	test_context(100000,4,8,6);
+	test_context(1000,2,16,4);
+	
+	// test stable sort
+	test_stable(100000,4,8,INPUT_RANDOM_INT);
+	test_stable(3000,3,17,INPUT_SAME_INT);
+	test_stable(250,1,4,INPUT_RANDOM_INT);
+	
+	// test memory-bounded sort
+	test_bounded(1000000,4,8,1000000/8,INPUT_RANDOM_INT);
+	test_bounded(100003,3,13,100003/16,INPUT_RANDOM_INT);
+	test_bounded(20000,2,5,20000/8,INPUT_SAME_INT);
+	test_bounded(1000,2,64,100,INPUT_RANDOM_INT);
+	test_bounded(17,2,4,2,INPUT_RANDOM_INT);
+	test_bounded(5000,2,4,5000,INPUT_RANDOM_INT);
+	
+	// test file sort in memory and external
+	test_external(100000,2,4,1000000);
+	test_external(1000000,4,8,1000000);
+	test_external(300001,3,5,100000);
+	
+	// test NUMA placement policies
+	test_numa(200000,4,8,Scheduler::Numa::FIRST_TOUCH);
+	test_numa(200000,4,8,Scheduler::Numa::LOCAL);
+	test_numa(200000,4,8,Scheduler::Numa::INTERLEAVE);
+	
+	// test allocation policies of the run buffer
+	test_allocation(3000000,4,8,malms::ALLOC_PREFAULT);
+	test_allocation(3000000,4,8,malms::ALLOC_THP);
+	test_allocation(3000000,4,8,malms::ALLOC_HUGETLB);
+	
+	// test sample sort
+	test_sample(1000,2,4,INPUT_RANDOM_INT);
+	test_sample(5000000,4,8,INPUT_RANDOM_INT);
+	test_sample(3000000,3,5,INPUT_SORTED_INT);
+	test_sample(2000000,4,8,INPUT_SAME_INT);
+	test_sample(3000000,4,8,INPUT_HALF_SAME_INT);
+	
 	
 	// output statistics
 	if (errors == 0) {	
@@ -0,0 +1,106 @@
+/*
+ *  Benchmark of the updates of the available cores.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Times how long the scheduler takes to react to an update of
+ *				its available cores, from the update until the job scheduled
+ *				to all cores has the expected number of cores. The updates
+ *				block the first c cores and unblock them again, through
+ *				setAvailableCores(), one message to the control socket and
+ *				one realtime signal per core. Outputs a CSV table with the
+ *				average and maximal latency in microseconds.
+ *
+ *				Usage: benchcorecontrol [c] [repeat]
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <signal.h>
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+
+#include "../malms/threadpool/maleablescheduler.h"
+#include "../malms/threadpool/workqueue.h"
+#include "../malms/threadpool/corecontrol.h"
+
+double seconds_now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Sends the update of the first c cores by the given path.
+ */
+void update(const char* path, int c, bool block) {
+	Scheduler::MaleableScheduler* sched = Scheduler::MaleableScheduler::singleton();
+	std::vector<int> cores;
+	for (int i = 0; i < c; i++) cores.push_back(i);
+	if (strcmp(path, "api") == 0) {
+		std::vector<bool> available(c, !block);
+		sched->setAvailableCores(available);
+	} else if (strcmp(path, "socket") == 0) {
+		Scheduler::CoreControl::send(Scheduler::CoreControl::socket_path(getpid()), Scheduler::CoreControl::line(block ? "block" : "unblock", cores));
+	} else {
+		union sigval value;
+		for (int i = 0; i < c; i++) {
+			value.sival_int = i;
+			sigqueue(getpid(), block ? SIGBLOCKCORE : SIGUNBLOCKCORE, value);
+		}
+	}
+}
+
+/*
+ * Returns the seconds from the update until the job has the given cores.
+ */
+double timeUpdate(const char* path, int c, bool block, Scheduler::WorkQueue* queue, int expected) {
+	Scheduler::MaleableScheduler* sched = Scheduler::MaleableScheduler::singleton();
+	double start = seconds_now();
+	update(path, c, block);
+	while (sched->coresOfJob(queue) != expected) {
+		// lets the threads of the scheduler run on a machine with few cores
+		sched_yield();
+	}
+	return seconds_now() - start;
+}
+
+int main(int argc, char* argv[]) {
+	int p = boost::thread::hardware_concurrency();
+	int c = p;
+	int repeat = 1000;
+	if (argc > 1) c = std::min(atoi(argv[1]), p);
+	if (argc > 2) repeat = atoi(argv[2]);
+
+	Scheduler::MaleableScheduler* sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToAll(queue);
+	sched->startControlSocket();
+
+	const char* paths[] = {"api", "socket", "signals"};
+	std::cout << "Path;Cores;Update;Avg.Latency.us;Max.Latency.us" << std::endl;
+	for (int t = 0; t < 3; t++) {
+		double sum[2] = {0, 0};
+		double max[2] = {0, 0};
+		for (int r = 0; r < repeat; r++) {
+			for (int b = 0; b < 2; b++) {
+				double time = timeUpdate(paths[t], c, b == 0, queue, (b == 0) ? p - c : p);
+				sum[b] += time;
+				max[b] = std::max(max[b], time);
+			}
+		}
+		for (int b = 0; b < 2; b++) {
+			std::cout << paths[t] << ";" << c << ";" << ((b == 0) ? "block" : "unblock") << ";"
+					  << sum[b] * 1e6 / repeat << ";" << max[b] * 1e6 << std::endl;
+		}
+	}
+
+	Scheduler::MaleableScheduler::deleteSingleton();
+	return 0;
+}
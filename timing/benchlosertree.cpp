@@ -0,0 +1,139 @@
+/*
+ *  Benchmark of the Loser Trees.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Times the multiway merge of k sorted runs with the loser tree
+ *				of malms (malms::Merging::multiwaymerge) and with the loser
+ *				tree of the GNU parallel mode, which multiwaymerge used before,
+ *				for k from 2 to maxk, and for k up to SMALL_MERGE_MAX_K also
+ *				with the kernels specialized for small k (small_merge.h).
+ *				Outputs a CSV table with the time per element in ns.
+ *
+ *				Usage: benchlosertree [maxk]
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include <parallel/losertree.h>
+#include "../malms/loser_merge.h"
+#include "../malms/small_merge.h"
+
+// timing
+#include "../utils/cputimer.h"
+
+// number of elements merged per measurement
+#define ELEMENTS_PER_MEASUREMENT (1<<23)
+// the minimum time of this many measurements is reported
+#define REPETITIONS 3
+
+/*
+ * The merge loop of multiwaymerge with the GNU loser tree.
+ */
+template<typename _ValueType>
+void gnuMerge(_ValueType** lower, _ValueType** upper, _ValueType* out, unsigned int k) {
+	std::less<_ValueType> comp;
+	__gnu_parallel::_LoserTree<false,_ValueType,std::less<_ValueType> > lt(k, comp);
+	_ValueType* someElement = NULL;
+	unsigned int sequences_left = 0;
+	for (unsigned int i = 0; i < k; i++) {
+		if (lower[i] != upper[i]) {
+			someElement = lower[i];
+			sequences_left++;
+		}
+	}
+	if (sequences_left == 0) return;
+	for (unsigned int i = 0; i < k; i++) {
+		lt.__insert_start(lower[i] != upper[i] ? *lower[i] : *someElement, i, lower[i] == upper[i]);
+	}
+	lt.__init();
+	while (sequences_left > 0) {
+		unsigned int min_i = lt.__get_min_source();
+		*out++ = *lower[min_i]++;
+		if (lower[min_i] != upper[min_i]) {
+			lt.__delete_min_insert(*lower[min_i], false);
+		} else {
+			lt.__delete_min_insert(*someElement, true);
+			sequences_left--;
+		}
+	}
+}
+
+// the merge implementations
+enum MergeType {MERGE_GNU, MERGE_LOSERTREE, MERGE_SMALL};
+
+/*
+ * Returns the time per element in ns for merging k runs with the given merge
+ * implementation, the minimum over REPETITIONS merges.
+ */
+template<typename _ValueType>
+double timeMerge(MergeType type, unsigned int k) {
+	long n = ELEMENTS_PER_MEASUREMENT;
+	std::vector<_ValueType> input(n);
+	for (long i = 0; i < n; i++) {
+		input[i] = static_cast<_ValueType>((long long)rand() * (long long)rand());
+	}
+	std::vector<_ValueType*> lower(k), upper(k);
+	for (unsigned int j = 0; j < k; j++) {
+		lower[j] = &input[0] + n*j/k;
+		upper[j] = &input[0] + n*(j+1)/k;
+		std::sort(lower[j], upper[j]);
+	}
+	std::vector<_ValueType> output(n);
+	std::vector<_ValueType*> lower_copy(k), upper_copy(k);
+
+	double best = -1;
+	for (int r = 0; r < REPETITIONS; r++) {
+		// the merge advances the lower splitters
+		lower_copy = lower;
+		upper_copy = upper;
+		CPUTimer timer;
+		timer.start();
+		if (type == MERGE_GNU) {
+			gnuMerge(&lower_copy[0], &upper_copy[0], &output[0], k);
+		} else if (type == MERGE_LOSERTREE) {
+			malms::Merging::multiwaymerge(&lower_copy[0], &upper_copy[0], &output[0], k);
+		} else {
+			malms::Merging::small_merge<false>(&lower_copy[0], &upper_copy[0], &output[0], k);
+		}
+		timer.stop();
+		double t = timer.getTimeMicro() * 1000.0 / (double)n;
+		if (best < 0 || t < best) best = t;
+	}
+
+	if (!std::is_sorted(output.begin(), output.end())) {
+		std::cerr << "merge failed for k=" << k << std::endl;
+	}
+	return best;
+}
+
+template<typename _ValueType>
+void benchmark(const char* type, unsigned int maxk) {
+	for (unsigned int k = 2; k <= maxk; k = (k < SMALL_MERGE_MAX_K) ? k+1 : 2*k) {
+		std::cout << type << ";" << k << ";" << timeMerge<_ValueType>(MERGE_GNU, k) << ";" << timeMerge<_ValueType>(MERGE_LOSERTREE, k) << ";";
+		if (k <= SMALL_MERGE_MAX_K) {
+			std::cout << timeMerge<_ValueType>(MERGE_SMALL, k);
+		} else {
+			std::cout << "NA";
+		}
+		std::cout << std::endl;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	unsigned int maxk = 1024;
+	if (argc > 1) {
+		maxk = atoi(argv[1]);
+	}
+	// compare the trees only, without the streaming stores of multiwaymerge
+	malms::Memory::set_stream_store_threshold((size_t)-1);
+	std::cout << "Type;k;ns.per.Element.gnu;ns.per.Element.malms;ns.per.Element.small" << std::endl;
+	benchmark<int>("int", maxk);
+	benchmark<long long>("long long", maxk);
+	return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ *  Benchmark of concurrent malleable jobs.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Runs several malms::sort calls at once, each with its own job
+ *				of the scheduler, the j-th one starting j*delay milliseconds
+ *				after the first. With the policy fair the scheduler splits the
+ *				cores among the jobs by their weights, with all every job is
+ *				scheduled to all cores when it starts, so the last one takes
+ *				the machine, and a finishing job hands the cores to the job
+ *				started last of the ones still running. The cores of each job
+ *				are sampled every millisecond. Outputs a CSV table with the
+ *				makespan of each job and its average number of cores, and a
+ *				last line with the makespan of all jobs and the utilization
+ *				of the cores, i.e. the share of the cores which belonged to a
+ *				running job. Each job is given as weight[:priority[:deadline]],
+ *				with the priority class of the job (0 background, 1 normal,
+ *				2 high) and its deadline in milliseconds after its start,
+ *				the deadline is met if the makespan is at most the deadline.
+ *
+ *				Usage: benchmultijob [jobs] [n] [k] [fair|all] [delay] [job...]
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <time.h>
+
+#include "../malms/threadpool_mergesort.h"
+#include "../malms/threadpool/maleablescheduler.h"
+#include "../malms/threadpool/workqueue.h"
+
+double seconds_now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * One sort with its own job.
+ */
+struct Job {
+	std::vector<int> input;
+	unsigned int weight;
+	int priority;
+	// the deadline in seconds after the start, 0 for none
+	double deadline;
+	double delay;
+	bool fair;
+	// set while the job exists, for the sampling
+	Scheduler::WorkQueue* volatile queue;
+	volatile bool running;
+	double start;
+	double end;
+	// the sum of the sampled cores and the number of samples
+	long cores;
+	long samples;
+
+	Job() : weight(1), priority(Scheduler::PRIORITY_NORMAL), deadline(0), delay(0), fair(true), queue(NULL), running(false), start(0), end(0), cores(0), samples(0) {
+	}
+};
+
+std::vector<Job>* all_jobs;
+boost::mutex all_mutex;
+
+/*
+ * Schedules the job started last of the running ones to all cores, for the
+ * policy all.
+ */
+void scheduleLastJob() {
+	Scheduler::MaleableScheduler* sched = Scheduler::MaleableScheduler::singleton();
+	Job* last = NULL;
+	for (std::size_t j = 0; j < all_jobs->size(); j++) {
+		Job& job = (*all_jobs)[j];
+		if (job.running && (last == NULL || job.start > last->start)) last = &job;
+	}
+	if (last != NULL) sched->scheduleToAll(last->queue);
+}
+
+void runJob(Job* job, int k) {
+	Scheduler::MaleableScheduler* sched = Scheduler::MaleableScheduler::singleton();
+	struct timespec ts;
+	ts.tv_sec = static_cast<time_t>(job->delay);
+	ts.tv_nsec = static_cast<long>((job->delay - ts.tv_sec) * 1e9);
+	nanosleep(&ts, NULL);
+	job->start = seconds_now();
+	Scheduler::WorkQueue* queue = sched->newJob(job->weight, job->priority);
+	if (job->deadline > 0) sched->setJobDeadline(queue, job->deadline);
+	{
+		boost::unique_lock<boost::mutex> lock(all_mutex);
+		if (!job->fair) sched->scheduleToAll(queue);
+		job->queue = queue;
+		job->running = true;
+	}
+	malms::sort(job->input.begin(), job->input.end(), k, queue);
+	job->end = seconds_now();
+	boost::unique_lock<boost::mutex> lock(all_mutex);
+	job->running = false;
+	sched->deleteJob(queue);
+	if (!job->fair) scheduleLastJob();
+}
+
+int main(int argc, char* argv[]) {
+	int jobs = 2;
+	long n = 10000000;
+	int k = 0;
+	bool fair = true;
+	double delay = 0.1;
+	if (argc > 1) jobs = atoi(argv[1]);
+	if (argc > 2) n = atol(argv[2]);
+	if (argc > 3) k = atoi(argv[3]);
+	if (argc > 4) fair = strcmp(argv[4], "all") != 0;
+	if (argc > 5) delay = atof(argv[5]) * 1e-3;
+
+	Scheduler::MaleableScheduler* sched = Scheduler::MaleableScheduler::singleton();
+	sched->setFairShare(fair);
+	int p = boost::thread::hardware_concurrency();
+	if (k == 0) k = 4 * p;
+
+	std::vector<Job> job(jobs);
+	all_jobs = &job;
+	for (int j = 0; j < jobs; j++) {
+		job[j].input.resize(n);
+		std::generate(job[j].input.begin(), job[j].input.end(), rand);
+		if (argc > 6 + j) {
+			// weight[:priority[:deadline]]
+			int priority = Scheduler::PRIORITY_NORMAL;
+			double deadline = 0;
+			if (sscanf(argv[6 + j], "%u:%d:%lf", &job[j].weight, &priority, &deadline) >= 1) {
+				job[j].priority = priority;
+				job[j].deadline = deadline * 1e-3;
+			}
+		}
+		job[j].delay = j * delay;
+		job[j].fair = fair;
+	}
+
+	std::vector<boost::thread*> threads(jobs);
+	for (int j = 0; j < jobs; j++) {
+		threads[j] = new boost::thread(&runJob, &job[j], k);
+	}
+	// sample the cores of the jobs until all are done
+	long used = 0;
+	long samples = 0;
+	int done = 0;
+	while (done < jobs) {
+		boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+		done = 0;
+		long cores = 0;
+		bool any = false;
+		for (int j = 0; j < jobs; j++) {
+			if (job[j].end > 0) done++;
+			if (!job[j].running) continue;
+			int c = sched->coresOfJob(job[j].queue);
+			job[j].cores += c;
+			job[j].samples++;
+			cores += c;
+			any = true;
+		}
+		if (any) {
+			used += cores;
+			samples++;
+		}
+	}
+	double first = job[0].start;
+	double last = 0;
+	std::cout << "Job;Weight;Priority;Deadline;Makespan;Avg.Cores" << std::endl;
+	for (int j = 0; j < jobs; j++) {
+		threads[j]->join();
+		delete threads[j];
+		first = std::min(first, job[j].start);
+		last = std::max(last, job[j].end);
+		double avg = (job[j].samples > 0) ? static_cast<double>(job[j].cores) / job[j].samples : 0;
+		std::cout << j << ";" << job[j].weight << ";" << job[j].priority << ";" << job[j].deadline << ";" << job[j].end - job[j].start << ";" << avg << std::endl;
+	}
+	double utilization = (samples > 0) ? static_cast<double>(used) / (samples * p) : 0;
+	std::cout << "all;;;;" << last - first << ";" << utilization << std::endl;
+
+	Scheduler::MaleableScheduler::deleteSingleton();
+	return 0;
+}
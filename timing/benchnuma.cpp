@@ -0,0 +1,113 @@
+/*
+ *  Benchmark of the NUMA Placement Policies.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Sorts random ints with malms::sort on all cores using each
+ *				NUMA policy of the SortContext (first touch, local and
+ *				interleaved) and reports the time together with the change of
+ *				the allocation counters in /sys/devices/system/node/node<i>/
+ *				numastat summed over all nodes. other_node counts pages that
+ *				were allocated on another node than the one of the allocating
+ *				thread, i.e. memory that is accessed across nodes.
+ *				Outputs a CSV table. On a single node machine all policies
+ *				behave the same.
+ *
+ *				Usage: benchnuma [n] [workpakets] [repeat]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include "../malms/threadpool_mergesort.h"
+#include "../malms/threadpool/maleablescheduler.h"
+#include "../malms/threadpool/numa.h"
+
+// timing
+#include "../utils/cputimer.h"
+
+#define NUM_COUNTERS 4
+
+const char* counterNames[NUM_COUNTERS] = {"numa_hit", "numa_miss", "local_node", "other_node"};
+
+/*
+ * Reads the numastat counters summed over all nodes.
+ */
+void readCounters(unsigned long long* counters) {
+	for (int c = 0; c < NUM_COUNTERS; c++) counters[c] = 0;
+	for (int node = 0; node < Scheduler::Numa::num_nodes(); node++) {
+		std::ostringstream name;
+		name << "/sys/devices/system/node/node" << node << "/numastat";
+		std::ifstream stat(name.str().c_str());
+		std::string key;
+		unsigned long long value;
+		while (stat >> key >> value) {
+			for (int c = 0; c < NUM_COUNTERS; c++) {
+				if (key == counterNames[c]) counters[c] += value;
+			}
+		}
+	}
+}
+
+const char* policyName(Scheduler::Numa::Policy policy) {
+	switch (policy) {
+		case Scheduler::Numa::FIRST_TOUCH: return "first_touch";
+		case Scheduler::Numa::LOCAL: return "local";
+		default: return "interleave";
+	}
+}
+
+int main(int argc, char* argv[]) {
+	long n = 50000000;
+	int k = 0;
+	int repeat = 3;
+	if (argc > 1) n = atol(argv[1]);
+	if (argc > 2) k = atoi(argv[2]);
+	if (argc > 3) repeat = atoi(argv[3]);
+
+	Scheduler::MaleableScheduler* sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToAll(queue);
+	if (k == 0) k = boost::thread::hardware_concurrency();
+
+	std::cout << "Nodes;Policy;Size;Workpakets;Time";
+	for (int c = 0; c < NUM_COUNTERS; c++) {
+		std::cout << ";" << counterNames[c];
+	}
+	std::cout << std::endl;
+
+	Scheduler::Numa::Policy policies[3] = {Scheduler::Numa::FIRST_TOUCH, Scheduler::Numa::LOCAL, Scheduler::Numa::INTERLEAVE};
+	std::vector<int> data(n);
+	for (int p = 0; p < 3; p++) {
+		for (int r = 0; r < repeat; r++) {
+			// a fresh context for each run, so that the buffer is placed anew
+			malms::SortContext<int*> context;
+			context.setNumaPolicy(policies[p]);
+			std::generate(data.begin(), data.end(), rand);
+
+			unsigned long long before[NUM_COUNTERS], after[NUM_COUNTERS];
+			readCounters(before);
+			CPUTimer timer;
+			timer.start();
+			malms::sort(&data[0], &data[0]+n, k, queue, context);
+			timer.stop();
+			readCounters(after);
+
+			std::cout << Scheduler::Numa::num_nodes() << ";" << policyName(policies[p]) << ";" << n << ";" << k << ";" << timer.getTime();
+			for (int c = 0; c < NUM_COUNTERS; c++) {
+				std::cout << ";" << (after[c] - before[c]);
+			}
+			std::cout << std::endl;
+		}
+	}
+
+	Scheduler::MaleableScheduler::deleteSingleton();
+	return 0;
+}
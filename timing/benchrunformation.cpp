@@ -0,0 +1,115 @@
+/*
+ *  Benchmark of the Run Formation Kernels.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Times the kernels that a SortPaket can use to sort its slice
+ *				into the run buffer (copy + GNU-sort, LSD radix sort and the
+ *				vectorized sort for each instruction set) for a range of paket
+ *				sizes. Outputs a CSV table with the time per element in ns.
+ *
+ *				Usage: benchrunformation [maxsize]
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include "../malms/run_formation.h"
+#include "../malms/radix_sort.h"
+#include "../malms/simd_sort.h"
+
+// timing
+#include "../utils/cputimer.h"
+
+// number of elements sorted per measurement (over several repetitions)
+#define ELEMENTS_PER_MEASUREMENT (1<<24)
+
+enum Kernel {STDSORT, RADIX, KERNEL_SSE4, KERNEL_AVX2, DISPATCH};
+
+const char* kernelName(int k) {
+	switch (k) {
+		case STDSORT: return "stdsort";
+		case RADIX: return "radix";
+		case KERNEL_SSE4: return "simd_sse4";
+		case KERNEL_AVX2: return "simd_avx2";
+		default: return "run_formation";
+	}
+}
+
+/*
+ * Returns the time per element in ns for sorting slices of the given size with
+ * the given kernel, or a negative value if the kernel is not available.
+ */
+template<typename _ValueType>
+double timeKernel(int kernel, long size) {
+	using namespace malms::Sorting;
+	SimdLevel level = simd_level();
+	if (kernel == KERNEL_SSE4 && (level < SIMD_SSE4 || sizeof(_ValueType) != 4)) return -1;
+	if (kernel == KERNEL_AVX2 && level < SIMD_AVX2) return -1;
+
+	long repeat = std::max(1L, ELEMENTS_PER_MEASUREMENT / size);
+	std::vector<_ValueType> input(size * repeat);
+	for (typename std::vector<_ValueType>::iterator i = input.begin(); i != input.end(); ++i) {
+		*i = static_cast<_ValueType>((long long)rand() * (long long)rand());
+	}
+	std::vector<_ValueType> buffer(size);
+
+	if (kernel == KERNEL_SSE4) simd_set_level(SIMD_SSE4);
+
+	CPUTimer timer;
+	timer.start();
+	for (long r = 0; r < repeat; r++) {
+		_ValueType* begin = &input[r*size];
+		_ValueType* end = begin + size;
+		switch (kernel) {
+			case STDSORT:
+				std::copy(begin, end, &buffer[0]);
+				std::sort(buffer.begin(), buffer.end());
+				break;
+			case RADIX:
+				radix_sort_copy(begin, end, &buffer[0]);
+				break;
+			case KERNEL_SSE4:
+			case KERNEL_AVX2:
+				simd_sort_copy(begin, end, &buffer[0]);
+				break;
+			default:
+				form_run<false>(begin, end, &buffer[0]);
+				break;
+		}
+	}
+	timer.stop();
+
+	simd_set_level(level);
+	return timer.getTimeMicro() * 1000.0 / (double)(size * repeat);
+}
+
+template<typename _ValueType>
+void benchmark(const char* type, long maxsize) {
+	for (long size = 64; size <= maxsize; size *= 2) {
+		std::cout << type << ";" << size;
+		for (int k = STDSORT; k <= DISPATCH; k++) {
+			std::cout << ";" << timeKernel<_ValueType>(k, size);
+		}
+		std::cout << std::endl;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	long maxsize = 1 << 22;
+	if (argc > 1) {
+		maxsize = atol(argv[1]);
+	}
+	std::cout << "Type;Paket.Size";
+	for (int k = STDSORT; k <= DISPATCH; k++) {
+		std::cout << ";ns.per.Element." << kernelName(k);
+	}
+	std::cout << std::endl;
+	benchmark<int>("int", maxsize);
+	benchmark<long long>("long long", maxsize);
+	return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ *  Benchmark of the Streaming Stores.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Times the copy of n ints with a CopyPaket, the multiway merge
+ *				of k runs of n ints and malms::sort of n ints on all cores,
+ *				each with normal stores (the stream store threshold set to
+ *				the maximum) and with streaming stores (threshold 0). The
+ *				savings show for memory bound sizes, i.e. n*4 bytes of at
+ *				least four times the last level cache. Outputs a CSV table
+ *				with the time in seconds.
+ *
+ *				Usage: benchstreamstore [n] [workpakets] [repeat]
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include "../malms/threadpool_mergesort.h"
+#include "../malms/copy_paket.h"
+#include "../malms/loser_merge.h"
+#include "../malms/stream_store.h"
+#include "../malms/threadpool/maleablescheduler.h"
+
+// timing
+#include "../utils/cputimer.h"
+
+// the number of runs of the merge
+#define MERGE_RUNS 16
+
+double timeCopy(std::vector<int>& input, std::vector<int>& output) {
+	malms::CopyPaket<int*,int*> copy(&input[0], &input[0] + input.size(), &output[0]);
+	CPUTimer timer;
+	timer.start();
+	copy();
+	timer.stop();
+	return timer.getTime();
+}
+
+double timeMerge(std::vector<int>& input, std::vector<int>& output) {
+	long n = input.size();
+	std::vector<int*> lower(MERGE_RUNS), upper(MERGE_RUNS);
+	for (int j = 0; j < MERGE_RUNS; j++) {
+		lower[j] = &input[0] + n*j/MERGE_RUNS;
+		upper[j] = &input[0] + n*(j+1)/MERGE_RUNS;
+	}
+	CPUTimer timer;
+	timer.start();
+	malms::Merging::multiwaymerge(&lower[0], &upper[0], &output[0], MERGE_RUNS);
+	timer.stop();
+	return timer.getTime();
+}
+
+double timeSort(std::vector<int>& input, int k, Scheduler::WorkQueue* queue) {
+	std::generate(input.begin(), input.end(), rand);
+	CPUTimer timer;
+	timer.start();
+	malms::sort(input.begin(), input.end(), k, queue);
+	timer.stop();
+	return timer.getTime();
+}
+
+int main(int argc, char* argv[]) {
+	long n = 100000000;
+	int k = 0;
+	int repeat = 3;
+	if (argc > 1) n = atol(argv[1]);
+	if (argc > 2) k = atoi(argv[2]);
+	if (argc > 3) repeat = atoi(argv[3]);
+
+	Scheduler::MaleableScheduler* sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToAll(queue);
+	if (k == 0) k = boost::thread::hardware_concurrency();
+
+	std::vector<int> input(n), output(n);
+	std::generate(input.begin(), input.end(), rand);
+	// sorted runs for the merge
+	for (int j = 0; j < MERGE_RUNS; j++) {
+		std::sort(input.begin() + n*j/MERGE_RUNS, input.begin() + n*(j+1)/MERGE_RUNS);
+	}
+	// touch the output once, so that no page faults are timed
+	std::fill(output.begin(), output.end(), 0);
+
+	std::cout << "Stores;Operation;Size;Workpakets;Time" << std::endl;
+	const char* stores[2] = {"normal", "streaming"};
+	size_t thresholds[2] = {(size_t)-1, 0};
+	for (int r = 0; r < repeat; r++) {
+		for (int s = 0; s < 2; s++) {
+			malms::Memory::set_stream_store_threshold(thresholds[s]);
+			std::cout << stores[s] << ";copy;" << n << ";1;" << timeCopy(input, output) << std::endl;
+			std::cout << stores[s] << ";merge;" << n << ";" << MERGE_RUNS << ";" << timeMerge(input, output) << std::endl;
+		}
+	}
+	for (int r = 0; r < repeat; r++) {
+		for (int s = 0; s < 2; s++) {
+			malms::Memory::set_stream_store_threshold(thresholds[s]);
+			std::cout << stores[s] << ";sort;" << n << ";" << k << ";" << timeSort(output, k, queue) << std::endl;
+		}
+	}
+
+	Scheduler::MaleableScheduler::deleteSingleton();
+	return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ *  Benchmark of the WorkQueue.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Times the scheduling of many short pakets on all cores: n
+ *				pakets pushed one by one from the main thread, n pakets pushed
+ *				at once, n pakets pushed by pakets that are running (a tree
+ *				of fan-out 2), and malms::sort of n ints with k pakets. The
+ *				pakets only do a few nanoseconds of work, so that the time is
+ *				the overhead of the queue. Outputs a CSV table with the time
+ *				in seconds and the time per paket in nanoseconds.
+ *
+ *				Usage: benchworkqueue [n] [k] [repeat]
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include "../malms/threadpool_mergesort.h"
+#include "../malms/threadpool/maleablescheduler.h"
+#include "../malms/threadpool/workqueue.h"
+
+// timing
+#include "../utils/cputimer.h"
+
+// the work of one paket, in iterations
+#define PAKET_WORK 16
+
+/*
+ * A paket that does PAKET_WORK iterations of work.
+ */
+class ShortPaket : public Scheduler::WorkQueueItem {
+	private:
+		volatile int* sink;
+	public:
+		ShortPaket() : sink(NULL) {
+		}
+		void setSink(volatile int* s) {
+			sink = s;
+		}
+		void operator()() {
+			int c = 1;
+			for (int i = 0; i < PAKET_WORK; i++) {
+				c = c * 7 + i;
+			}
+			*sink += c & 1;
+		}
+};
+
+/*
+ * A paket that pushes the pakets of its two children in the tree of
+ * the pakets [first,last).
+ */
+class TreePaket : public Scheduler::WorkQueueItem {
+	private:
+		std::vector<TreePaket>* pakets;
+		Scheduler::WorkQueue* queue;
+		long index;
+	public:
+		TreePaket() : pakets(NULL), queue(NULL), index(0) {
+		}
+		void init(std::vector<TreePaket>* p, Scheduler::WorkQueue* q, long i) {
+			pakets = p;
+			queue = q;
+			index = i;
+		}
+		void operator()() {
+			long n = pakets->size();
+			if (2*index + 1 < n) queue->push(&(*pakets)[2*index + 1]);
+			if (2*index + 2 < n) queue->push(&(*pakets)[2*index + 2]);
+		}
+};
+
+double timeSingle(std::vector<ShortPaket>& pakets, Scheduler::WorkQueue* queue) {
+	CPUTimer timer;
+	timer.start();
+	for (std::size_t i = 0; i < pakets.size(); i++) {
+		queue->push(&pakets[i]);
+	}
+	queue->blockuntildone();
+	timer.stop();
+	return timer.getTime();
+}
+
+double timeBulk(std::vector<ShortPaket>& pakets, std::vector<Scheduler::WorkQueueItem*>& items, Scheduler::WorkQueue* queue) {
+	for (std::size_t i = 0; i < pakets.size(); i++) {
+		items[i] = &pakets[i];
+	}
+	CPUTimer timer;
+	timer.start();
+	queue->push(&items[0], items.size());
+	queue->blockuntildone();
+	timer.stop();
+	return timer.getTime();
+}
+
+double timeTree(std::vector<TreePaket>& pakets, Scheduler::WorkQueue* queue) {
+	CPUTimer timer;
+	timer.start();
+	queue->push(&pakets[0]);
+	queue->blockuntildone();
+	timer.stop();
+	return timer.getTime();
+}
+
+double timeSort(std::vector<int>& input, int k, Scheduler::WorkQueue* queue) {
+	std::generate(input.begin(), input.end(), rand);
+	CPUTimer timer;
+	timer.start();
+	malms::sort(input.begin(), input.end(), k, queue);
+	timer.stop();
+	return timer.getTime();
+}
+
+void output(const char* operation, long n, double time) {
+	std::cout << operation << ";" << n << ";" << time << ";" << time * 1e9 / n << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	long n = 1000000;
+	int k = 4096;
+	int repeat = 3;
+	if (argc > 1) n = atol(argv[1]);
+	if (argc > 2) k = atoi(argv[2]);
+	if (argc > 3) repeat = atoi(argv[3]);
+
+	Scheduler::MaleableScheduler* sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	sched->scheduleToAll(queue);
+
+	volatile int sink = 0;
+	std::vector<ShortPaket> pakets(n);
+	for (long i = 0; i < n; i++) {
+		pakets[i].setSink(&sink);
+	}
+	std::vector<Scheduler::WorkQueueItem*> items(n);
+	std::vector<TreePaket> tree(n);
+	for (long i = 0; i < n; i++) {
+		tree[i].init(&tree, queue, i);
+	}
+	std::vector<int> input(k * 64L);
+
+	std::cout << "Operation;Pakets;Time;Time.Per.Paket" << std::endl;
+	for (int r = 0; r < repeat; r++) {
+		output("single", n, timeSingle(pakets, queue));
+		output("bulk", n, timeBulk(pakets, items, queue));
+		output("tree", n, timeTree(tree, queue));
+		output("sort", k, timeSort(input, k, queue));
+	}
+
+	Scheduler::MaleableScheduler::deleteSingleton();
+	return 0;
+}
@@ -7,8 +7,9 @@
  *
  *  Description:
  *				Loads cores according to a given schedule and 
- *  			sends Signals to the Malleable-Scheduler, telling it which cores
- *  			are loaded and not loaded.
+ *  			tells the Malleable-Scheduler which cores are loaded and not
+ *  			loaded, with one message to its control socket for each step
+ *  			of the schedule, or with one realtime signal per core.
  *				Target PID is defined via commandline argument.
  */
 
@@ -32,6 +33,9 @@
 // scheduler functions for high priority and thread pinning
 #include <sched.h>
 
+// control messages for the scheduler
+#include "../malms/threadpool/corecontrol.h"
+
 // threading
 #include <boost/thread.hpp>
 
@@ -48,6 +52,7 @@
 
 // commandline argument names
 #define ARG_INFO "info"
+#define ARG_SIGNALS "signals"
 #define ARG_NOINFO "noinfo"
 
 // thread work function memory size per 1000x ints (10000 = 40 MB)
@@ -69,6 +74,10 @@ std::atomic<bool> quit;
 std::atomic<pid_t> pidofsort;
 std::atomic<int> p;
 std::atomic<bool> send_info;
+std::atomic<bool> send_signals;
+// the cores loaded and unloaded in the current step of the pattern
+std::vector<int> step_load;
+std::vector<int> step_unload;
 std::atomic<long long> block_cycle_nanosec;
 
 int** thread_work_mem;
@@ -143,17 +152,11 @@ void thread_func(int coreid) {
 	}
 }
 
+/*
+ * The core is loaded at the end of the step.
+ */
 void loadcore(int coreid, pid_t pid) {
-	if (send_info) {
-		union sigval value;
-		value.sival_int = coreid;
-		sigqueue(pid, SIGRTMIN+1, value);
-	}
-	{
-		boost::unique_lock<boost::mutex> lock(*thread_mutex[coreid]);
-		thread_active[coreid] = true;
-		thread_cd[coreid]->notify_all();
-	}
+	step_load.push_back(coreid);
 }
 
 void unloadcore(int coreid, pid_t pid) {
@@ -161,11 +164,38 @@ void unloadcore(int coreid, pid_t pid) {
 		boost::unique_lock<boost::mutex> lock(*thread_mutex[coreid]);
 		thread_active[coreid] = false;
 	}
-	if (send_info) {
+	step_unload.push_back(coreid);
+}
+
+/*
+ * Ends the step of the pattern: tells the scheduler about the loaded and
+ * unloaded cores of the step, then loads the cores.
+ */
+void endstep(pid_t pid) {
+	if (send_info && send_signals) {
 		union sigval value;
-		value.sival_int = coreid;
-		sigqueue(pid, SIGRTMIN+2, value);
+		for (std::size_t i = 0; i < step_load.size(); i++) {
+			value.sival_int = step_load[i];
+			sigqueue(pid, SIGRTMIN+1, value);
+		}
+		for (std::size_t i = 0; i < step_unload.size(); i++) {
+			value.sival_int = step_unload[i];
+			sigqueue(pid, SIGRTMIN+2, value);
+		}
+	} else if (send_info) {
+		std::string message;
+		if (!step_load.empty()) message += Scheduler::CoreControl::line("block", step_load);
+		if (!step_unload.empty()) message += Scheduler::CoreControl::line("unblock", step_unload);
+		Scheduler::CoreControl::send(Scheduler::CoreControl::socket_path(pid), message);
 	}
+	for (std::size_t i = 0; i < step_load.size(); i++) {
+		int coreid = step_load[i];
+		boost::unique_lock<boost::mutex> lock(*thread_mutex[coreid]);
+		thread_active[coreid] = true;
+		thread_cd[coreid]->notify_all();
+	}
+	step_load.clear();
+	step_unload.clear();
 }
 
 void waitforpidandexit(pid_t pid) {
@@ -210,18 +240,21 @@ void controlthreadfunc() {
 		// start blocking cores
 		loadcore(1, pid);
 		loadcore(2, pid);
+		endstep(pid);
 		
 		while (true) {
 			nanosleep(&req,NULL);
 			if (quit) break;
 			
 			loadcore(0, pid);
+			endstep(pid);
 			
 			nanosleep(&req,NULL);
 			if (quit) break;
 			
 			unloadcore(1, pid);
 			unloadcore(2, pid);
+			endstep(pid);
 			
 			nanosleep(&req,NULL);
 			if (quit) break;
@@ -229,6 +262,7 @@ void controlthreadfunc() {
 			loadcore(1, pid);
 			loadcore(2, pid);
 			unloadcore(0, pid);
+			endstep(pid);
 			
 			nanosleep(&req,NULL);
 			if (quit) break;
@@ -247,6 +281,7 @@ void controlthreadfunc() {
 		loadcore(0, pid);
 		loadcore(4, pid);
 		loadcore(6, pid);
+		endstep(pid);
 		
 		while (true) {
 			
@@ -255,12 +290,14 @@ void controlthreadfunc() {
 			
 			loadcore(2, pid);
 			unloadcore(4, pid);
+			endstep(pid);
 			
 			nanosleep(&req,NULL);
 			if (quit) break;
 			
 			loadcore(4, pid);
 			unloadcore(6, pid);
+			endstep(pid);
 
 			
 			nanosleep(&req,NULL);
@@ -268,12 +305,14 @@ void controlthreadfunc() {
 			
 			loadcore(6, pid);
 			unloadcore(0, pid);
+			endstep(pid);
 			
 			nanosleep(&req,NULL);
 			if (quit) break;
 			
 			loadcore(0, pid);
 			unloadcore(2, pid);
+			endstep(pid);
 		}
 	} else if (load_pattern == 3) {
 		// Pattern 3
@@ -287,6 +326,7 @@ void controlthreadfunc() {
 		// start blocking cores
 		loadcore(0, pid);
 		loadcore(4, pid);
+		endstep(pid);
 		
 		while (true) {
 			
@@ -297,6 +337,7 @@ void controlthreadfunc() {
 			loadcore(5, pid);
 			unloadcore(0, pid);
 			unloadcore(4, pid);
+			endstep(pid);
 			
 			nanosleep(&req,NULL);
 			if (quit) break;
@@ -305,6 +346,7 @@ void controlthreadfunc() {
 			loadcore(6, pid);
 			unloadcore(1, pid);
 			unloadcore(5, pid);
+			endstep(pid);
 			
 			nanosleep(&req,NULL);
 			if (quit) break;
@@ -313,6 +355,7 @@ void controlthreadfunc() {
 			loadcore(7, pid);
 			unloadcore(2, pid);
 			unloadcore(6, pid);
+			endstep(pid);
 			
 			nanosleep(&req,NULL);
 			if (quit) break;
@@ -321,6 +364,7 @@ void controlthreadfunc() {
 			loadcore(4, pid);
 			unloadcore(3, pid);
 			unloadcore(7, pid);
+			endstep(pid);
 		}
 	}
 	
@@ -340,14 +384,15 @@ void controlthreadfunc() {
 }
 
 void printUsage() {
-	std::cerr << "Usage: ./dynloadcores <info/noinfo> <block_cycle> <pattern> ./timesortfile [SORT OPTIONS]" << std::endl;
+	std::cerr << "Usage: ./dynloadcores <info/signals/noinfo> <block_cycle> <pattern> ./timesortfile [SORT OPTIONS]" << std::endl;
 	std::cerr << "   where" << std::endl;
-	std::cerr << "   <info/noinfo>     Set to `info` to send the loaded core info to the malleable scheduler, otherwise set to `noinfo`" << std::endl;
-	std::cerr << "   <block_cycle>     Duration of each block in the dynamic load pattern (in nanoseconds)" << std::endl;
-	std::cerr << "   <pattern>         The load pattern to use (either 1, 2, or 3)" << std::endl;
+	std::cerr << "   <info/signals/noinfo>  Set to `info` to send the loaded core info to the control socket of the malleable scheduler," << std::endl;
+	std::cerr << "                          to `signals` to send it as one signal per core, otherwise set to `noinfo`" << std::endl;
+	std::cerr << "   <block_cycle>          Duration of each block in the dynamic load pattern (in nanoseconds)" << std::endl;
+	std::cerr << "   <pattern>              The load pattern to use (either 1, 2, or 3)" << std::endl;
 }
 
-// usage: ./dynloadcores [info/noinfo] [Cyles in NanoSecs] ./timesortfile [SORT OPTIONS]
+// usage: ./dynloadcores [info/signals/noinfo] [Cyles in NanoSecs] ./timesortfile [SORT OPTIONS]
 int main(int argc, char* argv[]) {
 	if (argc < 5) {
 		printUsage();
@@ -355,8 +400,12 @@ int main(int argc, char* argv[]) {
 	}
 
 	// read input arguments
+	send_signals = false;
 	if (strcmp(argv[1],ARG_INFO)==0) {
 		send_info = true;
+	} else if (strcmp(argv[1],ARG_SIGNALS)==0) {
+		send_info = true;
+		send_signals = true;
 	} else if (strcmp(argv[1],ARG_NOINFO)==0) {
 		send_info = false;
 	} else {
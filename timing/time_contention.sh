@@ -0,0 +1,117 @@
+#!/bin/bash
+# Bash Script to Time MALMS with and without its contention monitor while
+# other processes load some of the cores
+#
+# Usage: bash time_contention.sh <WP> <PERIOD>
+#    <WP>       number of MALMS work packages, or "auto" to let MALMS choose
+#    <PERIOD>   sampling period of the contention monitor in milliseconds
+#
+# The load is the loadcore utility, spinning on the last cores of the machine,
+# which MALMS runs on all cores of. No process tells MALMS about the load, with
+# the monitor MALMS detects it by itself.
+
+
+# ------------------------------------------------------- #
+#                Settings for the Script
+# ------------------------------------------------------- #
+
+# The Size of the Input for the sorting Algorithms
+MIN_INPUT_SIZE=100000
+MAX_INPUT_SIZE=100000000
+
+# The Number of Threads used by the Algorithms, all CPUs of the machine, so
+# that the last cores loaded by loadcore are cores of the job
+CORES=$(getconf _NPROCESSORS_ONLN)
+
+# The Numbers of loaded Cores, at least one core of the job stays free
+MIN_LOADED_CORES=0
+MAX_LOADED_CORES=4
+if [ $MAX_LOADED_CORES -ge $CORES ]; then
+	MAX_LOADED_CORES=$((CORES-1))
+fi
+
+# The Type of the Input, according to the inputgeneration
+# Programm
+INPUT_TYPE=U
+
+# Number of Workpakets (MALMS) to use
+WP=100
+if [ -n "$1" ]; then
+	WP=$1
+fi
+
+PERIOD=100
+if [ -n "$2" ]; then
+	PERIOD=$2
+fi
+
+# Outputfile for the timing data
+OUTPUTNAME=contention_${PERIOD}ms_wp${WP}.csv
+
+# Number of Repitions of the Tests
+REPEAT=20
+
+
+
+# ------------------------------------------------------- #
+#                    Internal Settings
+# ------------------------------------------------------- #
+
+UTILS_DIR=../utils
+DATA_DIR=./data
+OUTPUT=$DATA_DIR/$OUTPUTNAME
+
+# ------------------------------------------------------- #
+#                 Prepare Output File
+# ------------------------------------------------------- #
+echo -n "" > $OUTPUT
+echo "Loaded.Cores;Cores;Input.Size;Monitor;Time;Workpakets" >> $OUTPUT
+
+# ------------------------------------------------------- #
+#                  Begin of Script
+# ------------------------------------------------------- #
+
+for ((size=$MIN_INPUT_SIZE; size<=$MAX_INPUT_SIZE; size*=10))
+do
+	echo  "=== Input Size $size ==="
+
+	# Generate Sorting input
+	$UTILS_DIR/generatesortinput -n $size -t $INPUT_TYPE input.data
+
+	for ((loaded=$MIN_LOADED_CORES; loaded<=$MAX_LOADED_CORES; loaded++))
+	do
+		echo -n " --> $loaded loaded cores: "
+		if [ $loaded -gt 0 ]; then
+			$UTILS_DIR/loadcore $loaded &
+			PID_OF_LOAD=$!
+		fi
+
+		for ((i=0; i<$REPEAT; i++))
+		do
+			for monitor in off on
+			do
+				echo -n "$loaded;$CORES;$size;$monitor;" >> $OUTPUT
+				if [ "$monitor" = "on" ]; then
+					./timesortfile -k $WP -c $CORES -d $PERIOD input.data >> $OUTPUT 2> /dev/null
+				else
+					./timesortfile -k $WP -c $CORES input.data >> $OUTPUT 2> /dev/null
+				fi
+				echo -e ";$WP" >> $OUTPUT
+			done
+			echo -n "."
+		done
+		echo ""
+
+		if [ $loaded -gt 0 ]; then
+			kill $PID_OF_LOAD
+			wait $PID_OF_LOAD 2> /dev/null
+		fi
+	done
+done
+
+
+# ------------------------------------------------------- #
+#                  Clean up
+# ------------------------------------------------------- #
+
+rm -f input.data
@@ -2,7 +2,7 @@
 # Bash Script to Test/Time MCSTL, MALMS, and TBB for dynamic load patterns
 # 
 # Usage: bash time_dynloadcores.sh <WP> <BLOCK_CYCLE> <PATTERN>
-#    <WP>            number of MALMS work packages
+#    <WP>            number of MALMS work packages, or "auto" to let MALMS choose
 #    <BLOCK_CYCLE>   Duration of blocks in pattern in microseconds
 #    <PATTERN>       The pattern to use, (either 1, 2, or 3)
 
@@ -19,7 +19,8 @@ MAX_CORES=8
 # Programm
 INPUT_TYPE=U
 
-# Number of Workpakets (MALMS) / Threads (MCSTL) to use
+# Number of Workpakets (MALMS) / Threads (MCSTL) to use, "auto" lets MALMS
+# choose its parameters (one thread per core for MCSTL)
 WP=48
 if [ -n "$1" ]; then
 	WP=$1
@@ -0,0 +1,101 @@
+#!/bin/bash
+# Bash Script to Time MALMS with pipelined and separate phases for dynamic load patterns
+#
+# Usage: bash time_pipeline.sh <WP> <BLOCK_CYCLE>
+#    <WP>            number of MALMS work packages, or "auto" to let MALMS choose
+#    <BLOCK_CYCLE>   Duration of blocks in pattern in microseconds
+#
+# For each of the load patterns of dynloadcores, MALMS sorts with the phases
+# connected by dependencies (pipelined) and with a wait for the queue after
+# each phase (separate). Next to the time, the idle time of the scheduler's
+# threads is recorded, i.e. the time the cores that were not blocked waited
+# for work, summed over the threads.
+
+
+# ------------------------------------------------------- #
+#                Settings for the Script
+# ------------------------------------------------------- #
+
+# The Size of the Input for the sorting Algorithms
+MIN_INPUT_SIZE=100000
+MAX_INPUT_SIZE=100000000
+
+# The Number of Threads used by the Algorithms
+CORES=8
+
+# The Type of the Input, according to the inputgeneration
+# Programm
+INPUT_TYPE=U
+
+# Number of Workpakets (MALMS) to use
+WP=100
+if [ -n "$1" ]; then
+	WP=$1
+fi
+
+BLOCK_CYCLE_MICROSEC=2000
+if [ -n "$2" ]; then
+	BLOCK_CYCLE_MICROSEC=$2
+fi
+
+# Outputfile for the timing data
+OUTPUTNAME=pipeline_${BLOCK_CYCLE_MICROSEC}µs_wp${WP}.csv
+
+# Number of Repitions of the Tests
+REPEAT=20
+
+
+
+# ------------------------------------------------------- #
+#                    Internal Settings
+# ------------------------------------------------------- #
+
+UTILS_DIR=../utils
+DATA_DIR=./data
+OUTPUT=$DATA_DIR/$OUTPUTNAME
+STDERR_FILE=pipeline_stderr.txt
+
+# ------------------------------------------------------- #
+#                 Prepare Output File
+# ------------------------------------------------------- #
+echo -n "" > $OUTPUT
+echo "Pattern;Cores;Input.Size;Phases;Time;Idle;Workpakets" >> $OUTPUT
+
+# ------------------------------------------------------- #
+#                  Begin of Script
+# ------------------------------------------------------- #
+
+for ((size=$MIN_INPUT_SIZE; size<=$MAX_INPUT_SIZE; size*=10))
+do
+	echo  "=== Input Size $size ==="
+
+	# Generate Sorting input
+	$UTILS_DIR/generatesortinput -n $size -t $INPUT_TYPE input.data
+
+	for pattern in 1 2 3
+	do
+		echo -n " --> Pattern $pattern: "
+		BlockNanoS=$((1000*$BLOCK_CYCLE_MICROSEC))
+
+		for ((i=0; i<$REPEAT; i++))
+		do
+			for phases in pipelined separate
+			do
+				echo -n "$pattern;$CORES;$size;$phases;" >> $OUTPUT
+				./dynloadcores info $BlockNanoS $pattern ./timesortfile -k $WP -c $CORES -s $phases input.data >> $OUTPUT 2> $STDERR_FILE
+				# the idle time is written to stderr as "Idle time: <s> s"
+				IDLE=`grep "Idle time" $STDERR_FILE | cut -d ' ' -f 3`
+				echo -e ";$IDLE;$WP" >> $OUTPUT
+			done
+			echo -n "."
+		done
+		echo ""
+	done
+done
+
+
+# ------------------------------------------------------- #
+#                  Clean up
+# ------------------------------------------------------- #
+
+rm -f input.data $STDERR_FILE
@@ -0,0 +1,102 @@
+#!/bin/bash
+# Bash Script to Time MALMS with and without splitting running merge pakets for dynamic load patterns
+#
+# Usage: bash time_split.sh <WP> <BLOCK_CYCLE>
+#    <WP>            number of MALMS work packages, or "auto" to let MALMS choose
+#    <BLOCK_CYCLE>   Duration of blocks in pattern in microseconds
+#
+# For each of the load patterns of dynloadcores, MALMS sorts with merge pakets
+# that give parts of their output to idle or unblocked cores while they run
+# (split) and with merge pakets that are only run as a whole (whole). Next to
+# the time, the idle time of the scheduler's threads and the number of parts
+# split off running pakets are recorded.
+
+
+# ------------------------------------------------------- #
+#                Settings for the Script
+# ------------------------------------------------------- #
+
+# The Size of the Input for the sorting Algorithms
+MIN_INPUT_SIZE=100000
+MAX_INPUT_SIZE=100000000
+
+# The Number of Threads used by the Algorithms
+CORES=8
+
+# The Type of the Input, according to the inputgeneration
+# Programm
+INPUT_TYPE=U
+
+# Number of Workpakets (MALMS) to use, few pakets make large merge pakets
+WP=8
+if [ -n "$1" ]; then
+	WP=$1
+fi
+
+BLOCK_CYCLE_MICROSEC=2000
+if [ -n "$2" ]; then
+	BLOCK_CYCLE_MICROSEC=$2
+fi
+
+# Outputfile for the timing data
+OUTPUTNAME=split_${BLOCK_CYCLE_MICROSEC}µs_wp${WP}.csv
+
+# Number of Repitions of the Tests
+REPEAT=20
+
+
+
+# ------------------------------------------------------- #
+#                    Internal Settings
+# ------------------------------------------------------- #
+
+UTILS_DIR=../utils
+DATA_DIR=./data
+OUTPUT=$DATA_DIR/$OUTPUTNAME
+STDERR_FILE=split_stderr.txt
+
+# ------------------------------------------------------- #
+#                 Prepare Output File
+# ------------------------------------------------------- #
+echo -n "" > $OUTPUT
+echo "Pattern;Cores;Input.Size;Merge;Time;Idle;Splits;Workpakets" >> $OUTPUT
+
+# ------------------------------------------------------- #
+#                  Begin of Script
+# ------------------------------------------------------- #
+
+for ((size=$MIN_INPUT_SIZE; size<=$MAX_INPUT_SIZE; size*=10))
+do
+	echo  "=== Input Size $size ==="
+
+	# Generate Sorting input
+	$UTILS_DIR/generatesortinput -n $size -t $INPUT_TYPE input.data
+
+	for pattern in 1 2 3
+	do
+		echo -n " --> Pattern $pattern: "
+		BlockNanoS=$((1000*$BLOCK_CYCLE_MICROSEC))
+
+		for ((i=0; i<$REPEAT; i++))
+		do
+			for merge in split whole
+			do
+				echo -n "$pattern;$CORES;$size;$merge;" >> $OUTPUT
+				./dynloadcores info $BlockNanoS $pattern ./timesortfile -k $WP -c $CORES -r $merge input.data >> $OUTPUT 2> $STDERR_FILE
+				# written to stderr as "Idle time: <s> s" and "Pakets split while running: <n>"
+				IDLE=`grep "Idle time" $STDERR_FILE | cut -d ' ' -f 3`
+				SPLITS=`grep "split while running" $STDERR_FILE | cut -d ' ' -f 5`
+				echo -e ";$IDLE;$SPLITS;$WP" >> $OUTPUT
+			done
+			echo -n "."
+		done
+		echo ""
+	done
+done
+
+
+# ------------------------------------------------------- #
+#                  Clean up
+# ------------------------------------------------------- #
+
+rm -f input.data $STDERR_FILE
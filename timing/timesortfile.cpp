@@ -13,6 +13,9 @@
 #include <iostream>
 #include <fstream>
 #include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
 
 // MCSTL MWMS
 #include <parallel/algorithm>
@@ -20,6 +23,10 @@
 
 // Maleable MS
 #include "../malms/threadpool_mergesort.h"
+#include "../malms/bounded_mergesort.h"
+#include "../malms/external_sort.h"
+#include "../malms/sample_sort.h"
+#include "../malms/prefault_paket.h"
 #include "../malms/threadpool/maleablescheduler.h"
 
 //Intel TBB
@@ -28,6 +35,13 @@
 // signaling
 #include <signal.h>
 
+// memory mapped input
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 // timing
 #include "../utils/cputimer.h"
 
@@ -35,23 +49,93 @@
 
 #define ARG_SIG_PID "-p"
 #define ARG_K "-k"
+#define ARG_K_AUTO "auto"
 #define ARG_C "-c"
+#define ARG_EXTRA "-b"
+#define ARG_MEMORY "-m"
+#define ARG_OUTPUT "-o"
+#define ARG_LOAD "-l"
+#define ARG_LOAD_READ "read"
+#define ARG_LOAD_MMAP "mmap"
+#define ARG_LOAD_MMAP_SHARED "mmapshared"
+#define ARG_PREFAULT "-f"
+#define ARG_PREFAULT_NONE "none"
+#define ARG_PREFAULT_POPULATE "populate"
+#define ARG_PREFAULT_PAKETS "pakets"
+#define ARG_ALLOC "-h"
+#define ARG_ALLOC_NONE "none"
+#define ARG_ALLOC_PREFAULT "prefault"
+#define ARG_ALLOC_THP "thp"
+#define ARG_ALLOC_HUGETLB "hugetlb"
+#define ARG_PHASES "-s"
+#define ARG_PHASES_PIPELINED "pipelined"
+#define ARG_PHASES_SEPARATE "separate"
+#define ARG_WAIT "-w"
+#define ARG_WAIT_SLEEP "sleep"
+#define ARG_WAIT_HELP "help"
+#define ARG_RUNNING "-r"
+#define ARG_RUNNING_SPLIT "split"
+#define ARG_RUNNING_WHOLE "whole"
+#define ARG_MONITOR "-d"
 #define ARG_ALG "-a"
 #define ARG_ALG_MCSTL "mcstl"
 #define ARG_ALG_MALMS "malms"
 #define ARG_ALG_STDSORT "stdsort"
 #define ARG_ALG_TBBSORT "tbbsort"
+#define ARG_ALG_SAMPLESORT "samplesort"
 
 // possible algorithms
-enum Algorithm {MCSTL_MWMS, MALMS, STDSORT, TBBSORT};
+enum Algorithm {MCSTL_MWMS, MALMS, STDSORT, TBBSORT, SAMPLESORT};
+// possible ways of loading the input
+enum LoadMode {LOAD_READ, LOAD_MMAP, LOAD_MMAP_SHARED};
+// possible ways of prefaulting a mapped input
+enum PrefaultMode {PREFAULT_NONE, PREFAULT_POPULATE, PREFAULT_PAKETS};
 
 
 void printUsage() {
 	std::cout << "Usage:\n\ttimesortfile [OPTIONS] filename" << std::endl;
-	std::cout << "Where [OPTIONS] can be\n-k wp\t\t\t Number of Workpakets (must be provided)" << std::endl;
+	std::cout << "Where [OPTIONS] can be\n-k wp\t\t\t Number of Workpakets (must be provided), or " << ARG_K_AUTO
+			  << " to let malms::sort choose its parameters (see malms/autotune.h)." << std::endl;
 	std::cout << "-p pid\t\t\tThe PID of the process receiving the signal." << std::endl;
+	std::cout << "-m memory\t\tMemory limit for MALMS in MB, sorts the file with malms::sort_file." << std::endl;
+	std::cout << "-o output\t\tOutput file of malms::sort_file (default: filename.sorted)." << std::endl;
+	std::cout << "-l load\t\t\tHow the input is loaded, one of " << ARG_LOAD_READ << " (default), " << ARG_LOAD_MMAP
+			  << " (private mapping) or " << ARG_LOAD_MMAP_SHARED << " (sorts the file in place)." << std::endl;
+	std::cout << "-f prefault\t\tPrefaulting of mapped input, one of " << ARG_PREFAULT_PAKETS << " (default, parallel), "
+			  << ARG_PREFAULT_POPULATE << " (MAP_POPULATE) or " << ARG_PREFAULT_NONE << std::endl;
+	std::cout << "-b extra\t\tExtra memory for MALMS in elements, uses the memory-bounded sort." << std::endl;
+	std::cout << "-h alloc\t\tAllocation of the MALMS run buffer, one of " << ARG_ALLOC_NONE << " (default), "
+			  << ARG_ALLOC_PREFAULT << " (parallel prefault), " << ARG_ALLOC_THP << " (transparent huge pages) or "
+			  << ARG_ALLOC_HUGETLB << " (2 MB pages, falls back to " << ARG_ALLOC_THP << ")." << std::endl;
+	std::cout << "-s phases\t\tThe phases of MALMS, " << ARG_PHASES_PIPELINED << " (connected by dependencies, the default unless the phases are timed) or "
+			  << ARG_PHASES_SEPARATE << " (waiting for each phase)." << std::endl;
+	std::cout << "-w wait\t\t\tHow the calling thread waits for the pakets of MALMS, " << ARG_WAIT_SLEEP << " (default) or "
+			  << ARG_WAIT_HELP << " (runs pakets itself)." << std::endl;
+	std::cout << "-r running\t\tWhether running merge pakets of MALMS can be split, " << ARG_RUNNING_SPLIT << " (default) or "
+			  << ARG_RUNNING_WHOLE << "." << std::endl;
+	std::cout << "-d period\t\tStarts the contention monitor of the scheduler, sampling the cores every period milliseconds." << std::endl;
+	std::cout << "The load time, the page faults of the sort, the used allocation, the idle time of the" << std::endl;
+	std::cout << "scheduler's threads and the number of split pakets are written to stderr." << std::endl;
 	std::cout << "-a algorithm\tThe Algorithm used, can be one of " << ARG_ALG_MCSTL << ", " 
-			  << ARG_ALG_MALMS << " or " << ARG_ALG_STDSORT << std::endl;
+			  << ARG_ALG_MALMS << ", " << ARG_ALG_SAMPLESORT << ", " << ARG_ALG_TBBSORT << " or " << ARG_ALG_STDSORT << std::endl;
+}
+
+/*
+ * Creates the job of the malleable scheduler on c cores (all if c is 0), and
+ * the control socket for the updates of the available cores. Starts the
+ * contention monitor with the given period, unless it is 0.
+ */
+Scheduler::WorkQueue* createQueue(int c, int monitor) {
+	Scheduler::MaleableScheduler* sched = Scheduler::MaleableScheduler::singleton();
+	sched->startControlSocket();
+	if (monitor > 0) sched->startContentionMonitor(monitor);
+	Scheduler::WorkQueue* queue = sched->newJob();
+	if (c == 0) {
+		sched->scheduleToAll(queue);
+	} else {
+		sched->scheduleToFirst(queue, c);
+	}
+	return queue;
 }
 
 
@@ -61,8 +145,19 @@ int main(int argc, char* argv[]) {
 	char* filename = NULL;
 	int pid = 0;
 	int k = 0;
+	bool tuned = false;
 	int i = 1;
 	int c = 0;
+	long long extra = 0;
+	long long memory = 0;
+	char* output = NULL;
+	LoadMode load = LOAD_READ;
+	PrefaultMode prefault = PREFAULT_PAKETS;
+	malms::AllocationPolicy allocation = malms::ALLOC_DEFAULT;
+	bool pipelined = SORT_PIPELINED_DEFAULT;
+	bool helping = false;
+	bool split_running = true;
+	int monitor = 0;
 	while (i < argc-1) {
 		if (strcmp(argv[i],ARG_ALG)==0) {
 			// "-a" algorithm
@@ -75,6 +170,8 @@ int main(int argc, char* argv[]) {
 				a = STDSORT;
 			} else if (strcmp(argv[i],ARG_ALG_TBBSORT)==0) {
 				a = TBBSORT;
+			} else if (strcmp(argv[i],ARG_ALG_SAMPLESORT)==0) {
+				a = SAMPLESORT;
 			} else {
 				printUsage();
 				return 0;
@@ -86,37 +183,213 @@ int main(int argc, char* argv[]) {
 		} else if (strcmp(argv[i],ARG_K)==0) {
 			// "-k" number of workpakets for MALMS/threads for MCSTL
 			++i;
-			k = atoi(argv[i]);
+			if (strcmp(argv[i],ARG_K_AUTO)==0) {
+				tuned = true;
+			} else {
+				k = atoi(argv[i]);
+			}
 		} else if (strcmp(argv[i],ARG_C)==0) {
 			// "-c" number of cores for MALMS
 			++i;
 			c = atoi(argv[i]);
+		} else if (strcmp(argv[i],ARG_EXTRA)==0) {
+			// "-b" extra memory for the memory-bounded MALMS
+			++i;
+			extra = atoll(argv[i]);
+		} else if (strcmp(argv[i],ARG_MEMORY)==0) {
+			// "-m" memory limit for sorting the file with MALMS
+			++i;
+			memory = atoll(argv[i]);
+		} else if (strcmp(argv[i],ARG_OUTPUT)==0) {
+			// "-o" output file
+			++i;
+			output = argv[i];
+		} else if (strcmp(argv[i],ARG_LOAD)==0) {
+			// "-l" how to load the input
+			++i;
+			if (strcmp(argv[i],ARG_LOAD_READ)==0) {
+				load = LOAD_READ;
+			} else if (strcmp(argv[i],ARG_LOAD_MMAP)==0) {
+				load = LOAD_MMAP;
+			} else if (strcmp(argv[i],ARG_LOAD_MMAP_SHARED)==0) {
+				load = LOAD_MMAP_SHARED;
+			} else {
+				printUsage();
+				return 0;
+			}
+		} else if (strcmp(argv[i],ARG_PREFAULT)==0) {
+			// "-f" how to prefault the mapped input
+			++i;
+			if (strcmp(argv[i],ARG_PREFAULT_NONE)==0) {
+				prefault = PREFAULT_NONE;
+			} else if (strcmp(argv[i],ARG_PREFAULT_POPULATE)==0) {
+				prefault = PREFAULT_POPULATE;
+			} else if (strcmp(argv[i],ARG_PREFAULT_PAKETS)==0) {
+				prefault = PREFAULT_PAKETS;
+			} else {
+				printUsage();
+				return 0;
+			}
+		} else if (strcmp(argv[i],ARG_ALLOC)==0) {
+			// "-h" allocation of the run buffer
+			++i;
+			if (strcmp(argv[i],ARG_ALLOC_NONE)==0) {
+				allocation = malms::ALLOC_DEFAULT;
+			} else if (strcmp(argv[i],ARG_ALLOC_PREFAULT)==0) {
+				allocation = malms::ALLOC_PREFAULT;
+			} else if (strcmp(argv[i],ARG_ALLOC_THP)==0) {
+				allocation = malms::ALLOC_THP;
+			} else if (strcmp(argv[i],ARG_ALLOC_HUGETLB)==0) {
+				allocation = malms::ALLOC_HUGETLB;
+			} else {
+				printUsage();
+				return 0;
+			}
+		} else if (strcmp(argv[i],ARG_WAIT)==0) {
+			// "-w" sleeping or helping wait
+			++i;
+			if (strcmp(argv[i],ARG_WAIT_SLEEP)==0) {
+				helping = false;
+			} else if (strcmp(argv[i],ARG_WAIT_HELP)==0) {
+				helping = true;
+			} else {
+				printUsage();
+				return 0;
+			}
+		} else if (strcmp(argv[i],ARG_MONITOR)==0) {
+			// "-d" period of the contention monitor
+			++i;
+			monitor = atoi(argv[i]);
+		} else if (strcmp(argv[i],ARG_RUNNING)==0) {
+			// "-r" splittable or whole merge pakets
+			++i;
+			if (strcmp(argv[i],ARG_RUNNING_SPLIT)==0) {
+				split_running = true;
+			} else if (strcmp(argv[i],ARG_RUNNING_WHOLE)==0) {
+				split_running = false;
+			} else {
+				printUsage();
+				return 0;
+			}
+		} else if (strcmp(argv[i],ARG_PHASES)==0) {
+			// "-s" pipelined or separate phases
+			++i;
+			if (strcmp(argv[i],ARG_PHASES_PIPELINED)==0) {
+				pipelined = true;
+			} else if (strcmp(argv[i],ARG_PHASES_SEPARATE)==0) {
+				pipelined = false;
+			} else {
+				printUsage();
+				return 0;
+			}
 		}
 		++i;
 	}
-	if (a == MALMS && k == 0) {
+	// only the in-memory malms::sort tunes itself, the others get one thread
+	// or paket per core
+	if (tuned && (a != MALMS || memory > 0 || extra > 0)) {
+		k = (c > 0) ? c : boost::thread::hardware_concurrency();
+		tuned = false;
+	}
+	if ((a == MALMS || a == SAMPLESORT) && k == 0 && !tuned) {
 		printUsage();
 		return 0;
 	}
 	
 	filename = argv[i];
 	
-	// read input file, open with ios::ate so that position is at the end of the file
-	// which is needed to determine file size
+	// sort the file within the memory limit, in memory or external
+	if (a == MALMS && memory > 0) {
+		std::string output_name = (output != NULL) ? std::string(output) : std::string(filename) + ".sorted";
+		CPUTimer timer;
+		timer.start();
+		Scheduler::WorkQueue* queue = createQueue(c, monitor);
+		if (pid != 0) {
+			kill(pid, SIGSTARTBLOCKCORES);
+		}
+		if (!malms::sort_file<int>(filename, output_name.c_str(), k, queue, memory << 20)) {
+			std::cout << "Unable to sort file" << std::endl;
+			return 0;
+		}
+		timer.stop();
+		std::cout << timer.getTime();
+		std::cout.flush();
+		return 0;
+	}
+	
+	// the scheduler is started outside of the load and the sort timer, so
+	// that the sort times of the load modes can be compared
+	Scheduler::WorkQueue* queue = NULL;
+	if (a == MALMS || a == SAMPLESORT || (load != LOAD_READ && prefault == PREFAULT_PAKETS)) {
+		queue = createQueue(c, monitor);
+	}
+	
+	CPUTimer loadtimer;
+	loadtimer.start();
 	int * data;
-	std::ifstream inputFile(filename, std::ios::in | std::ios::binary | std::ios::ate);
+	char * chardata;
+	unsigned long long filesize;
 	
-	if (!inputFile.is_open()) {
-		std::cout << "Unable to open file" << std::endl;
-		return 0;
+	if (load == LOAD_READ) {
+		// read input file, open with ios::ate so that position is at the end of the file
+		// which is needed to determine file size
+		std::ifstream inputFile(filename, std::ios::in | std::ios::binary | std::ios::ate);
+		
+		if (!inputFile.is_open()) {
+			std::cout << "Unable to open file" << std::endl;
+			return 0;
+		}
+		// read file
+		filesize = inputFile.tellg();
+		chardata = new char[filesize];
+		inputFile.seekg(0, std::ios::beg);
+		inputFile.read(chardata, filesize);
+		inputFile.close();
+	} else {
+		// map the input file, a shared mapping writes the sorted data back
+		int fd = open(filename, (load == LOAD_MMAP_SHARED) ? O_RDWR : O_RDONLY);
+		struct stat st;
+		if (fd < 0 || fstat(fd, &st) != 0) {
+			std::cout << "Unable to open file" << std::endl;
+			return 0;
+		}
+		filesize = st.st_size;
+		int flags = (load == LOAD_MMAP_SHARED) ? MAP_SHARED : MAP_PRIVATE;
+		if (prefault == PREFAULT_POPULATE) {
+			flags |= MAP_POPULATE;
+		}
+		void* mapping = mmap(NULL, filesize, PROT_READ | PROT_WRITE, flags, fd, 0);
+		close(fd);
+		if (mapping == MAP_FAILED) {
+			std::cout << "Unable to map file" << std::endl;
+			return 0;
+		}
+		chardata = static_cast<char*>(mapping);
+		
+		// touch all pages in parallel on the scheduler
+		if (prefault == PREFAULT_PAKETS) {
+			unsigned int num_pakets = (k > 0) ? k : 1;
+			unsigned long long page_size = sysconf(_SC_PAGESIZE);
+			unsigned long long num_pages = (filesize + page_size - 1) / page_size;
+			std::vector<malms::PrefaultPaket> pakets;
+			pakets.reserve(num_pakets);
+			unsigned long long page = 0;
+			for (unsigned int j = 0; j < num_pakets; j++) {
+				unsigned long long pages = malms::paket_size(num_pages, num_pakets, j);
+				pakets.push_back(malms::PrefaultPaket(chardata + page*page_size, chardata + std::min((page+pages)*page_size, filesize), page_size));
+				queue->push(&pakets.back());
+				page += pages;
+			}
+			queue->blockuntildone();
+		}
+	}
+	loadtimer.stop();
+	// other algorithms do not use the scheduler
+	if (queue != NULL && a != MALMS && a != SAMPLESORT) {
+		Scheduler::MaleableScheduler::deleteSingleton();
+		queue = NULL;
 	}
-	// read file
-	std::ifstream::pos_type filesize;
-	filesize = inputFile.tellg();
-	char * chardata = new char[filesize];
-	inputFile.seekg(0, std::ios::beg);
-	inputFile.read(chardata, filesize);
-	inputFile.close();
+	std::cerr << "Load time: " << loadtimer.getTime() << " s" << std::endl;
 	
 	// cast as int
 	data = reinterpret_cast<int*>(chardata);
@@ -126,6 +399,13 @@ int main(int argc, char* argv[]) {
 	
 	// prepare timing function
 	CPUTimer timer;
+	struct rusage usage_before;
+	getrusage(RUSAGE_SELF, &usage_before);
+	const char* allocation_used = ARG_ALLOC_NONE;
+	std::size_t helped = 0;
+	// the idle time of the loading is not counted
+	double idle_before = (queue != NULL) ? queue->idleTime() : 0;
+	long splits_before = (queue != NULL) ? queue->splitJobs() : 0;
 	
 	// start sorting with the correct algorithm
 	if (a == MCSTL_MWMS) {
@@ -139,19 +419,27 @@ int main(int argc, char* argv[]) {
 		
 	} else if (a == MALMS) {
 		timer.start();
-		// prepare threadpool
-		Scheduler::MaleableScheduler* sched = Scheduler::MaleableScheduler::singleton();
-		Scheduler::WorkQueue* queue = sched->newJob();
-		if (c == 0) {
-			sched->scheduleToAll(queue);
-		} else {
-			sched->scheduleToFirst(queue, c);
-		}
 		// give signal that preparation is done
 		if (pid != 0) {
 			kill(pid, SIGSTARTBLOCKCORES);
 		}
-		malms::sort(data,data+n,k,queue);
+		if (extra > 0) {
+			malms::sort_bounded(data,data+n,k,queue,extra);
+		} else {
+			malms::SortContext<int*> context;
+			context.setAllocationPolicy(allocation);
+			context.setPipelined(pipelined);
+			context.setHelpingWait(helping);
+			context.setSplittableMerge(split_running);
+			if (tuned) {
+				malms::sort(data,data+n,queue,context);
+			} else {
+				malms::sort(data,data+n,k,queue,context);
+			}
+			const char* names[] = {ARG_ALLOC_NONE, ARG_ALLOC_PREFAULT, ARG_ALLOC_THP, ARG_ALLOC_HUGETLB};
+			allocation_used = names[context.allocationPolicy()];
+			helped = context.helpedPakets();
+		}
 		timer.stop();
 	} else if (a == STDSORT) {
 		timer.start();
@@ -169,10 +457,33 @@ int main(int argc, char* argv[]) {
 		}
 		tbb::parallel_sort(data,data+n);
 		timer.stop();
+	} else if (a == SAMPLESORT) {
+		timer.start();
+		// give signal that preparation is done
+		if (pid != 0) {
+			kill(pid, SIGSTARTBLOCKCORES);
+		}
+		malms::sample_sort(data,data+n,k,queue);
+		timer.stop();
 	}
 
 	// output measured time and then exit
 	std::cout << timer.getTime();
 	std::cout.flush();
+	struct rusage usage_after;
+	getrusage(RUSAGE_SELF, &usage_after);
+	std::cerr << "Allocation: " << allocation_used << std::endl;
+	std::cerr << "Minor faults: " << usage_after.ru_minflt - usage_before.ru_minflt << std::endl;
+	std::cerr << "Major faults: " << usage_after.ru_majflt - usage_before.ru_majflt << std::endl;
+	if (queue != NULL) {
+		std::cerr << "Idle time: " << queue->idleTime() - idle_before << " s" << std::endl;
+		std::cerr << "Pakets run by the calling thread: " << helped << std::endl;
+		std::cerr << "Pakets split while running: " << queue->splitJobs() - splits_before << std::endl;
+		// removes the socket
+		Scheduler::MaleableScheduler::singleton()->stopControlSocket();
+	}
+	if (load != LOAD_READ) {
+		munmap(chardata, filesize);
+	}
 	return 0;
 }
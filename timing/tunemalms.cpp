@@ -0,0 +1,64 @@
+/*
+ *  Calibration of the MALMS tuning table.
+ *
+ *  Author:		Patrick Flick
+ *  Version:	0.1
+ *
+ *  Description:
+ *				Measures the best parameters of malms::sort for ints and long
+ *				longs up to maxn elements on all cores (or the first c cores)
+ *				and writes the tuning table, which malms::sort calls without a
+ *				number of pakets read in later runs. The table is written to
+ *				the given file, or to $MALMS_TUNING_FILE or ~/.malms_tuning.
+ *				Outputs the table as CSV.
+ *
+ *				Usage: tunemalms [maxn] [cores] [file]
+ */
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+#include "../malms/calibrate.h"
+#include "../malms/threadpool/maleablescheduler.h"
+
+int main(int argc, char* argv[]) {
+	std::size_t maxn = 1 << 24;
+	int c = 0;
+	std::string path = malms::Tuning::default_path();
+	if (argc > 1) maxn = atol(argv[1]);
+	if (argc > 2) c = atoi(argv[2]);
+	if (argc > 3) path = argv[3];
+
+	Scheduler::MaleableScheduler* sched = Scheduler::MaleableScheduler::singleton();
+	Scheduler::WorkQueue* queue = sched->newJob();
+	if (c == 0) {
+		sched->scheduleToAll(queue);
+	} else {
+		sched->scheduleToFirst(queue, c);
+	}
+
+	const malms::Tuning::CacheSizes& cache = malms::Tuning::cache_sizes();
+	std::cerr << "Caches: L1 " << cache.l1 << ", L2 " << cache.l2 << ", L3 " << cache.l3 << " bytes" << std::endl;
+
+	malms::Tuning::TuningTable table;
+	malms::Tuning::calibrate<int>(queue, maxn, table);
+	malms::Tuning::calibrate<long long>(queue, maxn, table);
+	Scheduler::MaleableScheduler::deleteSingleton();
+
+	if (!table.save(path)) {
+		std::cerr << "Unable to write " << path << std::endl;
+		return 1;
+	}
+	std::cerr << "Tuning table written to " << path << std::endl;
+
+	std::cout << "Element.Size;n;Cores;Workpakets;Buffered;Sequential" << std::endl;
+	malms::Tuning::TuningTable written;
+	written.load(path);
+	for (std::size_t i = 0; i < written.size(); i++) {
+		const malms::Tuning::TableEntry& e = written.entry(i);
+		std::cout << e.element_size << ";" << e.n << ";" << e.cores << ";" << e.parameters.num_of_pakets << ";"
+		          << e.parameters.buffered_merge << ";" << e.parameters.sequential << std::endl;
+	}
+	return 0;
+}
@@ -1,33 +1,44 @@
 /*
- *  Send Signals to Maleable-Scheduler
+ *  Send Core Updates to Maleable-Scheduler
  *
  *  Author:		Patrick Flick
  *  Version:	0.1
  *
  *  Description:
- *  			Sends Signals to Maleable-Scheduler, telling it which cores
- *  			are enabled and disabled.
+ *  			Tells the Maleable-Scheduler which cores are enabled and
+ *  			disabled, with one message to the control socket of the
+ *  			target process (see malms/threadpool/corecontrol.h), which
+ *  			applies all cores at once. If the process has no control
+ *  			socket, or with -s, sends one realtime signal per core.
  *				Target PID and Cores are defined by commandline arguments.
  */
 
 #include <signal.h>
+#include <unistd.h>
 #include <cstring>
 #include <iostream>
 #include <cstdlib>
 #include <vector>
+#include <string>
+
+#include "../malms/threadpool/corecontrol.h"
 
 #define BLOCK "block"
 #define UNBLOCK "unblock"
+#define SET "set"
 #define PID "-p"
 #define CORES "-c"
+#define SIGNALS "-s"
 
 
 void printUsage() {
 	std::cout << "Usage:" << std::endl;
-	std::cout << "Sending Block Signal:\n\tsendblockcore block -p [PID] -c [CORES]" << std::endl;
-	std::cout << "Sending Unblock Signal:\n\tsendblockcore unblock -p [PID] -c [CORES]" << std::endl;
+	std::cout << "Blocking Cores:\n\tsendblockcore block -p [PID] -c [CORES] [-s]" << std::endl;
+	std::cout << "Unblocking Cores:\n\tsendblockcore unblock -p [PID] -c [CORES] [-s]" << std::endl;
+	std::cout << "Setting the available Cores:\n\tsendblockcore set -p [PID] -c [CORES] [-s]" << std::endl;
 	std::cout << "Where:\n[PID]\t\tProcess-ID pid of the target process." << std::endl;
-	std::cout << "[CORES]\t\tCores to be blocked/unblocked, a list of integers:\n\t\t1 3 5" << std::endl;
+	std::cout << "[CORES]\t\tCores to be blocked/unblocked/available, a list of integers and ranges:\n\t\t1 3 5-7" << std::endl;
+	std::cout << "-s\t\tSend one realtime signal per core instead of a message to the control socket." << std::endl;
 }
 
 
@@ -35,21 +46,17 @@ int main(int argc, char* argv[]) {
 	/*
 	 *  Read Input from argv.
 	 */
-	
+
 	if (argc < 6) {
 		printUsage();
 		return 0;
 	}
-	bool doBlock; // true: block core, false: unblock core
-	if (strcmp(argv[1],BLOCK)==0) {
-		doBlock = true;
-	} else if (strcmp(argv[1],UNBLOCK)==0) {
-		doBlock = false;
-	} else {
+	const char* command = argv[1];
+	if (strcmp(command,BLOCK)!=0 && strcmp(command,UNBLOCK)!=0 && strcmp(command,SET)!=0) {
 		printUsage();
 		return 0;
 	}
-	
+
 	int pid;
 	if (strcmp(argv[2],PID)==0) {
 		pid = atoi(argv[3]);
@@ -62,12 +69,14 @@ int main(int argc, char* argv[]) {
 		return 0;
 	}
 
-
-	std::vector<int> inputcores(argc-5);
+	// the cores of the machine that are listed
+	std::vector<bool> listed(sysconf(_SC_NPROCESSORS_CONF), false);
+	bool signals = false;
 	if (strcmp(argv[4],CORES)==0) {
-		for (unsigned int i = 0; i < inputcores.size(); i++) {
-			inputcores[i] = atoi(argv[5+i]);
-			if (inputcores[i] == 0) {
+		for (int i = 5; i < argc; i++) {
+			if (strcmp(argv[i],SIGNALS)==0) {
+				signals = true;
+			} else if (!Scheduler::CoreControl::parse_cores(argv[i], listed)) {
 				printUsage();
 				return 0;
 			}
@@ -76,13 +85,32 @@ int main(int argc, char* argv[]) {
 		printUsage();
 		return 0;
 	}
-	
+	std::vector<int> inputcores;
+	for (unsigned int i = 0; i < listed.size(); i++) {
+		if (listed[i]) inputcores.push_back(i);
+	}
+
+	/*
+	 * Send the update as one message
+	 */
+	if (!signals && Scheduler::CoreControl::send(Scheduler::CoreControl::socket_path(pid), Scheduler::CoreControl::line(command, inputcores))) {
+		return 0;
+	}
+
 	/*
-	 * Send Signals
+	 * Send Signals, for set the cores that are not listed are blocked
 	 */
+	bool set = strcmp(command,SET)==0;
+	if (set) {
+		inputcores.clear();
+		for (unsigned int i = 0; i < listed.size(); i++) {
+			inputcores.push_back(i);
+		}
+	}
 	for (unsigned int i = 0; i < inputcores.size(); i++) {
 		union sigval value;
 		value.sival_int = inputcores[i];
+		bool doBlock = set ? !listed[inputcores[i]] : strcmp(command,BLOCK)==0;
 		if (doBlock) {
 			sigqueue(pid, SIGRTMIN+1, value);
 		} else {